@@ -0,0 +1,1332 @@
+#include "DeletionEngine.h"
+#include "FindSave.h"
+#include "InstallIndex.h"
+#include "LogBatchReader.h"
+#include "LogFormatMatcher.h"
+#include "LogHeaderCorpus.h"
+#include "LogHeaderReader.h"
+#include "PlayerPrefsBackend.h"
+#include "SaveArchiver.h"
+#include "ScanStats.h"
+#include "SizeAggregator.h"
+#include "SyntheticTree.h"
+#include "UserRegPlayerPrefsBackend.h"
+#include "WalkPolicy.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <cstdarg>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// SCANNER BENCHMARKS OVER GENERATED LOCALLOW TREES
+
+// every allocation in the program is counted, so steps can say how many they made.
+// Every form of new and delete is replaced, so each delete frees what its new
+// allocated however the compiler pairs them up.
+static std::atomic<uint64_t> allocationCount{ 0 };
+
+static void* Allocate(size_t size, size_t alignment)
+{
+	++allocationCount;
+	size = size != 0 ? size : 1;
+	if (alignment <= alignof(std::max_align_t))
+	{
+		return std::malloc(size);
+	}
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	// aligned_alloc wants a whole number of alignments.
+	return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+static void Free(void* memory, size_t alignment) noexcept
+{
+#ifdef _WIN32
+	if (alignment > alignof(std::max_align_t))
+	{
+		_aligned_free(memory);
+		return;
+	}
+#else
+	(void)alignment;
+#endif
+	std::free(memory);
+}
+
+static void* AllocateOrThrow(size_t size, size_t alignment)
+{
+	if (void* memory = Allocate(size, alignment))
+	{
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return AllocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return AllocateOrThrow(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return AllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return AllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return Allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return Allocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return Allocate(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* memory) noexcept { Free(memory, 0); }
+void operator delete[](void* memory) noexcept { Free(memory, 0); }
+void operator delete(void* memory, size_t) noexcept { Free(memory, 0); }
+void operator delete[](void* memory, size_t) noexcept { Free(memory, 0); }
+void operator delete(void* memory, std::align_val_t alignment) noexcept { Free(memory, static_cast<size_t>(alignment)); }
+void operator delete[](void* memory, std::align_val_t alignment) noexcept { Free(memory, static_cast<size_t>(alignment)); }
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept { Free(memory, static_cast<size_t>(alignment)); }
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept { Free(memory, static_cast<size_t>(alignment)); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { Free(memory, 0); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { Free(memory, 0); }
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept { Free(memory, static_cast<size_t>(alignment)); }
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept { Free(memory, static_cast<size_t>(alignment)); }
+
+// every file system call that goes through libc is counted too, on Linux, by
+// standing in for the libc functions and passing each call on. Calls libc makes
+// inside its own functions can't be seen: readdir's getdents64 calls are
+// counted once per folder, for the read that finds the end, so the
+// std::filesystem listing comes out a little cheaper than it is.
+static std::atomic<uint64_t> fileSystemCallCount{ 0 };
+
+#ifdef __linux__
+#define FORWARD(name, ...) using Real = __VA_ARGS__; static Real real = reinterpret_cast<Real>(dlsym(RTLD_NEXT, name)); ++fileSystemCallCount
+
+extern "C"
+{
+	int open(const char* path, int flags, ...)
+	{
+		FORWARD("open", int(*)(const char*, int, ...));
+		va_list arguments;
+		va_start(arguments, flags);
+		mode_t mode = (flags & O_CREAT) != 0 ? static_cast<mode_t>(va_arg(arguments, int)) : 0;
+		va_end(arguments);
+		return real(path, flags, mode);
+	}
+
+	int openat(int folder, const char* path, int flags, ...)
+	{
+		FORWARD("openat", int(*)(int, const char*, int, ...));
+		va_list arguments;
+		va_start(arguments, flags);
+		mode_t mode = (flags & O_CREAT) != 0 ? static_cast<mode_t>(va_arg(arguments, int)) : 0;
+		va_end(arguments);
+		return real(folder, path, flags, mode);
+	}
+
+	int close(int fd)
+	{
+		FORWARD("close", int(*)(int));
+		return real(fd);
+	}
+
+	int stat(const char* path, struct stat* status)
+	{
+		FORWARD("stat", int(*)(const char*, struct stat*));
+		return real(path, status);
+	}
+
+	int lstat(const char* path, struct stat* status)
+	{
+		FORWARD("lstat", int(*)(const char*, struct stat*));
+		return real(path, status);
+	}
+
+	int fstat(int fd, struct stat* status)
+	{
+		FORWARD("fstat", int(*)(int, struct stat*));
+		return real(fd, status);
+	}
+
+	int fstatat(int folder, const char* path, struct stat* status, int flags)
+	{
+		FORWARD("fstatat", int(*)(int, const char*, struct stat*, int));
+		return real(folder, path, status, flags);
+	}
+
+	ssize_t getdents64(int fd, void* buffer, size_t length)
+	{
+		FORWARD("getdents64", ssize_t(*)(int, void*, size_t));
+		return real(fd, buffer, length);
+	}
+
+	DIR* opendir(const char* path)
+	{
+		FORWARD("opendir", DIR*(*)(const char*));
+		return real(path);
+	}
+
+	DIR* fdopendir(int fd)
+	{
+		FORWARD("fdopendir", DIR*(*)(int));
+		return real(fd);
+	}
+
+	int closedir(DIR* folder)
+	{
+		FORWARD("closedir", int(*)(DIR*));
+		return real(folder);
+	}
+
+	struct dirent* readdir(DIR* folder)
+	{
+		static struct dirent* (*real)(DIR*) = reinterpret_cast<struct dirent* (*)(DIR*)>(dlsym(RTLD_NEXT, "readdir"));
+		struct dirent* entry = real(folder);
+		if (entry == nullptr)
+		{
+			++fileSystemCallCount;
+		}
+		return entry;
+	}
+}
+
+#undef FORWARD
+#endif
+
+namespace
+{
+	struct BenchOptions
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "unity-save-deleter-bench";
+		SyntheticTreeOptions tree;
+		unsigned int maxThreads = 0;
+		int iterations = 5;
+		// files under the first game of the pruning benchmark's tree
+		size_t clutterFiles = 20000;
+		bool keep = false;
+	};
+
+	// one row of the results table
+	struct BenchResult
+	{
+		std::string name;
+		double milliseconds = 0.0;
+		uint64_t directoriesVisited = 0;
+		uint64_t directoriesRead = 0;
+		uint64_t filesOpened = 0;
+		uint64_t bytesRead = 0;
+		uint64_t pathsProbed = 0;
+		uint64_t allocations = 0;
+		uint64_t fileSystemCalls = 0;
+		// entries of the listed folders, for calls per entry
+		uint64_t entriesChecked = 0;
+		uint64_t logsReadOnRing = 0;
+		// when the first company with a Player.log save was reported, the median over the runs
+		double firstPlayerLogMilliseconds = 0.0;
+	};
+
+	// exit codes
+	const int EXIT_BAD_ARGUMENTS = 1;
+	const int EXIT_WRONG_RESULTS = 2;
+
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Prints how to call the program.
+	 */
+	void PrintUsage()
+	{
+		std::fprintf(stderr,
+			"Usage: UnitySaveDeleterBench [--dir PATH] [--companies N] [--games N] [--depth N]\n"
+			"                             [--fanout N] [--log-bytes N] [--clutter N] [--threads N] [--iterations N] [--keep]\n"
+			"\n"
+			"  --dir PATH      where to build the trees, each one wiped before it is built\n"
+			"  --companies N   company folders, 100 by default\n"
+			"  --games N       save folders per company, 4 by default\n"
+			"  --depth N       levels of extra folders under each save, 2 by default\n"
+			"  --fanout N      folders per level of those, 2 by default\n"
+			"  --log-bytes N   size of each log file, 16384 by default\n"
+			"  --clutter N     files in the replay and recording folders of the pruning benchmark, 20000 by default\n"
+			"  --threads N     highest scan thread count tried, hardware threads by default\n"
+			"  --iterations N  runs per benchmark, the median is reported, 5 by default\n"
+			"  --keep          leave what was built behind afterwards, otherwise only that is\n"
+			"                  removed, and PATH too if nothing else is in it\n"
+			"\n"
+			"Timings are with a warm file system cache, the tree having just been written.\n");
+	}
+
+	/**
+	 * @brief Reads the command line.
+	 *
+	 * @return False if it doesn't make sense.
+	 */
+	bool ParseArguments(int argc, char* argv[], BenchOptions& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string argument = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (argument == "--dir" && hasValue)
+			{
+				options.directory = std::filesystem::u8path(argv[++i]);
+			}
+			else if (argument == "--companies" && hasValue)
+			{
+				options.tree.companyCount = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (argument == "--games" && hasValue)
+			{
+				options.tree.gamesPerCompany = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (argument == "--depth" && hasValue)
+			{
+				options.tree.nestingDepth = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (argument == "--fanout" && hasValue)
+			{
+				options.tree.foldersPerLevel = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (argument == "--log-bytes" && hasValue)
+			{
+				options.tree.logBytes = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (argument == "--clutter" && hasValue)
+			{
+				options.clutterFiles = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (argument == "--threads" && hasValue)
+			{
+				options.maxThreads = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+			}
+			else if (argument == "--iterations" && hasValue)
+			{
+				options.iterations = std::atoi(argv[++i]);
+			}
+			else if (argument == "--keep")
+			{
+				options.keep = true;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		if (options.maxThreads == 0)
+		{
+			options.maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		return options.iterations > 0;
+	}
+
+	/**
+	 * @brief Gets milliseconds since start.
+	 */
+	double ElapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	/**
+	 * @brief Runs a scan a number of times.
+	 *
+	 * @param snapshotPath Snapshot to reuse and update, empty for none.
+	 * @param policy Which folders are walked.
+	 * @param portableListing List folders through std::filesystem, see DirectoryReader.
+	 * @return The median time, and the counters of the last run.
+	 */
+	BenchResult TimeScan(const std::string& name, const std::filesystem::path& root, unsigned int threadCount, const std::string& snapshotPath, int iterations, const WalkPolicy& policy = WalkPolicy(), bool portableListing = false, bool ringLogReads = true)
+	{
+		std::vector<double> times;
+		std::vector<double> firstPlayerLogTimes;
+		ScanStats stats;
+		uint64_t fileSystemCalls = 0;
+		for (int i = 0; i < iterations; ++i)
+		{
+			FindSave finder;
+			finder.SetScanThreadCount(threadCount);
+			finder.SetSnapshotPath(snapshotPath);
+			finder.SetWalkPolicy(policy);
+			finder.SetPortableListing(portableListing);
+			finder.SetRingLogReads(ringLogReads);
+
+			stats.Reset();
+			ScanObserver observer;
+			observer.stats = &stats;
+
+			uint64_t callsBefore = fileSystemCallCount;
+			Clock::time_point start = Clock::now();
+			std::mutex firstMutex;
+			double firstPlayerLog = 0.0;
+			observer.onCompanyScanned = [&start, &firstMutex, &firstPlayerLog](const std::string&, const std::vector<SaveEntry>& saves, size_t, size_t)
+				{
+					bool hasPlayerLog = std::any_of(saves.begin(), saves.end(), [](const SaveEntry& save) { return save.hasPlayerLog; });
+					std::lock_guard<std::mutex> lock(firstMutex);
+					if (hasPlayerLog && firstPlayerLog == 0.0)
+					{
+						firstPlayerLog = ElapsedMs(start);
+					}
+				};
+			finder.ScanSaves(root.u8string(), observer);
+			times.push_back(ElapsedMs(start));
+			firstPlayerLogTimes.push_back(firstPlayerLog);
+			fileSystemCalls = fileSystemCallCount - callsBefore;
+		}
+
+		std::sort(times.begin(), times.end());
+		std::sort(firstPlayerLogTimes.begin(), firstPlayerLogTimes.end());
+		BenchResult result;
+		result.name = name;
+		result.milliseconds = times[times.size() / 2];
+		result.firstPlayerLogMilliseconds = firstPlayerLogTimes[firstPlayerLogTimes.size() / 2];
+		result.directoriesVisited = stats.directoriesVisited;
+		result.directoriesRead = stats.directoriesRead;
+		result.filesOpened = stats.filesOpened;
+		result.bytesRead = stats.bytesRead;
+		result.pathsProbed = stats.pathsProbed;
+		result.fileSystemCalls = fileSystemCalls;
+		result.entriesChecked = stats.entriesChecked;
+		result.logsReadOnRing = stats.logsReadOnRing;
+		return result;
+	}
+
+	/**
+	 * @brief Prints the results table.
+	 */
+	void PrintResults(const char* title, const std::vector<BenchResult>& results)
+	{
+		std::printf("\n%s\n", title);
+		std::printf("  %-28s %10s %10s %10s %10s %12s %8s %10s %10s\n", "benchmark", "ms", "visited", "listed", "opened", "bytes", "probes", "allocs", "fs calls");
+		for (const BenchResult& result : results)
+		{
+			std::printf("  %-28s %10.2f %10llu %10llu %10llu %12llu %8llu %10llu %10llu\n",
+				result.name.c_str(),
+				result.milliseconds,
+				static_cast<unsigned long long>(result.directoriesVisited),
+				static_cast<unsigned long long>(result.directoriesRead),
+				static_cast<unsigned long long>(result.filesOpened),
+				static_cast<unsigned long long>(result.bytesRead),
+				static_cast<unsigned long long>(result.pathsProbed),
+				static_cast<unsigned long long>(result.allocations),
+				static_cast<unsigned long long>(result.fileSystemCalls));
+		}
+	}
+
+	/**
+	 * @brief Copies out the unlinked and unknown saves, the ones the Delete buttons would offer.
+	 */
+	std::vector<std::string> GetDeletablePaths(const SaveIndex& index)
+	{
+		std::vector<std::string> paths;
+		for (SaveClass classification : { SaveClass::Unlinked, SaveClass::Unknown })
+		{
+			for (size_t entry : index.GetRows(classification))
+			{
+				paths.emplace_back(index.GetGamePath(entry));
+			}
+		}
+		return paths;
+	}
+
+	/**
+	 * @brief Checks one scan of the tree finds what the generator put in it.
+	 *
+	 * @return False if the counts differ, the differences have been printed.
+	 */
+	bool CheckScan(const SyntheticTreeSummary& summary)
+	{
+		FindSave finder;
+		finder.ScanSaves(summary.localLow.u8string());
+
+		size_t counts[3] = {};
+		for (int i = 0; i < 3; ++i)
+		{
+			counts[i] = finder.GetSaveIndex().GetRows(static_cast<SaveClass>(i)).size();
+		}
+
+		const size_t expected[3] = { summary.installed, summary.unlinked, summary.unknown };
+		const char* names[3] = { "installed", "unlinked", "unknown" };
+		bool matches = true;
+		for (int i = 0; i < 3; ++i)
+		{
+			if (counts[i] != expected[i])
+			{
+				std::fprintf(stderr, "check: %zu %s saves found, %zu generated\n", counts[i], names[i], expected[i]);
+				matches = false;
+			}
+		}
+		return matches;
+	}
+
+	/**
+	 * @brief Times LogHeaderReader on every log in the tree, and LogFormatMatcher on the corpus.
+	 *
+	 * @return False if the matcher gets a corpus sample wrong.
+	 */
+	bool BenchLogParsing(const SyntheticTreeSummary& summary, int iterations)
+	{
+		std::vector<std::string> logs;
+		std::error_code error;
+		for (std::filesystem::recursive_directory_iterator it(summary.localLow, error), end; it != end; it.increment(error))
+		{
+			if (it->path().filename() == "Player.log")
+			{
+				logs.push_back(it->path().u8string());
+			}
+		}
+
+		std::vector<BenchResult> results;
+		BenchResult reader;
+		reader.name = "LogHeaderReader, tree logs";
+		std::vector<double> times;
+		for (int i = 0; i < iterations; ++i)
+		{
+			reader.filesOpened = 0;
+			reader.bytesRead = 0;
+			Clock::time_point start = Clock::now();
+			for (const std::string& log : logs)
+			{
+				LogHeader header = LogHeaderReader::Read(log);
+				++reader.filesOpened;
+				reader.bytesRead += header.bytesRead;
+			}
+			times.push_back(ElapsedMs(start));
+		}
+		std::sort(times.begin(), times.end());
+		reader.milliseconds = times[times.size() / 2];
+		results.push_back(reader);
+
+		bool correct = true;
+		for (const LOG_CORPUS::Sample& sample : LOG_CORPUS::SAMPLES)
+		{
+			LogHeader header = LogFormatMatcher::Match(sample.header);
+			if (header.format != sample.format || header.installPath != sample.installPath)
+			{
+				std::fprintf(stderr, "check: corpus sample %.*s matched wrongly\n", static_cast<int>(sample.name.size()), sample.name.data());
+				correct = false;
+			}
+		}
+
+		// enough passes over the corpus to get a steady figure.
+		const int passes = 20000;
+		uint64_t corpusBytes = 0;
+		size_t found = 0;
+		Clock::time_point start = Clock::now();
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			for (const LOG_CORPUS::Sample& sample : LOG_CORPUS::SAMPLES)
+			{
+				found += LogFormatMatcher::Match(sample.header).status == LogHeaderStatus::Found;
+				corpusBytes += sample.header.size();
+			}
+		}
+		BenchResult matcher;
+		matcher.name = "LogFormatMatcher, corpus";
+		matcher.milliseconds = ElapsedMs(start);
+		matcher.bytesRead = corpusBytes;
+		results.push_back(matcher);
+
+		PrintResults("Log parsing", results);
+		std::printf("  LogHeaderReader %.0f logs/s, LogFormatMatcher %.1f MB/s (%zu matches)\n",
+			reader.milliseconds > 0.0 ? reader.filesOpened * 1000.0 / reader.milliseconds : 0.0,
+			matcher.milliseconds > 0.0 ? corpusBytes / 1000.0 / matcher.milliseconds : 0.0,
+			found);
+		return correct;
+	}
+
+	/**
+	 * @brief Fills an in-memory registry with a key for every save in the tree, plus other software.
+	 */
+	MemoryPlayerPrefsBackend* FillPlayerPrefs(FindSave& finder, const std::filesystem::path& localLow)
+	{
+		std::unique_ptr<MemoryPlayerPrefsBackend> backend = std::make_unique<MemoryPlayerPrefsBackend>();
+		const SaveIndex& index = finder.GetSaveIndex();
+		for (size_t entry = 0; entry < index.GetCount(); ++entry)
+		{
+			std::filesystem::path relative = std::filesystem::u8path(index.GetGamePath(entry)).lexically_relative(localLow);
+			backend->AddGame(relative.begin()->wstring(), relative.filename().wstring());
+		}
+		// HKCU\SOFTWARE is never only Unity games.
+		for (int i = 0; i < 200; ++i)
+		{
+			backend->AddGame(L"Vendor " + std::to_wstring(i), L"Settings");
+		}
+
+		MemoryPlayerPrefsBackend* raw = backend.get();
+		finder.SetPlayerPrefsBackend(std::move(backend));
+		return raw;
+	}
+
+	/**
+	 * @brief Times clearing the PlayerPrefs of every unlinked and unknown save, one at a time and batched.
+	 *
+	 * Runs against an in-memory registry, counting the calls that would have gone to the real one.
+	 *
+	 * @return False if the batch deleted the wrong keys.
+	 */
+	bool BenchPlayerPrefs(const SyntheticTreeSummary& summary)
+	{
+		FindSave finder;
+		finder.ScanSaves(summary.localLow.u8string());
+
+		std::vector<std::string> paths = GetDeletablePaths(finder.GetSaveIndex());
+		std::string root = summary.localLow.u8string();
+
+		MemoryPlayerPrefsBackend* single = FillPlayerPrefs(finder, summary.localLow);
+		BenchResult oneByOne;
+		oneByOne.name = "one save at a time";
+		Clock::time_point start = Clock::now();
+		for (const std::string& path : paths)
+		{
+			finder.DeletePlayerPrefPaths({ path }, root);
+		}
+		oneByOne.milliseconds = ElapsedMs(start);
+		size_t singleCalls = single->GetCallCount();
+
+		MemoryPlayerPrefsBackend* batched = FillPlayerPrefs(finder, summary.localLow);
+		BenchResult batch;
+		batch.name = "one batch";
+		start = Clock::now();
+		size_t keysDeleted = finder.DeletePlayerPrefPaths(paths, root);
+		batch.milliseconds = ElapsedMs(start);
+		size_t batchCalls = batched->GetCallCount();
+
+		bool correct = true;
+		for (const std::string& path : paths)
+		{
+			std::filesystem::path relative = std::filesystem::u8path(path).lexically_relative(summary.localLow);
+			if (batched->HasGame(relative.begin()->wstring(), relative.filename().wstring()))
+			{
+				std::fprintf(stderr, "check: PlayerPrefs of %s were not deleted\n", path.c_str());
+				correct = false;
+			}
+		}
+		const SaveIndex& index = finder.GetSaveIndex();
+		for (size_t entry : index.GetRows(SaveClass::Installed))
+		{
+			std::filesystem::path relative = std::filesystem::u8path(index.GetGamePath(entry)).lexically_relative(summary.localLow);
+			if (!batched->HasGame(relative.begin()->wstring(), relative.filename().wstring()))
+			{
+				std::fprintf(stderr, "check: PlayerPrefs of installed %s were deleted\n", relative.u8string().c_str());
+				correct = false;
+			}
+		}
+		if (!batched->HasCompany(L"Vendor 0"))
+		{
+			std::fprintf(stderr, "check: unrelated software was deleted\n");
+			correct = false;
+		}
+
+		// the same batch against a Wine prefix's user.reg, bulked out with other software.
+		std::vector<std::pair<std::string, std::string>> games;
+		for (size_t entry = 0; entry < index.GetCount(); ++entry)
+		{
+			std::filesystem::path relative = std::filesystem::u8path(index.GetGamePath(entry)).lexically_relative(summary.localLow);
+			games.emplace_back(relative.begin()->u8string(), relative.filename().u8string());
+		}
+		std::filesystem::path userReg = summary.localLow.parent_path() / "user.reg";
+		uint64_t hiveBytes = SyntheticTree::WriteUserReg(userReg, games, 50000);
+		finder.SetPlayerPrefsBackend(std::make_unique<UserRegPlayerPrefsBackend>(userReg));
+
+		BenchResult hive;
+		hive.name = "user.reg batch";
+		start = Clock::now();
+		size_t hiveKeysDeleted = finder.DeletePlayerPrefPaths(paths, root);
+		hive.milliseconds = ElapsedMs(start);
+		hive.bytesRead = hiveBytes;
+
+		UserRegPlayerPrefsBackend rewritten(userReg);
+		size_t gamesLeft = 0;
+		for (const std::wstring& company : rewritten.ListCompanies())
+		{
+			gamesLeft += rewritten.ListGames(company).size();
+		}
+		// the other software's keys plus the installed games' are all that should be left.
+		size_t installedCount = index.GetRows(SaveClass::Installed).size();
+		if (hiveKeysDeleted != keysDeleted || gamesLeft != 50000 + installedCount)
+		{
+			std::fprintf(stderr, "check: user.reg rewrite deleted %zu keys, %zu games left\n", hiveKeysDeleted, gamesLeft);
+			correct = false;
+		}
+
+		PrintResults("PlayerPrefs", { oneByOne, batch, hive });
+		std::printf("  %zu saves, %zu keys deleted, %zu registry calls one at a time, %zu batched\n",
+			paths.size(), keysDeleted, singleCalls, batchCalls);
+		std::printf("  user.reg %.1f MB, rewritten at %.1f MB/s\n",
+			hiveBytes / 1e6, hive.milliseconds > 0.0 ? hiveBytes / 1000.0 / hive.milliseconds : 0.0);
+		return correct;
+	}
+
+	/**
+	 * @brief Times the platform's folder listing against std::filesystem, and counts the calls each makes.
+	 *
+	 * Both walk the whole tree, so every folder is listed.
+	 */
+	void BenchListing(const BenchOptions& options, const SyntheticTreeSummary& summary)
+	{
+		std::vector<BenchResult> results = {
+			TimeScan("std::filesystem", summary.localLow, options.maxThreads, std::string(), options.iterations, WalkPolicy::Unbounded(), true),
+			TimeScan("DirectoryReader", summary.localLow, options.maxThreads, std::string(), options.iterations, WalkPolicy::Unbounded(), false) };
+		PrintResults("Directory listing", results);
+		for (const BenchResult& result : results)
+		{
+			std::printf("  %s: %.2f file system calls per folder, %.2f per entry\n",
+				result.name.c_str(),
+				static_cast<double>(result.fileSystemCalls) / std::max<uint64_t>(1, result.directoriesVisited),
+				static_cast<double>(result.fileSystemCalls) / std::max<uint64_t>(1, result.entriesChecked));
+		}
+	}
+
+	/**
+	 * @brief Times the scan with its Player.logs read through io_uring, against reading them on the pool.
+	 *
+	 * The flat tree has the most logs. With a warm cache this mostly shows the
+	 * saved syscalls, the gap grows with the disk's latency. Also shows how long
+	 * the first company with a Player.log took to come out of either.
+	 *
+	 * @return False if the two read different logs.
+	 */
+	bool BenchLogReading(const BenchOptions& options, const SyntheticTreeSummary& flat)
+	{
+		BenchResult ring = TimeScan("io_uring", flat.localLow, options.maxThreads, std::string(), options.iterations, WalkPolicy(), false, true);
+		BenchResult pool = TimeScan("pool", flat.localLow, options.maxThreads, std::string(), options.iterations, WalkPolicy(), false, false);
+		PrintResults("Log reading", { ring, pool });
+		if (!LogBatchReader::IsRingAvailable())
+		{
+			std::printf("  io_uring isn't available here, both read on the pool\n");
+		}
+		else
+		{
+			std::printf("  %llu of %llu logs read on io_uring\n",
+				static_cast<unsigned long long>(ring.logsReadOnRing), static_cast<unsigned long long>(ring.filesOpened));
+		}
+		std::printf("  first company with a Player.log reported after %.2f ms on io_uring, %.2f ms on the pool\n",
+			ring.firstPlayerLogMilliseconds, pool.firstPlayerLogMilliseconds);
+
+		if (ring.filesOpened != pool.filesOpened || ring.bytesRead != pool.bytesRead)
+		{
+			std::fprintf(stderr, "check: io_uring read %llu logs, the pool %llu\n",
+				static_cast<unsigned long long>(ring.filesOpened), static_cast<unsigned long long>(pool.filesOpened));
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Times building the Steam install index against loading it from its cache, and checks what it resolves.
+	 *
+	 * Three quarters of the saves with no game path get a fake Steam install,
+	 * among a few hundred apps that aren't Unity games.
+	 *
+	 * @return False if a scan with the index doesn't find the installed games.
+	 */
+	bool BenchInstallIndex(const BenchOptions& options)
+	{
+		SyntheticTreeOptions treeOptions = options.tree;
+		treeOptions.steamShare = 0.75;
+		treeOptions.steamOtherApps = 300;
+		SyntheticTreeSummary summary = SyntheticTree::Generate(options.directory / "steam", treeOptions);
+		std::string cacheFile = (options.directory / "installs.cache").u8string();
+		std::vector<std::filesystem::path> steamFolders = { summary.steam };
+
+		auto timeIndex = [&](const std::string& name, bool dropCache, size_t& manifestsRead)
+			{
+				std::vector<double> times;
+				for (int i = 0; i < options.iterations; ++i)
+				{
+					std::error_code error;
+					if (dropCache)
+					{
+						std::filesystem::remove(std::filesystem::u8path(cacheFile), error);
+					}
+					Clock::time_point start = Clock::now();
+					InstallIndex index = InstallIndex::LoadOrBuild(steamFolders, cacheFile);
+					times.push_back(ElapsedMs(start));
+					manifestsRead = index.GetManifestsRead();
+				}
+				std::sort(times.begin(), times.end());
+				BenchResult result;
+				result.name = name;
+				result.milliseconds = times[times.size() / 2];
+				return result;
+			};
+
+		size_t builtManifests = 0;
+		size_t cachedManifests = 0;
+		std::vector<BenchResult> results;
+		results.push_back(timeIndex("read Steam", true, builtManifests));
+		results.push_back(timeIndex("cached", false, cachedManifests));
+
+		FindSave finder;
+		ScanStats stats;
+		ScanObserver observer;
+		observer.stats = &stats;
+		finder.SetInstallSources({ summary.steam.u8string() }, cacheFile);
+		Clock::time_point start = Clock::now();
+		finder.ScanSaves(summary.localLow.u8string(), observer);
+		BenchResult scan;
+		scan.name = "scan with index";
+		scan.milliseconds = ElapsedMs(start);
+		scan.directoriesVisited = stats.directoriesVisited;
+		scan.directoriesRead = stats.directoriesRead;
+		scan.filesOpened = stats.filesOpened;
+		scan.bytesRead = stats.bytesRead;
+		scan.pathsProbed = stats.pathsProbed;
+		results.push_back(scan);
+
+		PrintResults("Install index", results);
+		std::printf("  %zu manifests read to build, %zu from the cache, %llu of %zu unknown saves resolved\n",
+			builtManifests, cachedManifests, static_cast<unsigned long long>(stats.unknownResolved.load()), summary.unknown);
+
+		size_t installed = finder.GetSaveIndex().GetRows(SaveClass::Installed).size();
+		size_t unknown = finder.GetSaveIndex().GetRows(SaveClass::Unknown).size();
+		if (installed != summary.installed + summary.steamInstalled || unknown != summary.unknown - summary.steamInstalled)
+		{
+			std::fprintf(stderr, "check: %zu installed and %zu unknown saves with the install index, expected %zu and %zu\n",
+				installed, unknown, summary.installed + summary.steamInstalled, summary.unknown - summary.steamInstalled);
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Times the tree with a game full of replays and recordings added, against the tree without.
+	 *
+	 * With the default walk policy the clutter is never listed and the two take
+	 * the same time, walking everything shows what that saves.
+	 *
+	 * @return False if the clutter changed what the scan found.
+	 */
+	bool BenchPruning(const BenchOptions& options, const SyntheticTreeSummary& summary)
+	{
+		SyntheticTreeOptions clutterOptions = options.tree;
+		clutterOptions.clutterFiles = options.clutterFiles;
+		SyntheticTreeSummary clutter = SyntheticTree::Generate(options.directory / "clutter", clutterOptions);
+		if (!CheckScan(clutter))
+		{
+			return false;
+		}
+
+		std::string files = std::to_string(options.clutterFiles) + " files";
+		PrintResults("Pruning", {
+			TimeScan("no clutter", summary.localLow, options.maxThreads, std::string(), options.iterations),
+			TimeScan("clutter, " + files, clutter.localLow, options.maxThreads, std::string(), options.iterations),
+			TimeScan("clutter, walk all", clutter.localLow, options.maxThreads, std::string(), options.iterations, WalkPolicy::Unbounded()) });
+		return true;
+	}
+
+	/**
+	 * @brief Times the same scan with nothing counted, with stats, and with stats and a trace.
+	 *
+	 * Shows what the instrumentation costs when it is on, and that it costs
+	 * nothing when it is off.
+	 */
+	void BenchInstrumentation(const SyntheticTreeSummary& summary, unsigned int threadCount, int iterations)
+	{
+		std::vector<BenchResult> results;
+		for (int mode = 0; mode < 3; ++mode)
+		{
+			std::vector<double> times;
+			ScanStats stats;
+			size_t traceEvents = 0;
+			for (int i = 0; i < iterations; ++i)
+			{
+				FindSave finder;
+				finder.SetScanThreadCount(threadCount);
+				TraceRecorder trace;
+				stats.Reset();
+				ScanObserver observer;
+				observer.stats = mode >= 1 ? &stats : nullptr;
+				observer.trace = mode == 2 ? &trace : nullptr;
+
+				Clock::time_point start = Clock::now();
+				finder.ScanSaves(summary.localLow.u8string(), observer);
+				times.push_back(ElapsedMs(start));
+				traceEvents = trace.GetEventCount();
+			}
+
+			std::sort(times.begin(), times.end());
+			BenchResult result;
+			result.name = mode == 0 ? "not instrumented" : mode == 1 ? "stats" : "stats + trace, " + std::to_string(traceEvents) + " spans";
+			result.milliseconds = times[times.size() / 2];
+			result.directoriesVisited = stats.directoriesVisited;
+			result.directoriesRead = stats.directoriesRead;
+			result.filesOpened = stats.filesOpened;
+			result.bytesRead = stats.bytesRead;
+			result.pathsProbed = stats.pathsProbed;
+			results.push_back(result);
+		}
+		PrintResults("Instrumentation", results);
+	}
+
+	/**
+	 * @brief Times scanning several LocalLow trees one after another and in one pass.
+	 *
+	 * @param trees The trees, each one a root.
+	 * @param maxThreads Threads shared by every root of the one pass.
+	 * @return Whether the one pass found exactly what the separate scans did.
+	 */
+	bool BenchRoots(const std::vector<SyntheticTreeSummary>& trees, unsigned int maxThreads)
+	{
+		std::vector<std::string> roots;
+		size_t separateSaves = 0;
+		BenchResult separate;
+		separate.name = "one root at a time";
+		Clock::time_point start = Clock::now();
+		for (const SyntheticTreeSummary& tree : trees)
+		{
+			FindSave finder;
+			finder.SetScanThreadCount(maxThreads);
+			finder.ScanSaves(tree.localLow.u8string());
+			separateSaves += finder.GetSaveIndex().GetCount();
+			roots.push_back(tree.localLow.u8string());
+		}
+		separate.milliseconds = ElapsedMs(start);
+
+		FindSave finder;
+		finder.SetScanThreadCount(maxThreads);
+		ScanStats stats;
+		ScanObserver observer;
+		observer.stats = &stats;
+		BenchResult together;
+		together.name = std::to_string(roots.size()) + " roots, one pass";
+		start = Clock::now();
+		finder.ScanRoots(roots, observer);
+		together.milliseconds = ElapsedMs(start);
+		together.directoriesVisited = stats.directoriesVisited;
+		together.directoriesRead = stats.directoriesRead;
+		together.filesOpened = stats.filesOpened;
+		together.bytesRead = stats.bytesRead;
+		together.pathsProbed = stats.pathsProbed;
+
+		PrintResults("Multiple roots", { separate, together });
+
+		size_t saves = finder.GetSaveIndex().GetCount();
+		if (saves != separateSaves)
+		{
+			std::printf("  one pass found %zu saves, separate scans %zu\n", saves, separateSaves);
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Counts the allocations of filling the save index and reading the lists back.
+	 *
+	 * The scan results are handed to the index company by company, the way the GUI
+	 * gets them, once into a fresh index and once into the same index after Clear.
+	 * Reading every row's name and path back must not allocate at all.
+	 *
+	 * @return Whether the refill and the reads stayed allocation free.
+	 */
+	bool BenchIndex(const SyntheticTreeSummary& summary)
+	{
+		std::mutex resultsMutex;
+		std::vector<std::pair<std::string, std::vector<SaveEntry>>> scanned;
+		ScanObserver observer;
+		observer.onCompanyScanned = [&resultsMutex, &scanned](const std::string& companyPath, const std::vector<SaveEntry>& saves, size_t, size_t)
+			{
+				std::lock_guard<std::mutex> lock(resultsMutex);
+				scanned.emplace_back(companyPath, saves);
+			};
+
+		BenchResult scan;
+		scan.name = "scan into index";
+		FindSave scanner;
+		uint64_t before = allocationCount;
+		Clock::time_point start = Clock::now();
+		scanner.ScanSaves(summary.localLow.u8string(), observer);
+		scan.milliseconds = ElapsedMs(start);
+		scan.allocations = allocationCount - before;
+
+		FindSave finder;
+		auto fill = [&finder, &scanned](const std::string& name)
+			{
+				BenchResult result;
+				result.name = name;
+				uint64_t fillBefore = allocationCount;
+				Clock::time_point fillStart = Clock::now();
+				for (const auto& company : scanned)
+				{
+					finder.AddCompanySaves(company.first, company.second);
+				}
+				result.milliseconds = ElapsedMs(fillStart);
+				result.allocations = allocationCount - fillBefore;
+				return result;
+			};
+		BenchResult cold = fill("fill index, new");
+		finder.ClearSaves();
+		BenchResult warm = fill("fill index, after Clear");
+
+		BenchResult read;
+		read.name = "read every row";
+		const SaveIndex& index = finder.GetSaveIndex();
+		size_t nameBytes = 0;
+		before = allocationCount;
+		start = Clock::now();
+		for (SaveClass classification : { SaveClass::Installed, SaveClass::Unlinked, SaveClass::Unknown })
+		{
+			for (size_t entry : index.GetRows(classification))
+			{
+				nameBytes += index.GetGameName(entry).size() + index.GetGamePath(entry).size();
+			}
+		}
+		read.milliseconds = ElapsedMs(start);
+		read.allocations = allocationCount - before;
+
+		PrintResults("Save index", { scan, cold, warm, read });
+		std::printf("  %zu saves, %zu arena bytes, %zu bytes read back\n", index.GetCount(), index.GetArenaBytes(), nameBytes);
+
+		bool correct = warm.allocations == 0 && read.allocations == 0;
+		if (!correct)
+		{
+			std::printf("  index allocated after Clear or on read\n");
+		}
+		return correct;
+	}
+
+	/**
+	 * @brief Times measuring every unlinked and unknown save, on one thread and on all of them.
+	 *
+	 * The totals are checked against a plain single threaded walk, and the sizes
+	 * against the index: current until a save folder's mtime moves on.
+	 *
+	 * @return Whether the sizes added up and the index took them.
+	 */
+	bool BenchSizes(const SyntheticTreeSummary& summary, unsigned int maxThreads)
+	{
+		FindSave finder;
+		finder.ScanSaves(summary.localLow.u8string());
+		std::vector<std::string> paths = GetDeletablePaths(finder.GetSaveIndex());
+
+		uint64_t expectedBytes = 0;
+		uint64_t expectedFiles = 0;
+		for (const std::string& path : paths)
+		{
+			for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(std::filesystem::u8path(path)))
+			{
+				if (!entry.is_directory())
+				{
+					++expectedFiles;
+					expectedBytes += entry.is_regular_file() ? entry.file_size() : 0;
+				}
+			}
+		}
+
+		std::vector<unsigned int> threadCounts = { 1 };
+		if (maxThreads > 1)
+		{
+			threadCounts.push_back(maxThreads);
+		}
+
+		std::vector<BenchResult> results;
+		bool correct = true;
+		for (unsigned int threads : threadCounts)
+		{
+			std::mutex sizesMutex;
+			uint64_t bytes = 0;
+			uint64_t files = 0;
+			SizeObserver observer;
+			observer.onMeasured = [&](const std::string& path, const FolderSize& size)
+				{
+					std::lock_guard<std::mutex> lock(sizesMutex);
+					bytes += size.bytes;
+					files += size.files;
+					finder.SetSaveSize(path, size);
+				};
+
+			SizeAggregator aggregator;
+			aggregator.SetThreadCount(threads);
+			BenchResult result;
+			result.name = "measure " + std::to_string(paths.size()) + " saves, " + std::to_string(threads) + " threads";
+			Clock::time_point start = Clock::now();
+			aggregator.MeasureAll(paths, observer);
+			result.milliseconds = ElapsedMs(start);
+			result.bytesRead = bytes;
+			results.push_back(result);
+
+			if (bytes != expectedBytes || files != expectedFiles)
+			{
+				std::printf("  measured %llu bytes in %llu files, expected %llu in %llu\n",
+					static_cast<unsigned long long>(bytes), static_cast<unsigned long long>(files),
+					static_cast<unsigned long long>(expectedBytes), static_cast<unsigned long long>(expectedFiles));
+				correct = false;
+			}
+		}
+		PrintResults("Save sizes", results);
+		std::printf("  %llu files, %llu bytes in the saves\n", static_cast<unsigned long long>(expectedFiles), static_cast<unsigned long long>(expectedBytes));
+
+		// a rescan keeps the sizes of folders that haven't changed.
+		finder.ClearSaves();
+		finder.ScanSaves(summary.localLow.u8string());
+		const SaveIndex& index = finder.GetSaveIndex();
+		size_t sized = 0;
+		for (SaveClass classification : { SaveClass::Unlinked, SaveClass::Unknown })
+		{
+			for (size_t entry : index.GetRows(classification))
+			{
+				sized += index.GetSize(entry) != nullptr ? 1 : 0;
+			}
+		}
+		if (sized != paths.size())
+		{
+			std::printf("  %zu of %zu sizes survived a rescan\n", sized, paths.size());
+			correct = false;
+		}
+		return correct;
+	}
+
+	/**
+	 * @brief Times deleting every unlinked and unknown save, as the Delete button would.
+	 *
+	 * Only the folders are removed. PlayerPrefs are left alone, the generated saves
+	 * have none and the registry is no place for benchmarks.
+	 */
+	void BenchDeletion(const SyntheticTreeSummary& summary)
+	{
+		FindSave finder;
+		finder.ScanSaves(summary.localLow.u8string());
+
+		std::vector<std::string> paths = GetDeletablePaths(finder.GetSaveIndex());
+
+		BenchResult result;
+		result.name = "DeletionEngine, " + std::to_string(paths.size()) + " saves";
+		Clock::time_point start = Clock::now();
+		DeletionEngine engine;
+		DeletionSummary deletion = engine.DeleteAll(paths);
+		finder.RemoveEmptyFolders();
+		result.milliseconds = ElapsedMs(start);
+
+		PrintResults("Deletion", { result });
+		std::printf("  %llu files, %llu bytes removed, %zu failures\n",
+			static_cast<unsigned long long>(deletion.filesRemoved),
+			static_cast<unsigned long long>(deletion.bytesRemoved),
+			deletion.errors.size());
+	}
+
+	/**
+	 * @brief Times zipping saves, alone and pipelined with deleting them, for many small files against a few large ones.
+	 *
+	 * Both shapes hold the same bytes. Every small file costs a task, a local
+	 * header and a central directory entry, the large ones are cut into chunks
+	 * that compress side by side. Pipelined, each save is deleted while the ones
+	 * after it are still being compressed, against zipping everything first.
+	 *
+	 * @return False if a save went missing from the zip, or wasn't deleted after it.
+	 */
+	bool BenchArchive(const BenchOptions& options)
+	{
+		struct Shape
+		{
+			std::string name;
+			size_t saves;
+			size_t filesPerSave;
+			size_t fileBytes;
+		};
+		const Shape shapes[] = {
+			{ "small files", 300, 20, 4 * 1024 },
+			{ "large files", 3, 2, 4 * 1024 * 1024 } };
+
+		std::filesystem::path base = options.directory / "archive";
+		std::string archiveFile = (options.directory / "saves.zip").u8string();
+		bool correct = true;
+		for (const Shape& shape : shapes)
+		{
+			std::vector<std::string> paths;
+			uint64_t bytes = 0;
+			auto generate = [&]()
+				{
+					std::error_code error;
+					std::filesystem::remove_all(base, error);
+					paths.clear();
+					bytes = 0;
+					for (size_t i = 0; i < shape.saves; ++i)
+					{
+						std::filesystem::path save = base / ("Company " + std::to_string(i % 10)) / ("Game " + std::to_string(i));
+						bytes += SyntheticTree::WriteSaveFiles(save, shape.filesPerSave, shape.fileBytes, static_cast<uint32_t>(i + 1));
+						paths.push_back(save.u8string());
+					}
+				};
+			auto printRow = [&](const std::string& name, double milliseconds, uint64_t archiveBytes)
+				{
+					std::printf("  %-30s %9.1f ms %8.1f MB/s, zip is %.0f%% of the saves\n", name.c_str(), milliseconds,
+						static_cast<double>(bytes) / 1000.0 / std::max(milliseconds, 0.001),
+						100.0 * static_cast<double>(archiveBytes) / static_cast<double>(std::max<uint64_t>(1, bytes)));
+				};
+			auto check = [&](const std::string& name, const ArchiveSummary& archive)
+				{
+					if (!archive.error.empty() || archive.itemsArchived != shape.saves
+						|| archive.filesArchived != shape.saves * shape.filesPerSave || archive.bytesRead != bytes)
+					{
+						std::fprintf(stderr, "check: %s zipped %zu saves, %llu files, %llu bytes, expected %zu, %zu, %llu %s\n",
+							name.c_str(), archive.itemsArchived, static_cast<unsigned long long>(archive.filesArchived),
+							static_cast<unsigned long long>(archive.bytesRead), shape.saves, shape.saves * shape.filesPerSave,
+							static_cast<unsigned long long>(bytes), archive.error.c_str());
+						correct = false;
+					}
+				};
+
+			generate();
+			std::printf("\nArchive, %s: %zu saves of %zu x %zu bytes\n", shape.name.c_str(), shape.saves, shape.filesPerSave, shape.fileBytes);
+			std::vector<unsigned int> threadCounts = { 1 };
+			if (options.maxThreads > 1)
+			{
+				threadCounts.push_back(options.maxThreads);
+			}
+			for (unsigned int threads : threadCounts)
+			{
+				ThreadPool pool(threads);
+				SaveArchiver archiver;
+				Clock::time_point start = Clock::now();
+				ArchiveSummary archive = archiver.ArchiveAll(paths, archiveFile, pool);
+				std::string name = "zip, " + std::to_string(threads) + " threads";
+				printRow(name, ElapsedMs(start), archive.bytesWritten);
+				check(name, archive);
+			}
+
+			{
+				Clock::time_point start = Clock::now();
+				ThreadPool pool(options.maxThreads);
+				SaveArchiver archiver;
+				ArchiveSummary archive = archiver.ArchiveAll(paths, archiveFile, pool);
+				DeletionEngine engine;
+				engine.SetThreadCount(options.maxThreads);
+				engine.DeleteAll(paths);
+				printRow("zip, then delete", ElapsedMs(start), archive.bytesWritten);
+				check("zip, then delete", archive);
+			}
+
+			generate();
+			DeletionEngine engine;
+			engine.SetThreadCount(options.maxThreads);
+			engine.SetArchive(archiveFile);
+			Clock::time_point start = Clock::now();
+			DeletionSummary deletion = engine.DeleteAll(paths);
+			printRow("zip and delete, pipelined", ElapsedMs(start), deletion.archive.bytesWritten);
+			check("zip and delete, pipelined", deletion.archive);
+			if (deletion.itemsDeleted != shape.saves || !deletion.errors.empty())
+			{
+				std::fprintf(stderr, "check: %zu of %zu zipped saves deleted\n", deletion.itemsDeleted, shape.saves);
+				correct = false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::remove_all(base, error);
+		std::filesystem::remove(std::filesystem::u8path(archiveFile), error);
+		return correct;
+	}
+
+	/**
+	 * @brief Removes what the benchmarks built under a folder, and the folder if that leaves it empty.
+	 *
+	 * Nothing else in the folder is touched, it may well be one the user works in.
+	 *
+	 * @param directory The folder given with --dir.
+	 */
+	void RemoveBenchFiles(const std::filesystem::path& directory)
+	{
+		std::error_code error;
+		for (const char* folder : { "deep", "flat", "steam", "clutter", "archive" })
+		{
+			std::filesystem::remove_all(directory / folder, error);
+		}
+		for (const char* file : { "bench.snapshot", "installs.cache", "saves.zip" })
+		{
+			std::filesystem::remove(directory / file, error);
+		}
+		// fails, as it should, unless the folder is now empty
+		std::filesystem::remove(directory, error);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	BenchOptions options;
+	if (!ParseArguments(argc, argv, options))
+	{
+		PrintUsage();
+		return EXIT_BAD_ARGUMENTS;
+	}
+
+	Clock::time_point start = Clock::now();
+	SyntheticTreeSummary summary = SyntheticTree::Generate(options.directory / "deep", options.tree);
+	std::printf("Generated %zu folders, %zu Player.log, %zu output_log.txt (%llu log bytes) in %.0f ms\n",
+		summary.directories, summary.playerLogs, summary.outputLogs,
+		static_cast<unsigned long long>(summary.logBytes), ElapsedMs(start));
+	std::printf("Expecting %zu installed, %zu unlinked, %zu unknown saves\n", summary.installed, summary.unlinked, summary.unknown);
+
+	if (!CheckScan(summary))
+	{
+		return EXIT_WRONG_RESULTS;
+	}
+
+	// full scans, doubling the threads up to the limit.
+	std::vector<BenchResult> results;
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < options.maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(options.maxThreads);
+	for (unsigned int threads : threadCounts)
+	{
+		results.push_back(TimeScan("full scan, " + std::to_string(threads) + " threads", summary.localLow, threads, std::string(), options.iterations));
+	}
+	PrintResults("Full scan", results);
+
+	// the same again, with the snapshot of an unchanged tree to go on.
+	std::string snapshotPath = (options.directory / "bench.snapshot").u8string();
+	TimeScan("warm up", summary.localLow, options.maxThreads, snapshotPath, 1);
+	PrintResults("Rescan", {
+		TimeScan("no snapshot", summary.localLow, options.maxThreads, std::string(), options.iterations),
+		TimeScan("unchanged snapshot", summary.localLow, options.maxThreads, snapshotPath, options.iterations) });
+
+	// the same number of folders, all at save level instead of nested under the saves.
+	SyntheticTreeOptions flatOptions = options.tree;
+	size_t extraFolders = 0;
+	size_t levelFolders = 1;
+	for (size_t depth = 0; depth < options.tree.nestingDepth; ++depth)
+	{
+		levelFolders *= options.tree.foldersPerLevel;
+		extraFolders += levelFolders;
+	}
+	flatOptions.gamesPerCompany = options.tree.gamesPerCompany * (1 + extraFolders);
+	flatOptions.nestingDepth = 0;
+	SyntheticTreeSummary flat = SyntheticTree::Generate(options.directory / "flat", flatOptions);
+	PrintResults("Tree shape", {
+		TimeScan("deep, " + std::to_string(summary.directories) + " folders", summary.localLow, options.maxThreads, std::string(), options.iterations),
+		TimeScan("flat, " + std::to_string(flat.directories) + " folders", flat.localLow, options.maxThreads, std::string(), options.iterations) });
+
+	BenchInstrumentation(summary, options.maxThreads, options.iterations);
+
+	BenchListing(options, summary);
+
+	bool correct = BenchLogReading(options, flat);
+	correct = BenchPruning(options, summary) && correct;
+	correct = BenchInstallIndex(options) && correct;
+	correct = BenchRoots({ summary, flat }, options.maxThreads) && correct;
+	correct = BenchLogParsing(summary, options.iterations) && correct;
+	correct = BenchPlayerPrefs(summary) && correct;
+	correct = BenchIndex(summary) && correct;
+	correct = BenchSizes(summary, options.maxThreads) && correct;
+	BenchDeletion(summary);
+	correct = BenchArchive(options) && correct;
+
+	if (!options.keep)
+	{
+		RemoveBenchFiles(options.directory);
+	}
+
+	return correct ? 0 : EXIT_WRONG_RESULTS;
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <string>
 #include <utility>
 
@@ -6,7 +7,7 @@
 namespace CONSTANT
 {
 	const std::string APP_NAME = "Unity Save Deleter";
-	const std::pair<int, int> RESOLUTION = std::make_pair(700, 500);
+	const std::pair<int, int> RESOLUTION = std::make_pair(700, 540);
 	
 	const std::pair<int, int> RESCAN_BUTTON_POS = std::make_pair(40, 455);
 	const std::pair<int, int> RESCAN_BUTTON_SIZE = std::make_pair(100, 35);
@@ -15,12 +16,96 @@ namespace CONSTANT
 	const std::pair<int, int> DELETE_BUTTON_SIZE = std::make_pair(100, 35);
 	
 	const std::pair<int, int> LISTBOX_POS = std::make_pair(26, 50);
-	const std::pair<int, int> LISTBOX_SIZE = std::make_pair(300, 400);
+	const std::pair<int, int> LISTBOX_SIZE = std::make_pair(300, 380);
+	const int LIST_SIZE_COLUMN_WIDTH = 80;
+
+	// what the checked saves of a list add up to, under the list.
+	const std::pair<int, int> CHECKED_TOTAL_POS = std::make_pair(26, 433);
 	
 	const std::pair<int, int> LIST_TITLE_POS = std::make_pair(50, 25);
 
+	const std::pair<int, int> SCAN_GAUGE_POS = std::make_pair(26, 503);
+	const std::pair<int, int> SCAN_GAUGE_SIZE = std::make_pair(320, 20);
+
+	// zip the checked saves before deleting them, next to the progress bar.
+	const std::pair<int, int> ARCHIVE_CHECKBOX_POS = std::make_pair(356, 505);
+
+	const std::pair<int, int> CANCEL_BUTTON_POS = std::make_pair(576, 498);
+	const std::pair<int, int> CANCEL_BUTTON_SIZE = std::make_pair(100, 30);
+
+	const std::pair<int, int> UNDO_BUTTON_POS = std::make_pair(466, 498);
+	const std::pair<int, int> UNDO_BUTTON_SIZE = std::make_pair(100, 30);
+
+	// debug panel, Ctrl+Shift+D, with the last scan's counters and a trace export.
+	const std::pair<int, int> DEBUG_PANEL_SIZE = std::make_pair(440, 420);
+	const std::pair<int, int> DEBUG_TEXT_POS = std::make_pair(10, 10);
+	const std::pair<int, int> DEBUG_TEXT_SIZE = std::make_pair(404, 320);
+	const std::pair<int, int> DEBUG_REFRESH_BUTTON_POS = std::make_pair(10, 340);
+	const std::pair<int, int> DEBUG_EXPORT_BUTTON_POS = std::make_pair(120, 340);
+	const std::pair<int, int> DEBUG_BUTTON_SIZE = std::make_pair(100, 30);
+
 	const std::string UNLINKED_FORM_TITLE = "Unity saves with no game in system:";
 	const std::string UNKNOWN_FORM_TITLE = "Unity saves with ??? game in system:";
 
 	const int FORM_X_OFFSET = 350;
+
+	// threads used to scan LocalLow, 0 means one per hardware thread.
+	const unsigned int SCAN_THREAD_COUNT = 0;
+	// folder listings and log reads a scan has in flight at once, across all
+	// roots and threads, 0 means as many as there are threads.
+	const unsigned int SCAN_IO_LIMIT = 16;
+	// folder levels walked below a company: 1 is the game folders, 2 what is in them, 0 walks everything.
+	const size_t SCAN_MAX_DEPTH = 4;
+	// folders below a company that are never walked into, by name or glob (* and ?), in any case.
+	const char* const SCAN_SKIP_FOLDERS[] = { "Screenshot*", "Replays", "Mods", "*Cache" };
+
+	// scan results are posted to the GUI once this many saves have piled up,
+	// or once this long has passed since the last post.
+	const size_t SCAN_BATCH_SIZE = 64;
+	const int SCAN_BATCH_INTERVAL_MS = 100;
+
+	// how much of each Player.log is read to find the game path.
+	const size_t LOG_HEADER_BYTES = 64 * 1024;
+	// Player.logs in flight on the io_uring when the scan has no I/O limit, see LogBatchReader.
+	const unsigned int LOG_RING_DEPTH = 64;
+
+	// where the last scan is kept, inside LocalAppData.
+	const wchar_t* const SNAPSHOT_FOLDER = L"Unity Save Deleter";
+	const wchar_t* const SNAPSHOT_FILE = L"scan.snapshot";
+	// next to it, the launchers' installed games, see InstallIndex.
+	const wchar_t* const INSTALL_INDEX_FILE = L"installs.cache";
+
+	// watch mode reports a company folder once it has had no changes for
+	// WATCH_DEBOUNCE_MS, or WATCH_MAX_DELAY_MS after its first change at the latest.
+	const int WATCH_DEBOUNCE_MS = 500;
+	const int WATCH_MAX_DELAY_MS = 5000;
+	// folder levels watched where watches aren't recursive: 1 is companies, 2 is games.
+	const int WATCH_DEPTH = 2;
+	const size_t WATCH_BUFFER_BYTES = 64 * 1024;
+
+	// threads used to delete saves, 0 means one per hardware thread.
+	const unsigned int DELETE_THREAD_COUNT = 0;
+	// deletion progress is posted to the GUI at most this often.
+	const int DELETE_PROGRESS_INTERVAL_MS = 100;
+	// failed deletions listed in the summary, the rest are only counted.
+	const size_t DELETE_ERRORS_SHOWN = 10;
+	// archive before delete: files go into the zip in chunks of ARCHIVE_CHUNK_BYTES,
+	// each deflated on its own, with at most ARCHIVE_CHUNKS_IN_FLIGHT read and not yet written.
+	const size_t ARCHIVE_CHUNK_BYTES = 256 * 1024;
+	const size_t ARCHIVE_CHUNKS_IN_FLIGHT = 64;
+	// zlib level, 1 is fastest and 9 smallest.
+	const int ARCHIVE_COMPRESSION_LEVEL = 6;
+
+	// deleted saves are moved here (next to the snapshot) and purged once they
+	// can't be undone any more, UNDO_WINDOW_MS after the delete.
+	const wchar_t* const STAGING_FOLDER = L"staging";
+	const int UNDO_WINDOW_MS = 30000;
+	// threads the purger deletes with, at low priority.
+	const unsigned int PURGE_THREAD_COUNT = 1;
+
+	// threads save folder sizes are measured with, at low priority, 0 means one per hardware thread.
+	const unsigned int SIZE_THREAD_COUNT = 0;
+
+	// a Wine prefix's user.reg is rewritten through a buffer this big, see UserRegPlayerPrefsBackend.
+	const size_t USER_REG_WRITE_BYTES = 64 * 1024;
 }
\ No newline at end of file
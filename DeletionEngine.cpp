@@ -0,0 +1,368 @@
+#include "DeletionEngine.h"
+#include <deque>
+#include <utility>
+
+
+/**
+ * @brief Deletes save folders and everything in them, blocking until done.
+ *
+ * Symlinks and junctions are removed, never followed. A folder that is already
+ * gone counts as deleted. Failures don't stop the batch, each save records the
+ * first thing that went wrong with it and the rest of it is still attempted.
+ * When archiving first, a save that couldn't be archived completely is left
+ * where it is, and so is every save after it if the archive can't be written.
+ * A save is only deleted once it is synced to disk in the zip.
+ *
+ * @param paths Save folders in UTF-8.
+ * @param observer Gets progress and each save folder as it goes.
+ * @return What was deleted, and what wasn't.
+ */
+DeletionSummary DeletionEngine::DeleteAll(const std::vector<std::string>& paths, const DeletionObserver& observer)
+{
+	std::deque<Item> items;
+	for (const std::string& path : paths)
+	{
+		items.emplace_back();
+		items.back().path = path;
+	}
+
+	ThreadPool pool(threadCount, background);
+	DeletionRun run{ pool, observer, items.size(), std::chrono::steady_clock::now() };
+	DeletionSummary summary;
+	if (archiveFile.empty())
+	{
+		for (Item& item : items)
+		{
+			StartItem(run, item);
+		}
+	}
+	else
+	{
+		ArchiveObserver archiveObserver;
+		archiveObserver.cancelled = observer.cancelled;
+		archiveObserver.trace = observer.trace;
+		archiveObserver.onItemArchived = [this, &run, &items](size_t index)
+			{
+				items[index].archived = true;
+				++run.itemsArchived;
+				StartItem(run, items[index]);
+			};
+		archiveObserver.onItemFailed = [this, &run, &items](size_t index, const std::string& error)
+			{
+				Item& item = items[index];
+				item.archived = true;
+				item.error = "not archived, " + error;
+				++run.itemsDone;
+				ReportProgress(run, true);
+			};
+
+		SaveArchiver archiver;
+		summary.archive = archiver.ArchiveAll(paths, archiveFile, pool, archiveObserver);
+
+		// whatever wasn't handed on is left as it was.
+		for (Item& item : items)
+		{
+			if (!item.archived)
+			{
+				if (!summary.archive.error.empty())
+				{
+					item.error = "not archived, " + summary.archive.error;
+				}
+				++run.itemsDone;
+			}
+		}
+		ReportProgress(run, true);
+	}
+	pool.Wait();
+
+	summary.itemCount = items.size();
+	summary.itemsDeleted = run.itemsDeleted;
+	summary.filesRemoved = run.filesRemoved;
+	summary.bytesRemoved = run.bytesRemoved;
+	summary.foldersRemoved = run.foldersRemoved;
+	summary.milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - run.startTime).count();
+	summary.cancelled = IsCancelled(observer);
+	for (const Item& item : items)
+	{
+		if (!item.error.empty())
+		{
+			summary.errors.push_back({ item.path, item.error });
+		}
+	}
+	return summary;
+}
+/**
+ * @brief Sets how many threads DeleteAll uses.
+ *
+ * @param threadCount Number of worker threads, 0 uses one per hardware thread.
+ */
+void DeletionEngine::SetThreadCount(unsigned int threadCount)
+{
+	this->threadCount = threadCount;
+}
+/**
+ * @brief Makes DeleteAll run at low priority, so it doesn't get in the way of anything else.
+ */
+void DeletionEngine::SetBackground(bool background)
+{
+	this->background = background;
+}
+/**
+ * @brief Makes DeleteAll write every save into a zip before deleting it.
+ *
+ * @param archiveFile The zip in UTF-8, replaced if it exists. Empty deletes without archiving.
+ */
+void DeletionEngine::SetArchive(const std::string& archiveFile)
+{
+	this->archiveFile = archiveFile;
+}
+/**
+ * @brief Hands a save folder to the pool to be deleted.
+ *
+ * @param run The deletion the save folder belongs to.
+ * @param item The save folder.
+ */
+void DeletionEngine::StartItem(DeletionRun& run, Item& item)
+{
+	run.pool.Submit([this, &run, &item]()
+		{
+			if (run.observer.trace != nullptr)
+			{
+				item.startTime = std::chrono::steady_clock::now();
+			}
+			std::shared_ptr<Folder> root = std::make_shared<Folder>();
+			root->path = std::filesystem::u8path(item.path);
+			root->item = &item;
+			DeleteFolder(run, root);
+		});
+}
+/**
+ * @brief Empties one folder, handing its subfolders to the pool.
+ *
+ * Entries are listed before anything is removed, so the listing never has
+ * to cope with the folder changing under it.
+ *
+ * @param run The deletion this folder belongs to.
+ * @param folder The folder to empty, removed once its subfolders are.
+ */
+void DeletionEngine::DeleteFolder(DeletionRun& run, const std::shared_ptr<Folder>& folder)
+{
+	Item& item = *folder->item;
+	if (IsCancelled(run.observer))
+	{
+		FinishFolder(run, folder);
+		return;
+	}
+	TraceRecorder::Span span(run.observer.trace, "empty folder", "delete");
+
+	std::error_code error;
+
+	// a save folder that is really a link only loses the link.
+	std::filesystem::file_status status = std::filesystem::symlink_status(folder->path, error);
+	if (!folder->parent && (error || status.type() != std::filesystem::file_type::directory))
+	{
+		if (status.type() != std::filesystem::file_type::not_found)
+		{
+			std::filesystem::remove(folder->path, error);
+			if (error)
+			{
+				AddError(item, folder->path, error);
+			}
+		}
+		FinishItem(run, item);
+		return;
+	}
+
+	std::vector<std::filesystem::directory_entry> entries;
+	for (std::filesystem::directory_iterator it(folder->path, error), end; !error && it != end; it.increment(error))
+	{
+		entries.push_back(*it);
+	}
+	if (error)
+	{
+		AddError(item, folder->path, error);
+	}
+
+	for (const std::filesystem::directory_entry& entry : entries)
+	{
+		if (IsCancelled(run.observer))
+		{
+			break;
+		}
+
+		std::error_code entryError;
+		if (entry.symlink_status(entryError).type() == std::filesystem::file_type::directory)
+		{
+			std::shared_ptr<Folder> child = std::make_shared<Folder>();
+			child->path = entry.path();
+			child->parent = folder;
+			child->item = &item;
+			++folder->pendingTasks;
+			run.pool.Submit([this, &run, child]() { DeleteFolder(run, child); });
+		}
+		else
+		{
+			RemoveFile(run, item, entry);
+		}
+	}
+
+	ReportProgress(run, false);
+	FinishFolder(run, folder);
+}
+/**
+ * @brief Removes one file, or a link without following it.
+ *
+ * If it can't be removed, the error goes on the item.
+ */
+void DeletionEngine::RemoveFile(DeletionRun& run, Item& item, const std::filesystem::directory_entry& entry)
+{
+	std::error_code error;
+	uint64_t size = 0;
+	if (entry.symlink_status(error).type() == std::filesystem::file_type::regular)
+	{
+		size = entry.file_size(error);
+		if (error)
+		{
+			size = 0;
+		}
+	}
+
+	std::filesystem::remove(entry.path(), error);
+	if (error)
+	{
+		AddError(item, entry.path(), error);
+		return;
+	}
+
+	++run.filesRemoved;
+	run.bytesRemoved += size;
+}
+/**
+ * @brief Marks one of a folder's tasks as done, removing the folder once all are.
+ *
+ * The folder is empty by then unless something in it failed or the deletion
+ * was cancelled. Finishing a folder finishes one task of its parent, and
+ * finishing the save folder itself finishes the item.
+ *
+ * @param run The deletion this folder belongs to.
+ * @param folder The folder the task worked on.
+ */
+void DeletionEngine::FinishFolder(DeletionRun& run, const std::shared_ptr<Folder>& folder)
+{
+	if (--folder->pendingTasks != 0)
+	{
+		return;
+	}
+
+	if (!IsCancelled(run.observer))
+	{
+		std::error_code error;
+		std::filesystem::remove(folder->path, error);
+		if (error)
+		{
+			AddError(*folder->item, folder->path, error);
+		}
+		else
+		{
+			++run.foldersRemoved;
+		}
+	}
+
+	if (folder->parent)
+	{
+		FinishFolder(run, folder->parent);
+	}
+	else
+	{
+		FinishItem(run, *folder->item);
+	}
+}
+/**
+ * @brief Counts a save folder as done, and tells the observer if it is gone.
+ *
+ * @param run The deletion this item belongs to.
+ * @param item The save folder that has been dealt with.
+ */
+void DeletionEngine::FinishItem(DeletionRun& run, Item& item)
+{
+	bool failed = false;
+	{
+		std::lock_guard<std::mutex> lock(item.errorMutex);
+		failed = !item.error.empty();
+	}
+
+	if (run.observer.trace != nullptr)
+	{
+		run.observer.trace->Record("delete save", "delete", item.startTime, std::chrono::steady_clock::now(), item.path);
+	}
+
+	if (!failed && !IsCancelled(run.observer))
+	{
+		++run.itemsDeleted;
+		if (run.observer.onItemDeleted)
+		{
+			run.observer.onItemDeleted(item.path);
+		}
+	}
+
+	++run.itemsDone;
+	ReportProgress(run, true);
+}
+/**
+ * @brief Sends the observer the progress so far.
+ *
+ * @param run The deletion to report.
+ * @param force Report even if the last report was less than DELETE_PROGRESS_INTERVAL_MS ago.
+ */
+void DeletionEngine::ReportProgress(DeletionRun& run, bool force)
+{
+	if (!run.observer.onProgress)
+	{
+		return;
+	}
+
+	int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - run.startTime).count();
+	int64_t last = run.lastProgressMs;
+	if (!force)
+	{
+		// only the thread that moves the time on gets to report.
+		if (now - last < CONSTANT::DELETE_PROGRESS_INTERVAL_MS || !run.lastProgressMs.compare_exchange_strong(last, now))
+		{
+			return;
+		}
+	}
+	else
+	{
+		run.lastProgressMs = now;
+	}
+
+	DeletionProgress progress;
+	progress.itemsDone = run.itemsDone;
+	progress.itemCount = run.itemCount;
+	progress.itemsArchived = run.itemsArchived;
+	progress.filesRemoved = run.filesRemoved;
+	progress.bytesRemoved = run.bytesRemoved;
+	run.observer.onProgress(progress);
+}
+/**
+ * @brief Records what went wrong with a save folder, if nothing has yet.
+ *
+ * @param item The save folder.
+ * @param path What couldn't be removed or read.
+ * @param error Why.
+ */
+void DeletionEngine::AddError(Item& item, const std::filesystem::path& path, const std::error_code& error)
+{
+	std::lock_guard<std::mutex> lock(item.errorMutex);
+	if (item.error.empty())
+	{
+		item.error = path.u8string() + ": " + error.message();
+	}
+}
+/**
+ * @brief Checks whether the observer asked for the deletion to stop.
+ */
+bool DeletionEngine::IsCancelled(const DeletionObserver& observer)
+{
+	return observer.cancelled != nullptr && observer.cancelled->load();
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "Constants.h"
+#include "SaveArchiver.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+
+// How far a deletion has got.
+struct DeletionProgress
+{
+	size_t itemsDone = 0;
+	size_t itemCount = 0;
+	// only when archiving first
+	size_t itemsArchived = 0;
+	uint64_t filesRemoved = 0;
+	uint64_t bytesRemoved = 0;
+};
+
+// A save folder that couldn't be fully deleted, and the first thing that went wrong.
+struct DeletionError
+{
+	std::string path;
+	std::string message;
+};
+
+// How a whole deletion went.
+struct DeletionSummary
+{
+	size_t itemCount = 0;
+	size_t itemsDeleted = 0;
+	uint64_t filesRemoved = 0;
+	uint64_t bytesRemoved = 0;
+	uint64_t foldersRemoved = 0;
+	// wall time of the whole batch
+	int64_t milliseconds = 0;
+	// what went into the archive first, if there was one
+	ArchiveSummary archive;
+	std::vector<DeletionError> errors;
+	bool cancelled = false;
+};
+
+// Optional hooks into a running deletion. Called from the worker threads,
+// so whatever they do has to be thread safe.
+struct DeletionObserver
+{
+	// at most every DELETE_PROGRESS_INTERVAL_MS, and whenever a save folder is done
+	std::function<void(const DeletionProgress& progress)> onProgress;
+	// a save folder is completely gone, e.g. to clear its PlayerPrefs
+	std::function<void(const std::string& path)> onItemDeleted;
+	// set to true from any thread to stop early, what's gone stays gone
+	const std::atomic<bool>* cancelled = nullptr;
+	// gets a span per folder emptied and per save folder start to finish, optional
+	TraceRecorder* trace = nullptr;
+};
+
+// Deletes a batch of save folders on a thread pool.
+//
+// Every folder of every save is its own task, so one huge save is spread over
+// the pool as much as many small ones are. A folder is removed by whichever of
+// its subfolder tasks finishes last, once it is empty.
+//
+// With an archive set, the saves are written into it by SaveArchiver on the
+// same pool, and each save is only deleted once all of it is in the archive.
+// Deleting one save goes on alongside compressing the next.
+class DeletionEngine
+{
+public:
+	DeletionSummary DeleteAll(const std::vector<std::string>& paths, const DeletionObserver& observer = DeletionObserver());
+	void SetThreadCount(unsigned int threadCount);
+	void SetBackground(bool background);
+	void SetArchive(const std::string& archiveFile);
+
+private:
+	// one save folder of the batch.
+	struct Item
+	{
+		std::string path;
+		// when its first task started, for the trace
+		std::chrono::steady_clock::time_point startTime;
+		std::mutex errorMutex;
+		// first failure, later ones are usually caused by it
+		std::string error;
+		// archived (or failed to be) and handed on, only when archiving first
+		bool archived = false;
+	};
+
+	// one folder inside a save, alive until it and all its subfolders are gone.
+	struct Folder
+	{
+		std::filesystem::path path;
+		std::shared_ptr<Folder> parent;
+		Item* item = nullptr;
+		// this folder's own task plus one per subfolder
+		std::atomic<size_t> pendingTasks{ 1 };
+	};
+
+	// state shared by every task of one DeleteAll call.
+	struct DeletionRun
+	{
+		ThreadPool& pool;
+		const DeletionObserver& observer;
+		size_t itemCount;
+		std::chrono::steady_clock::time_point startTime;
+		std::atomic<size_t> itemsDone{ 0 };
+		std::atomic<size_t> itemsDeleted{ 0 };
+		std::atomic<size_t> itemsArchived{ 0 };
+		std::atomic<uint64_t> filesRemoved{ 0 };
+		std::atomic<uint64_t> bytesRemoved{ 0 };
+		std::atomic<uint64_t> foldersRemoved{ 0 };
+		// milliseconds after startTime of the last progress report
+		std::atomic<int64_t> lastProgressMs{ 0 };
+	};
+
+	void StartItem(DeletionRun& run, Item& item);
+	void DeleteFolder(DeletionRun& run, const std::shared_ptr<Folder>& folder);
+	void RemoveFile(DeletionRun& run, Item& item, const std::filesystem::directory_entry& entry);
+	void FinishFolder(DeletionRun& run, const std::shared_ptr<Folder>& folder);
+	void FinishItem(DeletionRun& run, Item& item);
+	void ReportProgress(DeletionRun& run, bool force);
+	static void AddError(Item& item, const std::filesystem::path& path, const std::error_code& error);
+	static bool IsCancelled(const DeletionObserver& observer);
+
+	unsigned int threadCount = CONSTANT::DELETE_THREAD_COUNT;
+	bool background = false;
+	// zip every save goes into before it is deleted, empty for none
+	std::string archiveFile;
+};
@@ -0,0 +1,324 @@
+#include "DirectoryReader.h"
+#include <cstddef>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+	const size_t LISTING_BUFFER_BYTES = 32 * 1024;
+
+#ifdef _WIN32
+	int64_t ToTicks(const FILETIME& time)
+	{
+		return static_cast<int64_t>((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime);
+	}
+#elif defined(__linux__)
+	int64_t ToNanoseconds(const struct timespec& time)
+	{
+		return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+	}
+
+	const int FOLDER_OPEN_FLAGS = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+#endif
+}
+
+/**
+ * @brief Makes a reader.
+ *
+ * @param portable Go through std::filesystem even where the platform calls are available, for comparing the two.
+ */
+DirectoryReader::DirectoryReader(bool portable) : portable(portable)
+{
+}
+
+/**
+ * @brief Names a folder to read, nothing is opened yet.
+ *
+ * @param path The folder's full path.
+ * @param knownMtime Its mtime if the parent's listing had it, NO_MTIME otherwise.
+ * @param parent The folder it was listed in, opened relative to while that is still open. Optional.
+ */
+DirectoryReader::Folder::Folder(const std::filesystem::path& path, int64_t knownMtime, const Folder* parent)
+	: path(path),
+	knownMtime(knownMtime),
+	parentFd(parent != nullptr ? parent->fd : -1)
+{
+}
+
+DirectoryReader::Folder::~Folder()
+{
+#ifdef __linux__
+	if (fd >= 0)
+	{
+		::close(fd);
+	}
+#endif
+}
+
+DirectoryReader::Folder::Folder(Folder&& other) noexcept
+	: path(std::move(other.path)),
+	knownMtime(other.knownMtime),
+	parentFd(other.parentFd),
+	fd(other.fd)
+{
+	other.fd = -1;
+}
+
+DirectoryReader::Folder& DirectoryReader::Folder::operator=(Folder&& other) noexcept
+{
+	if (this != &other)
+	{
+		std::swap(path, other.path);
+		std::swap(knownMtime, other.knownMtime);
+		std::swap(parentFd, other.parentFd);
+		std::swap(fd, other.fd);
+	}
+	return *this;
+}
+
+/**
+ * @brief Gets a folder's mtime, from its parent's listing if that had it.
+ *
+ * @param mtime Receives the mtime.
+ * @return False if the folder can't be read.
+ */
+bool DirectoryReader::ReadMtime(const Folder& folder, int64_t& mtime) const
+{
+	if (folder.knownMtime != NO_MTIME)
+	{
+		mtime = folder.knownMtime;
+		return true;
+	}
+
+	if (!portable)
+	{
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExW(folder.path.c_str(), GetFileExInfoStandard, &attributes))
+		{
+			return false;
+		}
+		mtime = ToTicks(attributes.ftLastWriteTime);
+		return true;
+#elif defined(__linux__)
+		struct stat status;
+		int result = folder.parentFd >= 0
+			? ::fstatat(folder.parentFd, folder.path.filename().c_str(), &status, 0)
+			: ::stat(folder.path.c_str(), &status);
+		if (result != 0)
+		{
+			return false;
+		}
+		mtime = ToNanoseconds(status.st_mtim);
+		return true;
+#endif
+	}
+
+	std::error_code error;
+	std::filesystem::file_time_type time = std::filesystem::last_write_time(folder.path, error);
+	if (error)
+	{
+		return false;
+	}
+	mtime = static_cast<int64_t>(time.time_since_epoch().count());
+	return true;
+}
+
+/**
+ * @brief Lists a folder's entries, without . and ..
+ *
+ * On Linux the folder stays open afterwards, for its subfolders to be opened
+ * relative to. If the process is out of descriptors it is listed by path instead.
+ *
+ * @param folder The folder, opened here.
+ * @param entries Receives the entries, in the order the file system gives them.
+ * @return False if the folder can't be read.
+ */
+bool DirectoryReader::List(Folder& folder, std::vector<ListedEntry>& entries) const
+{
+	if (portable)
+	{
+		return ListPortable(folder.path, entries);
+	}
+
+#ifdef _WIN32
+	WIN32_FIND_DATAW data;
+	HANDLE find = FindFirstFileExW((folder.path / L"*").c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		// an empty folder still has . and .., so this is an error.
+		return false;
+	}
+
+	do
+	{
+		if (data.cFileName[0] == L'.' && (data.cFileName[1] == L'\0' || (data.cFileName[1] == L'.' && data.cFileName[2] == L'\0')))
+		{
+			continue;
+		}
+
+		ListedEntry entry;
+		entry.name = std::filesystem::path(data.cFileName).u8string();
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+		{
+			entry.kind = EntryKind::Link;
+		}
+		else if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			entry.kind = EntryKind::Directory;
+		}
+		else
+		{
+			entry.kind = EntryKind::File;
+		}
+		entry.size = static_cast<int64_t>((static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow);
+		entry.mtime = ToTicks(data.ftLastWriteTime);
+		entries.push_back(std::move(entry));
+	} while (FindNextFileW(find, &data));
+
+	bool complete = GetLastError() == ERROR_NO_MORE_FILES;
+	FindClose(find);
+	return complete;
+#elif defined(__linux__)
+	if (folder.fd < 0)
+	{
+		folder.fd = folder.parentFd >= 0
+			? ::openat(folder.parentFd, folder.path.filename().c_str(), FOLDER_OPEN_FLAGS)
+			: ::open(folder.path.c_str(), FOLDER_OPEN_FLAGS);
+		if (folder.fd < 0)
+		{
+			return (errno == EMFILE || errno == ENFILE) && ListPortable(folder.path, entries);
+		}
+	}
+
+	alignas(struct dirent64) char buffer[LISTING_BUFFER_BYTES];
+	for (;;)
+	{
+		ssize_t bytes = ::getdents64(folder.fd, buffer, sizeof(buffer));
+		if (bytes < 0)
+		{
+			return false;
+		}
+		if (bytes == 0)
+		{
+			return true;
+		}
+
+		for (ssize_t offset = 0; offset < bytes;)
+		{
+			const struct dirent64* record = reinterpret_cast<const struct dirent64*>(buffer + offset);
+			offset += record->d_reclen;
+
+			const char* name = record->d_name;
+			if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+			{
+				continue;
+			}
+
+			unsigned char type = record->d_type;
+			if (type == DT_UNKNOWN)
+			{
+				struct stat status;
+				if (::fstatat(folder.fd, name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+				{
+					continue;
+				}
+				type = S_ISDIR(status.st_mode) ? DT_DIR : S_ISREG(status.st_mode) ? DT_REG : S_ISLNK(status.st_mode) ? DT_LNK : DT_UNKNOWN;
+			}
+
+			ListedEntry entry;
+			entry.name = name;
+			entry.kind = type == DT_DIR ? EntryKind::Directory
+				: type == DT_REG ? EntryKind::File
+				: type == DT_LNK ? EntryKind::Link
+				: EntryKind::Other;
+			entries.push_back(std::move(entry));
+		}
+	}
+#else
+	return ListPortable(folder.path, entries);
+#endif
+}
+
+/**
+ * @brief Gets the size and mtime of a file in a folder.
+ *
+ * Relative to the folder while it is open, so only the file's own name is looked up.
+ *
+ * @return False if the file can't be stat'ed, size and mtime are then left alone.
+ */
+bool DirectoryReader::ReadFileInfo(const Folder& folder, std::string_view name, int64_t& size, int64_t& mtime) const
+{
+	std::filesystem::path file = folder.path / std::filesystem::u8path(name);
+
+	if (!portable)
+	{
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExW(file.c_str(), GetFileExInfoStandard, &attributes))
+		{
+			return false;
+		}
+		size = static_cast<int64_t>((static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow);
+		mtime = ToTicks(attributes.ftLastWriteTime);
+		return true;
+#elif defined(__linux__)
+		struct stat status;
+		int result = folder.fd >= 0
+			? ::fstatat(folder.fd, std::string(name).c_str(), &status, 0)
+			: ::stat(file.c_str(), &status);
+		if (result != 0)
+		{
+			return false;
+		}
+		size = static_cast<int64_t>(status.st_size);
+		mtime = ToNanoseconds(status.st_mtim);
+		return true;
+#endif
+	}
+
+	std::error_code sizeError;
+	std::error_code timeError;
+	uintmax_t fileSize = std::filesystem::file_size(file, sizeError);
+	std::filesystem::file_time_type fileMtime = std::filesystem::last_write_time(file, timeError);
+	if (sizeError || timeError)
+	{
+		return false;
+	}
+	size = static_cast<int64_t>(fileSize);
+	mtime = static_cast<int64_t>(fileMtime.time_since_epoch().count());
+	return true;
+}
+
+/**
+ * @brief Lists a folder through std::filesystem, where the entry types come from its cache.
+ */
+bool DirectoryReader::ListPortable(const std::filesystem::path& folder, std::vector<ListedEntry>& entries) const
+{
+	std::error_code error;
+	std::filesystem::directory_iterator it(folder, std::filesystem::directory_options::skip_permission_denied, error);
+	for (; !error && it != std::filesystem::directory_iterator(); it.increment(error))
+	{
+		std::error_code entryError;
+		std::filesystem::file_type type = it->symlink_status(entryError).type();
+
+		ListedEntry entry;
+		entry.name = it->path().filename().u8string();
+		entry.kind = type == std::filesystem::file_type::symlink ? EntryKind::Link
+			: type == std::filesystem::file_type::directory ? EntryKind::Directory
+			: type == std::filesystem::file_type::regular ? EntryKind::File
+			: EntryKind::Other;
+		entries.push_back(std::move(entry));
+	}
+	return !error;
+}
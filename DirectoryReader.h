@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What a listing says an entry is.
+enum class EntryKind : uint8_t
+{
+	Directory,
+	File,
+	Link,	// symlinks and other reparse points, never followed
+	Other
+};
+
+// One entry of a folder listing.
+struct ListedEntry
+{
+	// in UTF-8
+	std::string name;
+	EntryKind kind = EntryKind::Other;
+	// only where the listing carries them (Windows), otherwise -1 and NO_MTIME
+	int64_t size = -1;
+	int64_t mtime = INT64_MIN;
+};
+
+// Lists folders with the platform's own calls, so that finding out what each
+// entry is doesn't cost a stat per entry.
+//
+// On Linux a folder is opened with openat, relative to its parent's descriptor
+// while the parent is open, and read with getdents64. d_type says what each
+// entry is, only DT_UNKNOWN entries (some network and older file systems) are
+// fstatat'ed. On Windows FindFirstFileExW with FIND_FIRST_EX_LARGE_FETCH hands
+// back every entry's attributes, size and mtime in the same call, so the
+// subfolders and files of a listing never have to be stat'ed at all. Elsewhere,
+// or when made portable, it goes through std::filesystem.
+//
+// Mtimes are the platform's own (nanoseconds since 1970 on POSIX, FILETIME
+// ticks on Windows, file_time_type ticks when portable, which can be negative)
+// and only compare with mtimes read by a reader of the same kind.
+class DirectoryReader
+{
+public:
+	// an mtime nobody has read yet
+	static constexpr int64_t NO_MTIME = INT64_MIN;
+
+	explicit DirectoryReader(bool portable = false);
+
+	// a folder to read, opened by the first List and closed when it goes out of scope
+	class Folder
+	{
+	public:
+		explicit Folder(const std::filesystem::path& path, int64_t knownMtime = NO_MTIME, const Folder* parent = nullptr);
+		~Folder();
+
+		Folder(Folder&& other) noexcept;
+		Folder& operator=(Folder&& other) noexcept;
+		Folder(const Folder&) = delete;
+		Folder& operator=(const Folder&) = delete;
+
+		const std::filesystem::path& GetPath() const { return path; }
+
+	private:
+		friend class DirectoryReader;
+
+		std::filesystem::path path;
+		// from the parent's listing, NO_MTIME if it has to be read
+		int64_t knownMtime;
+		// descriptors on Linux, -1 while closed. The parent's isn't owned, it
+		// only has to stay open until this folder is opened.
+		int parentFd = -1;
+		int fd = -1;
+	};
+
+	bool ReadMtime(const Folder& folder, int64_t& mtime) const;
+	bool List(Folder& folder, std::vector<ListedEntry>& entries) const;
+	bool ReadFileInfo(const Folder& folder, std::string_view name, int64_t& size, int64_t& mtime) const;
+
+	bool IsPortable() const { return portable; }
+
+private:
+	bool ListPortable(const std::filesystem::path& folder, std::vector<ListedEntry>& entries) const;
+
+	bool portable;
+};
@@ -0,0 +1,487 @@
+#include "DirectoryWatcher.h"
+#include "Constants.h"
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+	// One ReadDirectoryChangesW over the whole LocalLow tree.
+	class WindowsWatcher : public DirectoryWatcher
+	{
+	public:
+		~WindowsWatcher() override
+		{
+			Stop();
+		}
+
+	protected:
+		bool Open(const std::string& watchRoot) override
+		{
+			folder = CreateFileW(std::filesystem::u8path(watchRoot).wstring().c_str(),
+				FILE_LIST_DIRECTORY,
+				FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				nullptr,
+				OPEN_EXISTING,
+				FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+				nullptr);
+			changeEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			wakeEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+			buffer.resize(CONSTANT::WATCH_BUFFER_BYTES / sizeof(DWORD));
+
+			if (folder == INVALID_HANDLE_VALUE || changeEvent == nullptr || wakeEvent == nullptr || !Request())
+			{
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void WaitForEvents(int timeoutMs, WatchEvents& events) override
+		{
+			HANDLE handles[2] = { changeEvent, wakeEvent };
+			DWORD result = WaitForMultipleObjects(2, handles, FALSE, timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs));
+			if (result != WAIT_OBJECT_0)
+			{
+				return;
+			}
+
+			DWORD bytes = 0;
+			// no bytes means the buffer overflowed and the changes are lost.
+			if (!GetOverlappedResult(folder, &overlapped, &bytes, FALSE) || bytes == 0)
+			{
+				events.overflowed = true;
+			}
+			else
+			{
+				ReadChanges(events);
+			}
+
+			if (!Request())
+			{
+				events.overflowed = true;
+			}
+		}
+
+		void Wake() override
+		{
+			SetEvent(wakeEvent);
+		}
+
+		void Close() override
+		{
+			if (folder != INVALID_HANDLE_VALUE)
+			{
+				DWORD bytes = 0;
+				CancelIoEx(folder, &overlapped);
+				GetOverlappedResult(folder, &overlapped, &bytes, TRUE);
+				CloseHandle(folder);
+				folder = INVALID_HANDLE_VALUE;
+			}
+			if (changeEvent != nullptr)
+			{
+				CloseHandle(changeEvent);
+				changeEvent = nullptr;
+			}
+			if (wakeEvent != nullptr)
+			{
+				CloseHandle(wakeEvent);
+				wakeEvent = nullptr;
+			}
+		}
+
+	private:
+		bool Request()
+		{
+			overlapped = OVERLAPPED();
+			overlapped.hEvent = changeEvent;
+			// names only. last write would fire for every line a running game adds to
+			// its Player.log, and rescan the company each time. a relaunch renames the
+			// old log to Player-prev.log and creates a new one, which names catch.
+			DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME;
+			return ReadDirectoryChangesW(folder, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(DWORD)), TRUE, filter, nullptr, &overlapped, nullptr) != 0;
+		}
+
+		void ReadChanges(WatchEvents& events)
+		{
+			const char* next = reinterpret_cast<const char*>(buffer.data());
+			while (true)
+			{
+				const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(next);
+				std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+				std::filesystem::path path = std::filesystem::u8path(root) / name;
+
+				// the notification doesn't say file or folder. added ones can be checked,
+				// removed ones are taken as folders unless they look like a file.
+				bool relevant = IsMarkerFile(path.u8string());
+				if (!relevant && (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_RENAMED_NEW_NAME))
+				{
+					std::error_code error;
+					relevant = std::filesystem::is_directory(path, error);
+				}
+				else if (!relevant && (info->Action == FILE_ACTION_REMOVED || info->Action == FILE_ACTION_RENAMED_OLD_NAME))
+				{
+					relevant = !path.has_extension();
+				}
+
+				if (relevant)
+				{
+					events.changedPaths.push_back(path.u8string());
+				}
+
+				if (info->NextEntryOffset == 0)
+				{
+					break;
+				}
+				next += info->NextEntryOffset;
+			}
+		}
+
+		HANDLE folder = INVALID_HANDLE_VALUE;
+		HANDLE changeEvent = nullptr;
+		HANDLE wakeEvent = nullptr;
+		OVERLAPPED overlapped = OVERLAPPED();
+		// DWORD aligned, as ReadDirectoryChangesW wants
+		std::vector<DWORD> buffer;
+	};
+#elif defined(__linux__)
+	// One inotify watch per folder, down to the game folders. inotify isn't
+	// recursive, so folders created later get their watch when they show up.
+	class InotifyWatcher : public DirectoryWatcher
+	{
+	public:
+		~InotifyWatcher() override
+		{
+			Stop();
+		}
+
+	protected:
+		bool Open(const std::string& watchRoot) override
+		{
+			inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			buffer.resize(CONSTANT::WATCH_BUFFER_BYTES);
+			if (inotifyFd < 0 || wakeFd < 0)
+			{
+				Close();
+				return false;
+			}
+
+			AddWatches(watchRoot, 0);
+			if (watches.empty())
+			{
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void WaitForEvents(int timeoutMs, WatchEvents& events) override
+		{
+			pollfd fds[2] = { { inotifyFd, POLLIN, 0 }, { wakeFd, POLLIN, 0 } };
+			if (poll(fds, 2, timeoutMs) <= 0)
+			{
+				return;
+			}
+
+			if (fds[1].revents & POLLIN)
+			{
+				uint64_t count = 0;
+				read(wakeFd, &count, sizeof(count));
+			}
+
+			while (true)
+			{
+				ssize_t length = read(inotifyFd, buffer.data(), buffer.size());
+				if (length <= 0)
+				{
+					break;
+				}
+				ReadChanges(static_cast<size_t>(length), events);
+			}
+		}
+
+		void Wake() override
+		{
+			uint64_t count = 1;
+			write(wakeFd, &count, sizeof(count));
+		}
+
+		void Close() override
+		{
+			if (inotifyFd >= 0)
+			{
+				// closing drops every watch with it.
+				close(inotifyFd);
+				inotifyFd = -1;
+			}
+			if (wakeFd >= 0)
+			{
+				close(wakeFd);
+				wakeFd = -1;
+			}
+			watches.clear();
+		}
+
+	private:
+		struct Watch
+		{
+			std::string path;
+			// 0 for LocalLow, 1 for companies, 2 for games
+			int depth = 0;
+		};
+
+		// appends to a running game's log don't matter, the header is only written at
+		// launch. a relaunch rewrites the log and closes it on exit, IN_CLOSE_WRITE catches that.
+		static constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE;
+
+		void AddWatches(const std::string& folder, int depth)
+		{
+			int watch = inotify_add_watch(inotifyFd, folder.c_str(), WATCH_MASK | IN_ONLYDIR);
+			if (watch < 0)
+			{
+				// out of watches or the folder is gone, changes below it go unseen.
+				return;
+			}
+			watches[watch] = Watch{ folder, depth };
+
+			if (depth >= CONSTANT::WATCH_DEPTH)
+			{
+				return;
+			}
+
+			std::error_code error;
+			std::filesystem::directory_iterator it(std::filesystem::u8path(folder), std::filesystem::directory_options::skip_permission_denied, error);
+			for (; !error && it != std::filesystem::directory_iterator(); it.increment(error))
+			{
+				std::error_code entryError;
+				if (!it->is_symlink(entryError) && it->is_directory(entryError))
+				{
+					AddWatches(it->path().u8string(), depth + 1);
+				}
+			}
+		}
+
+		void ReadChanges(size_t length, WatchEvents& events)
+		{
+			for (size_t offset = 0; offset + sizeof(inotify_event) <= length;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+				offset += sizeof(inotify_event) + event->len;
+
+				if (event->mask & IN_Q_OVERFLOW)
+				{
+					events.overflowed = true;
+					continue;
+				}
+
+				auto watch = watches.find(event->wd);
+				if (watch == watches.end())
+				{
+					continue;
+				}
+				if (event->mask & IN_IGNORED)
+				{
+					watches.erase(watch);
+					continue;
+				}
+
+				std::string path = watch->second.path;
+				int depth = watch->second.depth;
+				if (event->len > 0)
+				{
+					path += '/';
+					path += event->name;
+				}
+
+				bool isFolder = (event->mask & IN_ISDIR) != 0;
+				if (isFolder && (event->mask & (IN_CREATE | IN_MOVED_TO)) && depth < CONSTANT::WATCH_DEPTH)
+				{
+					AddWatches(path, depth + 1);
+				}
+
+				if (isFolder || IsMarkerFile(path))
+				{
+					events.changedPaths.push_back(path);
+				}
+			}
+		}
+
+		int inotifyFd = -1;
+		int wakeFd = -1;
+		std::unordered_map<int, Watch> watches;
+		std::vector<char> buffer;
+	};
+#endif
+}
+
+
+/**
+ * @brief Makes the watcher for this platform.
+ *
+ * @return The watcher, or nullptr if the platform has none.
+ */
+std::unique_ptr<DirectoryWatcher> DirectoryWatcher::Create()
+{
+#ifdef _WIN32
+	return std::make_unique<WindowsWatcher>();
+#elif defined(__linux__)
+	return std::make_unique<InotifyWatcher>();
+#else
+	return nullptr;
+#endif
+}
+
+/**
+ * @brief Starts watching a folder on a thread of its own.
+ *
+ * @param watchRoot The LocalLow folder, in UTF-8.
+ * @param callback Gets the changed company folders, on the watcher thread.
+ * @return False if the folder can't be watched.
+ */
+bool DirectoryWatcher::Start(const std::string& watchRoot, ChangeCallback callback)
+{
+	Stop();
+
+	root = watchRoot;
+	onChanged = std::move(callback);
+	if (!Open(root))
+	{
+		return false;
+	}
+
+	stopping = false;
+	thread = std::thread(&DirectoryWatcher::Run, this);
+	return true;
+}
+
+/**
+ * @brief Stops watching and waits for the watcher thread, changes not yet reported are dropped.
+ */
+void DirectoryWatcher::Stop()
+{
+	if (!thread.joinable())
+	{
+		return;
+	}
+
+	stopping = true;
+	Wake();
+	thread.join();
+	Close();
+}
+
+/**
+ * @brief Waits for changes and reports them once they settle.
+ */
+void DirectoryWatcher::Run()
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::duration quietTime = std::chrono::milliseconds(CONSTANT::WATCH_DEBOUNCE_MS);
+	const Clock::duration maxDelay = std::chrono::milliseconds(CONSTANT::WATCH_MAX_DELAY_MS);
+
+	std::set<std::string> pendingCompanies;
+	bool fullRescan = false;
+	Clock::time_point firstChange;
+	Clock::time_point lastChange;
+
+	while (!stopping)
+	{
+		bool hasPending = fullRescan || !pendingCompanies.empty();
+
+		// nothing pending, sleep until something happens.
+		int timeoutMs = -1;
+		if (hasPending)
+		{
+			Clock::time_point quietDue = lastChange + quietTime;
+			Clock::time_point delayDue = firstChange + maxDelay;
+			Clock::time_point due = quietDue < delayDue ? quietDue : delayDue;
+			auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - Clock::now()).count();
+			timeoutMs = wait > 0 ? static_cast<int>(wait) : 0;
+		}
+
+		WatchEvents events;
+		WaitForEvents(timeoutMs, events);
+		if (stopping)
+		{
+			break;
+		}
+
+		Clock::time_point now = Clock::now();
+		bool changed = events.overflowed;
+		fullRescan = fullRescan || events.overflowed;
+		for (const std::string& path : events.changedPaths)
+		{
+			std::string company = CompanyOf(path);
+			if (!company.empty())
+			{
+				pendingCompanies.insert(company);
+				changed = true;
+			}
+		}
+
+		if (changed)
+		{
+			if (!hasPending)
+			{
+				firstChange = now;
+			}
+			lastChange = now;
+			hasPending = true;
+		}
+
+		if (hasPending && (now - lastChange >= quietTime || now - firstChange >= maxDelay))
+		{
+			std::vector<std::string> companies;
+			if (!fullRescan)
+			{
+				companies.assign(pendingCompanies.begin(), pendingCompanies.end());
+			}
+			bool rescanAll = fullRescan;
+			pendingCompanies.clear();
+			fullRescan = false;
+
+			onChanged(companies, rescanAll);
+		}
+	}
+}
+
+/**
+ * @brief Gets the company folder a changed path is in.
+ *
+ * @param path Full path of a changed file or folder.
+ * @return The company folder, built the same way ScanSaves builds it, or empty if the path isn't inside one.
+ */
+std::string DirectoryWatcher::CompanyOf(const std::string& path) const
+{
+	std::filesystem::path rootPath = std::filesystem::u8path(root);
+	std::filesystem::path relative = std::filesystem::u8path(path).lexically_relative(rootPath);
+	if (relative.empty() || *relative.begin() == "." || *relative.begin() == "..")
+	{
+		return std::string();
+	}
+
+	return (rootPath / *relative.begin()).u8string();
+}
+
+/**
+ * @brief Whether a path is one of the files the scanner classifies saves by.
+ */
+bool DirectoryWatcher::IsMarkerFile(const std::string& path)
+{
+	std::filesystem::path fileName = std::filesystem::u8path(path).filename();
+	return fileName == "Player.log" || fileName == "output_log.txt";
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Watches LocalLow and says which company folders have changed, so only those
+// need scanning again.
+//
+// Raw events from the backend (inotify on Linux, ReadDirectoryChangesW on Windows)
+// are debounced and coalesced per company folder: a batch goes out once the
+// folder has been quiet for a while, or once the first change in it has waited
+// long enough, whichever comes first. Neither backend listens for plain writes,
+// so a running game appending to its log costs no rescans at all: only files
+// and folders appearing, going or being renamed count (and on Linux, a write
+// being closed).
+class DirectoryWatcher
+{
+public:
+	// called on the watcher thread. fullRescan is set if events were lost and
+	// the whole folder has to be scanned again, companyPaths is empty then.
+	using ChangeCallback = std::function<void(const std::vector<std::string>& companyPaths, bool fullRescan)>;
+
+	static std::unique_ptr<DirectoryWatcher> Create();
+	virtual ~DirectoryWatcher() = default;
+
+	bool Start(const std::string& root, ChangeCallback onChanged);
+	void Stop();
+
+protected:
+	// what WaitForEvents saw, paths are full paths in UTF-8.
+	struct WatchEvents
+	{
+		std::vector<std::string> changedPaths;
+		bool overflowed = false;
+	};
+
+	virtual bool Open(const std::string& root) = 0;
+	virtual void WaitForEvents(int timeoutMs, WatchEvents& events) = 0;
+	// makes a blocked WaitForEvents return, from any thread.
+	virtual void Wake() = 0;
+	virtual void Close() = 0;
+
+	static bool IsMarkerFile(const std::string& path);
+
+	std::string root;
+
+private:
+	void Run();
+	std::string CompanyOf(const std::string& path) const;
+
+	ChangeCallback onChanged;
+	std::thread thread;
+	std::atomic<bool> stopping{ false };
+};
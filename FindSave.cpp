@@ -1,257 +1,1184 @@
 ﻿#include "FindSave.h"
 #include <filesystem>
+#include <chrono>
 #include <vector>
 #include <string>
-#include <shlobj.h>
 #include <iostream>
-#include <fstream>
 #include <limits>
 #include <codecvt>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <deque>
+#include <algorithm>
+#include <unordered_map>
+#include "ThreadPool.h"
+#include "IoLimiter.h"
+#include "LogBatchReader.h"
+#include "InstallProbe.h"
+#include "InstallIndex.h"
+#include "ScanSnapshot.h"
+#include "PlayerPrefsCleaner.h"
+#include "Constants.h"
+
+#ifdef _WIN32
+#include <shlobj.h>
+#endif
+
+namespace
+{
+	// adds the time until it goes out of scope to a ScanStats timer, if there is one.
+	class StatTimer
+	{
+	public:
+		explicit StatTimer(std::atomic<uint64_t>* counter) : counter(counter)
+		{
+			if (counter != nullptr)
+			{
+				start = std::chrono::steady_clock::now();
+			}
+		}
+
+		~StatTimer()
+		{
+			if (counter != nullptr)
+			{
+				*counter += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+			}
+		}
 
+	private:
+		std::atomic<uint64_t>* counter;
+		std::chrono::steady_clock::time_point start;
+	};
+}
 
 
 
 /**
- * @brief Store all Unity save folder paths that point to the company name.
+ * @brief Scans LocalLow once and builds the save index.
  *
- * The intention is to see if the folder is empty after save games have been deleted,
- * as lingering empty folders are useless. It will be deleted if so.
- * 
+ * Walks every company folder a single time, noting which folders hold Unity's
+ * marker files (Player.log / output_log.txt). Each of those folders becomes an
+ * entry in the index, classified as:
+ * Installed/Unlinked - has Player.log, depending on whether the game path in it exists.
+ * Unknown - only has output_log.txt, which does not specify the game path.
+ * An Unknown save whose company and game a launcher has installed (see
+ * SetInstallSources) takes that install as its game path instead.
+ *
+ * Company folders are independent of each other, so they are scanned on a
+ * work-stealing thread pool, and every folder directly inside a company is split
+ * off as its own task so one huge company doesn't hold up the rest.
+ * The results are put back together in directory order, so the index comes out
+ * the same no matter how many threads did the work.
+ *
+ * The walk only notes which Player.logs it needs. Once it is over they are read
+ * in one batch (see ReadPendingLogs), and each company is probed and reported
+ * as soon as its own logs are in, while the rest are still being read.
+ *
+ * If a snapshot path is set, the last scan is used to skip unchanged folders and
+ * logs (see ReadFolder), and a finished scan is saved over it.
+ *
+ * Company folders with at least one save are kept as well, so they can be removed
+ * once they are empty.
  *
  * @param path The LocalAppData path, gained from the GetAppDataPath function.
- * @return A string vector, full of paths that point to Unity company names w/ game titles in it.
+ * @param observer Optional hooks to get each company as soon as it is done, and to cancel.
+ * @return True if the scan finished, false if it was cancelled (the index is then partial).
  */
-void FindSave::GetCompanyPaths(const std::string& path)
+bool FindSave::ScanSaves(const std::string& path, const ScanObserver& observer)
 {
-	if (!companyPath.empty())
+	saveIndex.Clear();
+
+	// a deque so the companies never move while tasks point at them.
+	std::deque<CompanyScan> companies;
 	{
-		companyPath.clear();
+		StatTimer timer(observer.stats != nullptr ? &observer.stats->listMicroseconds : nullptr);
+		TraceRecorder::Span span(observer.trace, "list companies", "scan", path);
+		ListCompanies(path, companies);
 	}
-	for (const auto& entry : std::filesystem::directory_iterator(path))
+
+	// the last scan of the same folder, lets unchanged folders and logs be skipped.
+	std::unique_ptr<ScanSnapshot> previous;
+	if (!snapshotPath.empty())
 	{
-		if (entry.is_directory())
+		previous = ScanSnapshot::Load(snapshotPath);
+		// it only knows the folders its own policy walked.
+		if (previous && (previous->GetRoot() != path || previous->GetWalkKey() != walkPolicy.GetKey()))
 		{
-			for (const auto& entry2 : std::filesystem::recursive_directory_iterator(entry))
-			{
-				// Store all Unity related save file company folder paths.
-				// If so, store path and break, as we've already found out its a Unity save folder.
-				if (entry2.is_regular_file() && (entry2.path().filename() == "output_log.txt" || entry2.path().filename() == "Player.log"))
-				{
-					companyPath.push_back(entry.path().u8string());
-					break;
+			previous.reset();
+		}
+	}
 
-				}
+	RunCompanyScans(companies, observer, previous.get());
+
+	// merge in directory order.
+	for (const CompanyScan& company : companies)
+	{
+		AddCompanySaves(company.folder.u8string(), company.saves);
+	}
+
+	if (IsCancelled(observer))
+	{
+		return false;
+	}
+
+	if (!snapshotPath.empty() && observer.keepResults)
+	{
+		// the old file has to be unmapped before it can be replaced.
+		previous.reset();
+		StatTimer timer(observer.stats != nullptr ? &observer.stats->snapshotMicroseconds : nullptr);
+		TraceRecorder::Span span(observer.trace, "write snapshot", "scan");
+		WriteSnapshot(path, companies);
+	}
+	return true;
+}
+/**
+ * @brief Scans only the given company folders, for updating part of the index.
+ *
+ * The index isn't touched, results only go to the observer. A company folder
+ * that no longer exists is reported with no saves. The snapshot isn't used or
+ * written, a partial scan can't stand in for a full one.
+ *
+ * @param companyPaths Company folders in LocalLow, in UTF-8.
+ * @param observer Gets every company, in the order given.
+ * @return False if the scan was cancelled.
+ */
+bool FindSave::ScanCompanies(const std::vector<std::string>& companyPaths, const ScanObserver& observer)
+{
+	std::deque<CompanyScan> companies;
+	for (const std::string& companyPath : companyPaths)
+	{
+		companies.emplace_back();
+		companies.back().folder = std::filesystem::u8path(companyPath);
+	}
+
+	RunCompanyScans(companies, observer, nullptr);
+	return !IsCancelled(observer);
+}
+/**
+ * @brief Scans several LocalLow folders in one pass and builds the index from all of them.
+ *
+ * The company folders of every root go on one pool, so a root with a single
+ * huge company and a hundred roots with one small company each keep every
+ * thread busy alike, and the I/O limit holds across all of them. Install
+ * paths are probed once for the whole machine. Each company is still reported
+ * and indexed by its own path, its root is the folder it's in.
+ *
+ * The snapshot isn't used or written, it only ever describes one root.
+ *
+ * @param roots LocalLow folders in UTF-8, see RootDiscovery.
+ * @param observer Optional hooks to get each company as soon as it is done, and to cancel.
+ * @return False if the scan was cancelled (the index is then partial).
+ */
+bool FindSave::ScanRoots(const std::vector<std::string>& roots, const ScanObserver& observer)
+{
+	saveIndex.Clear();
+
+	std::deque<CompanyScan> companies;
+	{
+		StatTimer timer(observer.stats != nullptr ? &observer.stats->listMicroseconds : nullptr);
+		TraceRecorder::Span span(observer.trace, "list companies", "scan");
+		for (const std::string& root : roots)
+		{
+			ListCompanies(root, companies);
+		}
+	}
+
+	RunCompanyScans(companies, observer, nullptr);
+
+	// merge in root order, then directory order.
+	for (const CompanyScan& company : companies)
+	{
+		AddCompanySaves(company.folder.u8string(), company.saves);
+	}
+	return !IsCancelled(observer);
+}
+/**
+ * @brief Adds every company folder of a LocalLow folder, links left out.
+ *
+ * @param root The LocalLow folder in UTF-8.
+ * @param companies Gets the company folders in directory order.
+ */
+void FindSave::ListCompanies(const std::string& root, std::deque<CompanyScan>& companies)
+{
+	DirectoryReader reader(portableListing);
+	DirectoryReader::Folder folder(std::filesystem::u8path(root));
+	std::vector<ListedEntry> entries;
+	reader.List(folder, entries);
+	for (const ListedEntry& entry : entries)
+	{
+		if (entry.kind == EntryKind::Directory)
+		{
+			companies.emplace_back();
+			companies.back().folder = folder.GetPath() / std::filesystem::u8path(entry.name);
+			companies.back().mtime = entry.mtime;
+		}
+	}
+}
+/**
+ * @brief Scans a set of company folders on a pool and classifies their saves.
+ *
+ * @param companies The company folders, filled with their saves.
+ * @param observer Gets each company as soon as its saves are final.
+ * @param previous Last scan of the same folder, or nullptr.
+ */
+void FindSave::RunCompanyScans(std::deque<CompanyScan>& companies, const ScanObserver& observer, const ScanSnapshot* previous)
+{
+	// once per scan, so a game installed since the last one is found.
+	InstallIndex installs;
+	if (!steamFolders.empty())
+	{
+		StatTimer timer(observer.stats != nullptr ? &observer.stats->installIndexMicroseconds : nullptr);
+		TraceRecorder::Span span(observer.trace, "install index", "scan");
+		std::vector<std::filesystem::path> folders;
+		for (const std::string& steam : steamFolders)
+		{
+			folders.push_back(std::filesystem::u8path(steam));
+		}
+		installs = InstallIndex::LoadOrBuild(folders, installIndexPath);
+		if (observer.stats != nullptr)
+		{
+			observer.stats->manifestsRead += installs.GetManifestsRead();
+		}
+	}
+
+	ThreadPool pool(scanThreadCount);
+	IoLimiter ioLimiter(ioLimit);
+	DirectoryReader reader(portableListing);
+	ScanRun run{ pool, observer, companies.size(), previous, &ioLimiter, reader, installs };
+	{
+		StatTimer timer(observer.stats != nullptr ? &observer.stats->walkMicroseconds : nullptr);
+		TraceRecorder::Span span(observer.trace, "walk", "scan");
+		for (CompanyScan& company : companies)
+		{
+			pool.Submit([this, &run, &company]() { ScanCompany(run, company); });
+		}
+		pool.Wait();
+	}
+
+	if (!IsCancelled(observer))
+	{
+		StatTimer timer(observer.stats != nullptr ? &observer.stats->logsMicroseconds : nullptr);
+		TraceRecorder::Span span(observer.trace, "read logs", "scan");
+		ReadPendingLogs(run, companies);
+	}
+}
+/**
+ * @brief Sets how many threads ScanSaves uses.
+ *
+ * @param threadCount Number of worker threads, 0 uses one per hardware thread.
+ */
+void FindSave::SetScanThreadCount(unsigned int threadCount)
+{
+	scanThreadCount = threadCount;
+}
+/**
+ * @brief Sets how many folder listings and log reads a scan has in flight at once.
+ *
+ * @param limit Most at once across all of the scan's threads, 0 for no limit.
+ */
+void FindSave::SetIoLimit(unsigned int limit)
+{
+	ioLimit = limit;
+}
+/**
+ * @brief Sets which folders below a company are walked, see WalkPolicy.
+ */
+void FindSave::SetWalkPolicy(const WalkPolicy& policy)
+{
+	walkPolicy = policy;
+}
+/**
+ * @brief Lists folders through std::filesystem instead of the platform's calls, see DirectoryReader.
+ *
+ * Mtimes are read differently then, so a snapshot from the other kind of scan
+ * only has its Player.logs read again, not its results changed.
+ */
+void FindSave::SetPortableListing(bool portable)
+{
+	portableListing = portable;
+}
+/**
+ * @brief Reads Player.logs through io_uring where the kernel has it, see LogBatchReader.
+ *
+ * @param ring False reads every log on the scan's pool instead, for comparing the two.
+ */
+void FindSave::SetRingLogReads(bool ring)
+{
+	ringLogReads = ring;
+}
+/**
+ * @brief Sets which launchers' installs Unknown saves are looked up in, see InstallIndex.
+ *
+ * @param steamFolders Steam installs in UTF-8, see RootDiscovery::FindSteamFolders. None turns the lookup off.
+ * @param cacheFile Where the index is cached between scans, in UTF-8. Empty reads Steam on every scan.
+ */
+void FindSave::SetInstallSources(const std::vector<std::string>& steamFolders, const std::string& cacheFile)
+{
+	this->steamFolders = steamFolders;
+	installIndexPath = cacheFile;
+}
+/**
+ * @brief Sets where ScanSaves keeps its snapshot of the last scan.
+ *
+ * @param path Snapshot file path in UTF-8, empty turns snapshots off.
+ */
+void FindSave::SetSnapshotPath(const std::string& path)
+{
+	snapshotPath = path;
+}
+/**
+ * @brief Saves this scan as the snapshot for the next one.
+ *
+ * @param root The LocalLow folder that was scanned.
+ * @param companies Every company of the scan, classified.
+ * @return False if the snapshot couldn't be written.
+ */
+bool FindSave::WriteSnapshot(const std::string& root, const std::deque<CompanyScan>& companies)
+{
+	std::vector<SnapshotDirectory> directories;
+	for (const CompanyScan& company : companies)
+	{
+		std::unordered_map<std::string, SaveClass> saveClasses;
+		for (const SaveEntry& save : company.saves)
+		{
+			saveClasses[save.gamePath] = save.classification;
+		}
+
+		uint32_t base = static_cast<uint32_t>(directories.size());
+		for (const SnapshotDirectory& directory : company.directories)
+		{
+			directories.push_back(directory);
+			SnapshotDirectory& written = directories.back();
+			if (written.parent != SnapshotDirectory::NO_PARENT)
+			{
+				written.parent += base;
 			}
 
+			auto saveClass = saveClasses.find(written.path);
+			written.saveClass = saveClass == saveClasses.end() ? SnapshotDirectory::NOT_A_SAVE : static_cast<uint8_t>(saveClass->second);
 		}
 	}
 
+	return ScanSnapshot::Write(snapshotPath, root, walkPolicy.GetKey(), directories);
 }
 /**
- * @brief Gets other Unity save paths that don't have 'Player.log'
+ * @brief Empties the save index.
  *
- * The other standard Unity extra files that exists in save folders from my observation is output_log.txt,
- * which does not specify the game path, so there is no way to check if it exists.
+ * Used when the index is filled from a scan running elsewhere, see AddCompanySaves.
+ */
+void FindSave::ClearSaves()
+{
+	saveIndex.Clear();
+}
+/**
+ * @brief Adds one scanned company folder and its saves to the index.
  *
+ * Companies without saves are ignored, they aren't Unity folders.
  *
- * @param path The LocalAppData path, gained from the GetAppDataPath function.
- * @return A string vector, full of paths of save folders with output_log.txt only
+ * @param companyPath The company folder in LocalLow.
+ * @param saves The save folders found in it.
  */
-void FindSave::GetUnknownSavePaths(const std::string& path)
+void FindSave::AddCompanySaves(const std::string& companyPath, const std::vector<SaveEntry>& saves)
 {
-	if (!unknownSavePaths.empty())
+	if (saves.empty())
 	{
-		unknownSavePaths.clear();
+		return;
 	}
-	for (const auto& entry : std::filesystem::directory_iterator(path))
+	saveIndex.AddCompany(companyPath);
+
+	for (const SaveEntry& save : saves)
 	{
-		if (entry.is_directory())
-		{
-			bool playerLogFound = false;
-			// company folder
-			for (const auto& entry2 : std::filesystem::recursive_directory_iterator(entry))
+		saveIndex.AddEntry(save);
+	}
+}
+/**
+ * @brief Swaps one company folder's saves in the index for freshly scanned ones.
+ *
+ * @param companyPath The company folder in LocalLow.
+ * @param saves Its saves now, empty if it has none left or is gone.
+ */
+void FindSave::ReplaceCompanySaves(const std::string& companyPath, const std::vector<SaveEntry>& saves)
+{
+	saveIndex.ReplaceCompany(companyPath, saves);
+}
+/**
+ * @brief Stores a save folder's measured size in the index.
+ *
+ * @param gamePath The save folder.
+ * @param size Its size, and its mtime when it was measured.
+ */
+void FindSave::SetSaveSize(const std::string& gamePath, const FolderSize& size)
+{
+	saveIndex.SetSize(gamePath, size);
+}
+/**
+ * @brief Forgets the sizes of saves that are gone, once a scan has found everything.
+ */
+void FindSave::PruneSaveSizes()
+{
+	saveIndex.PruneSizes();
+}
+/**
+ * @brief Splits one company folder into tasks.
+ *
+ * Every folder directly in the company is handed to the pool as its own ScanTree
+ * task with its own result slot, unless the walk policy skips it. Marker files
+ * sitting in the company folder itself are handled here, the company is walked
+ * into even if it has a Player.log.
+ *
+ * @param run The scan this company belongs to.
+ * @param company The company folder and the slots its results go into.
+ */
+void FindSave::ScanCompany(ScanRun& run, CompanyScan& company)
+{
+	const std::string companyPath = company.folder.u8string();
+	TraceRecorder::Span span(run.observer.trace, "company", "scan", companyPath);
+
+	SnapshotDirectory directory;
+	directory.parent = SnapshotDirectory::NO_PARENT;
+	DirectoryReader::Folder folder(company.folder, company.mtime);
+	std::vector<Subfolder> children;
+	if (!ReadFolder(folder, run, directory, children, company.pendingLogs) || IsCancelled(run.observer))
+	{
+		FinishCompanyTask(run, company);
+		return;
+	}
+
+	if (directory.hasPlayerLog || directory.hasOutputLog)
+	{
+		company.ownSlot = company.slots.size();
+		company.slots.push_back(std::make_unique<TreeScan>());
+		company.slots.back()->saves.push_back(MakeSave(companyPath, directory));
+		company.slots.back()->subtreeHasPlayerLog = directory.hasPlayerLog;
+	}
+	// always the first folder of the company.
+	company.directories.push_back(std::move(directory));
+	PruneChildren(0, false, run, children);
+
+	// each tree opens its root by path, it runs after this folder is closed.
+	for (const Subfolder& child : children)
+	{
+		company.slots.push_back(std::make_unique<TreeScan>());
+		TreeScan* slot = company.slots.back().get();
+		++company.pendingTasks;
+		run.pool.Submit([this, &run, &company, child, companyPath, slot]()
 			{
-				// game folder
-				if (entry2.is_directory())
 				{
-					bool playerLogFound = false;
-					bool outputLogFound = false;
-					std::string outputLogPath;
-					// files in game folder
-					for (const auto& entry3 : std::filesystem::recursive_directory_iterator(entry2))
-					{
-						// this would be handled by GetUnusedSavePaths(), don't bother with this directory.
-						if (entry3.is_regular_file() && entry3.path().filename() == "Player.log")
-						{
-							playerLogFound = true;
-						}
-						
-						if (entry3.is_regular_file() && entry3.path().filename() == "output_log.txt")
-						{
-							outputLogFound = true;
-							outputLogPath = entry3.path().u8string();
-
-						}
-					}
-
-					// this means the game folder only has output_log.txt, which hasn't been processed yet.
-					if (outputLogFound && !playerLogFound)
-					{
-						std::string path = outputLogPath;
-						// remove Player.log from path to make game name extraction easier
-						std::string gameFolder = path.substr(0, path.find_last_of('\\'));
-
-						unknownSavePaths.push_back(gameFolder);
-					}
+					TraceRecorder::Span treeSpan(run.observer.trace, "tree", "scan", companyPath);
+					ScanTree(child, companyPath, *slot, run);
 				}
+				FinishCompanyTask(run, company);
+			});
+	}
 
+	FinishCompanyTask(run, company);
+}
+/**
+ * @brief Marks one of a company's tasks as done, merging the company once all are.
+ *
+ * The last task to finish puts the slots together in directory order. Companies
+ * whose Player.logs are all known are probed and reported to the observer
+ * straight away, while the rest of the scan carries on.
+ *
+ * @param run The scan this company belongs to.
+ * @param company The company folder the task worked on.
+ */
+void FindSave::FinishCompanyTask(ScanRun& run, CompanyScan& company)
+{
+	if (--company.pendingTasks != 0)
+	{
+		return;
+	}
+
+	bool childHasPlayerLog = false;
+	for (size_t i = 0; i < company.slots.size(); ++i)
+	{
+		if (i != company.ownSlot)
+		{
+			childHasPlayerLog = childHasPlayerLog || company.slots[i]->subtreeHasPlayerLog;
+		}
+	}
+
+	// folders are only kept for the snapshot, which isn't written without results.
+	if (!run.observer.keepResults)
+	{
+		company.directories = std::vector<SnapshotDirectory>();
+	}
+
+	for (size_t i = 0; i < company.slots.size(); ++i)
+	{
+		// tree folders are numbered from their own root, renumber them after the company's.
+		uint32_t base = static_cast<uint32_t>(company.directories.size());
+		for (SnapshotDirectory& directory : company.slots[i]->directories)
+		{
+			if (!run.observer.keepResults)
+			{
+				break;
 			}
+			directory.parent = directory.parent == SnapshotDirectory::NO_PARENT ? 0 : directory.parent + base;
+			company.directories.push_back(std::move(directory));
+		}
+
+		for (std::string& folder : company.slots[i]->pendingLogs)
+		{
+			company.pendingLogs.push_back(std::move(folder));
+		}
 
+		for (SaveEntry& save : company.slots[i]->saves)
+		{
+			// same rule as ScanTree, the company folder's own output_log.txt
+			// doesn't count if a game below it has a Player.log.
+			if (i == company.ownSlot && !save.hasPlayerLog && childHasPlayerLog)
+			{
+				continue;
+			}
+			company.saves.push_back(std::move(save));
 		}
 	}
+	company.slots.clear();
 
+	ResolveUnknownSaves(run, company);
+
+	// companies with Player.logs still to read wait for ReadPendingLogs, the rest are done.
+	if (company.pendingLogs.empty())
+	{
+		ProbeCompany(run, company);
+	}
 }
 /**
- * @brief Attempts to store all paths to save folders that has no game in system.
+ * @brief Looks up the company's Unknown saves in the install index.
  *
- * Goes through LocalAppData, extracts game path from Player.log, and populates the 
- * string vector full of paths of save folders with no games in system.
- * 
+ * The save's game folder is the one directly inside the company, the names
+ * Unity saves under. A save the index has a game for takes the install folder
+ * as its game path and goes to ProbeCompany like any Player.log save.
  *
- *
- * @param path The LocalAppData path, gained from the GetAppDataPath function.
- * @return A string vector, full of paths of save folders with no games (if it exists)
+ * @param run The scan, for the index and the stats.
+ * @param company The merged company.
  */
-void FindSave::GetUnusedSavePaths(const std::string& path)
+void FindSave::ResolveUnknownSaves(const ScanRun& run, CompanyScan& company)
 {
-	if (!unlinkedSavePaths.empty())
+	if (run.installs.GetGameCount() == 0)
 	{
-		unlinkedSavePaths.clear();
+		return;
 	}
-	for (const auto& entry : std::filesystem::directory_iterator(path))
+
+	std::string companyName = company.folder.filename().u8string();
+	for (SaveEntry& save : company.saves)
 	{
-		if (entry.is_directory())
+		if (save.classification != SaveClass::Unknown)
 		{
-			for (const auto& entry2 : std::filesystem::recursive_directory_iterator(entry))
-			{
-				// find Unity related files, and check if the game exists in system.
-				if (entry2.is_regular_file() && entry2.path().filename() == "Player.log")
-				{
-					std::string path = entry2.path().u8string();
-					// remove output_log.txt from path to make game name extraction easier
-					std::string gameFolder = path.substr(0, path.find_last_of('\\'));
-					if (!GameExists(path))
-					{
-						unlinkedSavePaths.push_back(gameFolder);
-					}
+			continue;
+		}
 
+		std::filesystem::path relative = std::filesystem::u8path(save.gamePath).lexically_relative(company.folder);
+		if (relative.empty() || *relative.begin() == ".")
+		{
+			// marker files in the company folder itself, there's no game folder to go by.
+			continue;
+		}
 
-				}
-			}
-			
+		const InstalledGame* game = run.installs.Find(companyName, relative.begin()->u8string());
+		if (game == nullptr)
+		{
+			continue;
+		}
+		save.installPath = game->installPath;
+		save.classification = SaveClass::Unlinked;
+		if (run.observer.stats != nullptr)
+		{
+			++run.observer.stats->unknownResolved;
+		}
+	}
+}
+/**
+ * @brief Reads every Player.log the walk couldn't take from the snapshot, in one batch.
+ *
+ * Reading them all together lets LogBatchReader keep many reads in flight
+ * instead of each walk task waiting on its own. The logs are queued company by
+ * company, and the last log of a company to come in hands the company to the
+ * pool to be finished off (see FinishCompanyLogs), so a company is reported as
+ * soon as its own logs are read rather than after everyone's.
+ *
+ * @param run The scan, its pool is idle by now and is reused for the reads.
+ * @param companies Every company of the scan.
+ */
+void FindSave::ReadPendingLogs(ScanRun& run, std::deque<CompanyScan>& companies)
+{
+	std::vector<std::string> logPaths;
+	// which company each log is for, and where in its headers it goes
+	std::vector<std::pair<CompanyScan*, size_t>> logOwners;
+	for (CompanyScan& company : companies)
+	{
+		company.logHeaders.resize(company.pendingLogs.size());
+		company.logsLeft = company.pendingLogs.size();
+		for (size_t i = 0; i < company.pendingLogs.size(); ++i)
+		{
+			logPaths.push_back((std::filesystem::u8path(company.pendingLogs[i]) / "Player.log").u8string());
+			logOwners.emplace_back(&company, i);
 		}
 	}
 
+	LogBatchReader::ReadAll(logPaths, run.pool, run.ioLimiter, ringLogReads,
+		[this, &run, &logOwners](size_t log, const LogHeader& header)
+		{
+			CompanyScan& company = *logOwners[log].first;
+			company.logHeaders[logOwners[log].second] = header;
+			if (--company.logsLeft == 0)
+			{
+				run.pool.Submit([this, &run, &company]() { FinishCompanyLogs(run, company); });
+			}
+		},
+		run.observer.stats, run.observer.trace, run.observer.cancelled);
+	// the companies whose last log came off the ring may still be finishing.
+	run.pool.Wait();
 }
 /**
- * @brief Gets the LocalAppData path, which is one area Unity stores their saves.
+ * @brief Takes a company's Player.log headers in, then probes and reports it.
  *
- * Simply gives the path to LocalAppData, I don't know the user's desktop name hence why a
- * fixed path isn't an option.
- * 
- * @return The file path to LocalAppData if success, else 'Failed' 
+ * Each header's game path goes into the save (which starts out Unlinked, for
+ * ProbeCompany to decide) and into the folder for the snapshot. A log that
+ * can't be read is read again by the next scan.
+ *
+ * @param run The scan this company belongs to.
+ * @param company A company whose logs have all been read.
  */
-std::string FindSave::GetAppDataPath()
+void FindSave::FinishCompanyLogs(ScanRun& run, CompanyScan& company)
 {
-	PWSTR path = NULL;
-	// get locallow folder
-	HRESULT result = SHGetKnownFolderPath(FOLDERID_LocalAppDataLow, 0, NULL, &path);
-	if (SUCCEEDED(result))
+	std::unordered_map<std::string, const LogHeader*> headerByFolder;
+	for (size_t i = 0; i < company.pendingLogs.size(); ++i)
 	{
-		std::wstring wpath(path);
-		CoTaskMemFree(path); // Free allocated memory
-		return std::string(wpath.begin(), wpath.end());
+		headerByFolder[company.pendingLogs[i]] = &company.logHeaders[i];
 	}
-	else
+
+	for (SaveEntry& save : company.saves)
 	{
-		return "Fail";
+		auto header = headerByFolder.find(save.gamePath);
+		if (header != headerByFolder.end() && header->second->status == LogHeaderStatus::Found)
+		{
+			save.installPath = header->second->installPath;
+			save.classification = SaveClass::Unlinked;
+		}
 	}
 
+	// empty unless the company's folders are kept for the snapshot.
+	for (SnapshotDirectory& directory : company.directories)
+	{
+		auto header = headerByFolder.find(directory.path);
+		if (header == headerByFolder.end())
+		{
+			continue;
+		}
+		if (header->second->status == LogHeaderStatus::Found)
+		{
+			directory.installPath = header->second->installPath;
+		}
+		else if (header->second->status == LogHeaderStatus::Unreadable)
+		{
+			// -1 never matches, so it is read again next time.
+			directory.logSize = -1;
+		}
+	}
+	company.pendingLogs = std::vector<std::string>();
+	company.logHeaders = std::vector<LogHeader>();
 
+	ProbeCompany(run, company);
 }
+/**
+ * @brief Decides Installed/Unlinked for a company's saves that have a game path, then reports it.
+ *
+ * The company's install paths are checked together, so InstallProbe can skip
+ * duplicates and resolve every game under a missing library/drive with a
+ * single stat. Probing per company instead of once per scan costs a few more
+ * stats, paths shared between companies are checked once for each, but lets a
+ * company be reported without waiting on every other company's logs.
+ *
+ * @param run The scan this company belongs to.
+ * @param company A company with nothing left to read.
+ */
+void FindSave::ProbeCompany(ScanRun& run, CompanyScan& company)
+{
+	std::vector<std::string> installPaths;
+	std::vector<SaveEntry*> probedSaves;
+	for (SaveEntry& save : company.saves)
+	{
+		if (!save.installPath.empty())
+		{
+			installPaths.push_back(save.installPath);
+			probedSaves.push_back(&save);
+		}
+	}
 
+	if (!installPaths.empty() && !IsCancelled(run.observer))
+	{
+		StatTimer timer(run.observer.stats != nullptr ? &run.observer.stats->probeMicroseconds : nullptr);
+		TraceRecorder::Span span(run.observer.trace, "probe install paths", "scan", company.folder.u8string());
+		std::vector<bool> installed = InstallProbe::ProbeAll(installPaths, run.observer.stats);
+		for (size_t i = 0; i < probedSaves.size(); ++i)
+		{
+			probedSaves[i]->classification = installed[i] ? SaveClass::Installed : SaveClass::Unlinked;
+		}
+	}
+
+	ReportCompany(run, company);
+}
 /**
- * @brief Searches inside Player.log and attempts to find the game path directory.
+ * @brief Tells the observer a company is fully classified.
  *
- * There are a couple of variations on how Player.log is formatted, I identify and
- * extract the game file path for some of these variations.  
+ * The company's saves are dropped afterwards if the observer doesn't keep results.
  *
- * Then, it checks if the path exists, and if so, it returns true as the game exists
- * in system.
- * 
- * @param path The direct path to the Player.log file, which most Unity games have.
- * for opening and extracting the game file path.
- * @return True if game exists on system, else False.
+ * @param run The scan this company belongs to.
+ * @param company The finished company.
  */
-bool FindSave::GameExists(const std::string& path)
+void FindSave::ReportCompany(ScanRun& run, CompanyScan& company)
 {
-	bool result = false;
+	size_t companiesDone = ++run.companiesDone;
+	if (run.observer.onCompanyScanned && !IsCancelled(run.observer))
+	{
+		run.observer.onCompanyScanned(company.folder.u8string(), company.saves, companiesDone, run.companyCount);
+	}
 
-	std::string stream;
-	std::ifstream file;
-	file.open(path);
-	if (std::getline(file, stream))
+	if (!run.observer.keepResults)
 	{
-		std::string firstLine = stream;
-		// First format: Mono path[0] = (game path)
-		if (firstLine.find("Mono") != std::string::npos)
+		company.saves = std::vector<SaveEntry>();
+	}
+}
+/**
+ * @brief Checks whether the observer asked for the scan to stop.
+ */
+bool FindSave::IsCancelled(const ScanObserver& observer)
+{
+	return observer.cancelled != nullptr && observer.cancelled->load(std::memory_order_relaxed);
+}
+/**
+ * @brief Walks one folder tree and collects every save folder in it.
+ *
+ * Each directory is read at most once. The walk keeps its own stack instead of
+ * re-walking subtrees, and whether a Player.log exists somewhere below a folder
+ * is passed up to its parent when the folder is finished with. That keeps the
+ * "output_log.txt only" check linear in the size of the tree, however deeply
+ * the screenshot/cache/mod folders are nested. Most of those aren't walked at
+ * all, see PruneChildren.
+ *
+ * A folder with output_log.txt is only Unknown if there is no Player.log in it
+ * or anywhere below it, otherwise the Player.log folder speaks for the game.
+ *
+ * @param root The folder to walk, usually a game folder inside a company.
+ * @param companyPath The company folder the tree belongs to.
+ * @param result Filled with the save folders found, in the order they were found,
+ *		  every folder seen (for the snapshot) and whether any Player.log exists in the tree.
+ * @param run The scan, for the previous snapshot and cancellation.
+ */
+void FindSave::ScanTree(const Subfolder& root, const std::string& companyPath, TreeScan& result, const ScanRun& run)
+{
+	struct Frame
+	{
+		Frame(DirectoryReader::Folder&& folder, size_t depth) : folder(std::move(folder)), depth(depth)
+		{
+		}
+
+		// open while its subfolders are walked, they are opened relative to it
+		DirectoryReader::Folder folder;
+		// this folder's index in result.directories
+		uint32_t directory = 0;
+		// levels below the company folder, the root is 1
+		size_t depth = 0;
+		std::vector<Subfolder> children;
+		size_t nextChild = 0;
+		bool subtreeHasPlayerLog = false;
+		// where this folder's entry sits in saves, if it has a marker file
+		size_t saveSlot = SIZE_MAX;
+	};
+
+	std::vector<SaveEntry>& saves = result.saves;
+	// the slots of output_log.txt folders that turned out to have a Player.log below them.
+	std::vector<bool> discarded;
+	std::vector<Frame> stack;
+
+	auto openFolder = [&](const Subfolder& folder, const DirectoryReader::Folder* parentFolder, uint32_t parent, size_t depth)
 		{
-			firstLine = firstLine.substr(firstLine.find_first_of("'"), firstLine.find_last_of("'"));
+			Frame frame(DirectoryReader::Folder(folder.path, folder.mtime, parentFolder), depth);
+			SnapshotDirectory directory;
+			directory.parent = parent;
+			if (!ReadFolder(frame.folder, run, directory, frame.children, result.pendingLogs))
+			{
+				return;
+			}
+			PruneChildren(depth, directory.hasPlayerLog, run, frame.children);
+
+			frame.directory = static_cast<uint32_t>(result.directories.size());
+			frame.subtreeHasPlayerLog = directory.hasPlayerLog;
+			if (directory.hasPlayerLog || directory.hasOutputLog)
+			{
+				frame.saveSlot = saves.size();
+				saves.push_back(MakeSave(companyPath, directory));
+				discarded.push_back(false);
+			}
 
-			// remove apostrophe from string
-			firstLine = firstLine.substr(1, firstLine.size() - 2);
+			result.directories.push_back(std::move(directory));
+			stack.push_back(std::move(frame));
+		};
+
+	openFolder(root, nullptr, SnapshotDirectory::NO_PARENT, 1);
+
+	while (!stack.empty())
+	{
+		if (IsCancelled(run.observer))
+		{
+			return;
 		}
-		// Second line format: [Subsystems] Discovering subsystems at path (game path)
-		else if (firstLine.find("Loading") != std::string::npos)
+
+		Frame& frame = stack.back();
+
+		if (frame.nextChild < frame.children.size())
 		{
-			firstLine = firstLine.substr(firstLine.find_first_of(':') - 1, firstLine.size() - 1);
+			Subfolder child = std::move(frame.children[frame.nextChild++]);
+			// frame is invalidated by the push.
+			openFolder(child, &frame.folder, frame.directory, frame.depth + 1);
+			continue;
+		}
 
+		// folder finished, classify it and hand the Player.log flag to the parent.
+		Frame done = std::move(frame);
+		stack.pop_back();
 
+		if (done.saveSlot != SIZE_MAX && !result.directories[done.directory].hasPlayerLog && done.subtreeHasPlayerLog)
+		{
+			discarded[done.saveSlot] = true;
+		}
+		if (!stack.empty())
+		{
+			stack.back().subtreeHasPlayerLog = stack.back().subtreeHasPlayerLog || done.subtreeHasPlayerLog;
 		}
 		else
 		{
-			// go through line by line until we find the line that includes the word 'path',
-			// which hopefully guarantees the game path.
-			while (stream.find("path") == std::string::npos)
+			result.subtreeHasPlayerLog = done.subtreeHasPlayerLog;
+		}
+	}
+
+	// drop output_log.txt folders whose game is covered by a Player.log further down.
+	size_t kept = 0;
+	for (size_t i = 0; i < saves.size(); ++i)
+	{
+		if (discarded[i])
+		{
+			continue;
+		}
+		if (kept != i)
+		{
+			saves[kept] = std::move(saves[i]);
+		}
+		++kept;
+	}
+	saves.resize(kept);
+}
+/**
+ * @brief Drops the subfolders of a folder that the walk policy doesn't go into.
+ *
+ * A folder past the depth limit, or one whose Player.log already says which game
+ * it is, loses all of its subfolders. Otherwise only the ones on the skip list go.
+ *
+ * @param depth The folder's level below the company, the company itself is 0.
+ * @param hasPlayerLog The folder has a Player.log.
+ * @param run The scan, for the stats.
+ * @param children The folder's subfolders, pruned in place.
+ */
+void FindSave::PruneChildren(size_t depth, bool hasPlayerLog, const ScanRun& run, std::vector<Subfolder>& children) const
+{
+	size_t before = children.size();
+	if (!walkPolicy.CanDescend(depth) || (hasPlayerLog && walkPolicy.GetStopAtPlayerLog()))
+	{
+		children.clear();
+	}
+	else if (!walkPolicy.GetSkipFolders().empty())
+	{
+		children.erase(std::remove_if(children.begin(), children.end(), [this](const Subfolder& child)
 			{
-				std::getline(file, stream);
-			}
-			firstLine = stream;
-			firstLine = firstLine.substr(firstLine.find("path") + 5, firstLine.size());
-			firstLine = firstLine.substr(0, firstLine.find_last_of('/'));
+				return walkPolicy.IsSkipped(child.path.filename().u8string());
+			}), children.end());
+	}
 
+	if (run.observer.stats != nullptr && children.size() != before)
+	{
+		run.observer.stats->foldersSkipped += before - children.size();
+	}
+}
+/**
+ * @brief Lists one folder: its subfolders and which marker files it has.
+ *
+ * If the last snapshot saw this folder with the same mtime, nothing has been
+ * added, removed or renamed in it, so the listing is taken from the snapshot and
+ * the folder isn't read at all. Otherwise the listing says what each entry is,
+ * nothing in it is stat'ed, see DirectoryReader.
+ *
+ * @param folder The folder to list, left open for its subfolders.
+ * @param run The scan, for the previous snapshot.
+ * @param directory Filled with the folder's path, mtime, marker files and Player.log details.
+ * @param children Receives the subfolders, links are left out as they can loop back on themselves.
+ * @param pendingLogs Gets the folder's path if its Player.log has to be read.
+ * @return False if the folder can't be read.
+ */
+bool FindSave::ReadFolder(DirectoryReader::Folder& folder, const ScanRun& run, SnapshotDirectory& directory, std::vector<Subfolder>& children, std::vector<std::string>& pendingLogs)
+{
+	IoLimiter::Slot slot(run.ioLimiter);
+
+	if (!run.reader.ReadMtime(folder, directory.mtime))
+	{
+		return false;
+	}
+	directory.path = folder.GetPath().u8string();
+
+	ScanStats* stats = run.observer.stats;
+	if (stats != nullptr)
+	{
+		++stats->directoriesVisited;
+	}
+
+	// the Player.log's size and mtime, if the listing had them.
+	int64_t logSize = -1;
+	int64_t logMtime = DirectoryReader::NO_MTIME;
 
+	const ScanSnapshot::Record* previous = run.previous != nullptr ? run.previous->Find(directory.path) : nullptr;
+	if (previous != nullptr && previous->mtime == directory.mtime)
+	{
+		if (stats != nullptr)
+		{
+			++stats->folderCacheHits;
+		}
+		directory.hasPlayerLog = (previous->flags & ScanSnapshot::FLAG_PLAYER_LOG) != 0;
+		directory.hasOutputLog = (previous->flags & ScanSnapshot::FLAG_OUTPUT_LOG) != 0;
+
+		auto range = run.previous->GetChildren(*previous);
+		for (const uint32_t* child = range.first; child != range.second; ++child)
+		{
+			children.push_back({ std::filesystem::u8path(run.previous->GetPath(run.previous->GetRecord(*child))) });
+		}
+	}
+	else
+	{
+		if (stats != nullptr)
+		{
+			++stats->directoriesRead;
 		}
+		StatTimer timer(stats != nullptr ? &stats->listingMicroseconds : nullptr);
 
-		std::filesystem::path toUTF8 = std::filesystem::u8path(firstLine);
-		// check if extracted string exists, if it does return true.
-		if (std::filesystem::exists(toUTF8))
+		std::vector<ListedEntry> entries;
+		if (!run.reader.List(folder, entries))
 		{
-			result = true;
+			return false;
+		}
+		if (stats != nullptr)
+		{
+			stats->entriesChecked += entries.size();
 		}
 
+		for (ListedEntry& entry : entries)
+		{
+			if (entry.kind == EntryKind::Directory)
+			{
+				children.push_back({ folder.GetPath() / std::filesystem::u8path(entry.name), entry.mtime });
+			}
+			else if (entry.kind == EntryKind::File && entry.name == "Player.log")
+			{
+				directory.hasPlayerLog = true;
+				logSize = entry.size;
+				logMtime = entry.mtime;
+			}
+			else if (entry.kind == EntryKind::File && entry.name == "output_log.txt")
+			{
+				directory.hasOutputLog = true;
+			}
+		}
 	}
 
-	file.close();
-	return result;
+	// the Player.log stat takes a slot of its own.
+	slot.Release();
+	if (directory.hasPlayerLog)
+	{
+		directory.logSize = logSize;
+		directory.logMtime = logMtime;
+		if (CheckPlayerLog(folder, run, previous, directory))
+		{
+			pendingLogs.push_back(directory.path);
+		}
+	}
+	return true;
 }
+/**
+ * @brief Checks whether a folder's Player.log has to be read for its game path.
+ *
+ * If the log has the same size and mtime as in the last snapshot it isn't opened
+ * at all, the game path from the snapshot is used instead. Otherwise it is read
+ * with every other such log once the walk is over, see ReadPendingLogs.
+ *
+ * @param folder The folder holding the Player.log.
+ * @param run The scan, for the last snapshot and the stats.
+ * @param previous The folder's record in the last snapshot, or nullptr.
+ * @param directory Has the log's size and mtime if the listing had them, NO_MTIME if not.
+ *		  Receives them, and the game path if it came from the snapshot.
+ * @return True if the log has to be read.
+ */
+bool FindSave::CheckPlayerLog(const DirectoryReader::Folder& folder, const ScanRun& run, const ScanSnapshot::Record* previous, SnapshotDirectory& directory)
+{
+	IoLimiter::Slot slot(run.ioLimiter);
 
+	// -1 never matches, so a log we couldn't stat is read again next time.
+	if (directory.logMtime == DirectoryReader::NO_MTIME && !run.reader.ReadFileInfo(folder, "Player.log", directory.logSize, directory.logMtime))
+	{
+		directory.logSize = -1;
+		directory.logMtime = -1;
+	}
 
+	bool unchanged = previous != nullptr
+		&& (previous->flags & ScanSnapshot::FLAG_PLAYER_LOG) != 0
+		&& directory.logSize >= 0
+		&& previous->logSize == directory.logSize
+		&& previous->logMtime == directory.logMtime;
+	if (unchanged)
+	{
+		if (run.observer.stats != nullptr)
+		{
+			++run.observer.stats->logCacheHits;
+		}
+		directory.installPath = std::string(run.previous->GetInstallPath(*previous));
+		return false;
+	}
+	return true;
+}
+/**
+ * @brief Makes the index entry for a folder holding marker files.
+ *
+ * A Player.log with a game path starts out Unlinked until ProbeCompany finds
+ * the game. A log with no game path we recognise can't be linked to anything, so
+ * it is treated like an output_log.txt folder (Unknown).
+ *
+ * @param companyPath The company folder the save is in.
+ * @param directory The save folder, as read by ReadFolder.
+ */
+SaveEntry FindSave::MakeSave(const std::string& companyPath, const SnapshotDirectory& directory)
+{
+	SaveEntry save;
+	save.companyPath = companyPath;
+	save.gamePath = directory.path;
+	save.hasPlayerLog = directory.hasPlayerLog;
+	save.hasOutputLog = directory.hasOutputLog;
+	save.installPath = directory.installPath;
+	save.classification = save.hasPlayerLog && !save.installPath.empty() ? SaveClass::Unlinked : SaveClass::Unknown;
+	save.mtime = directory.mtime;
+	return save;
+}
+/**
+ * @brief Gets the LocalAppData path, which is one area Unity stores their saves.
+ *
+ * Simply gives the path to LocalAppData, I don't know the user's desktop name hence why a
+ * fixed path isn't an option.
+ * 
+ * @return The file path to LocalAppData in UTF-8 if success, else 'Failed' 
+ */
+std::string FindSave::GetAppDataPath()
+{
+#ifndef _WIN32
+	// Unity's stand-in for LocalLow on Linux.
+	const char* home = std::getenv("HOME");
+	if (home == nullptr)
+	{
+		return "Fail";
+	}
+	return (std::filesystem::u8path(home) / ".config" / "unity3d").u8string();
+#else
+	PWSTR path = NULL;
+	// get locallow folder
+	HRESULT result = SHGetKnownFolderPath(FOLDERID_LocalAppDataLow, 0, NULL, &path);
+	if (SUCCEEDED(result))
+	{
+		std::filesystem::path localLow(path);
+		CoTaskMemFree(path); // Free allocated memory
+		return localLow.u8string();
+	}
+	else
+	{
+		return "Fail";
+	}
+#endif
+}
+/**
+ * @brief Gets where the scan snapshot is kept.
+ *
+ * Under LocalAppData rather than LocalLow, so the scan never finds its own file.
+ * Elsewhere it goes in the user's cache folder.
+ *
+ * @return Snapshot path in UTF-8, empty if LocalAppData can't be found.
+ */
+std::string FindSave::GetSnapshotFilePath()
+{
+#ifdef _WIN32
+	PWSTR path = NULL;
+	HRESULT result = SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, NULL, &path);
+	if (!SUCCEEDED(result))
+	{
+		return std::string();
+	}
+
+	std::filesystem::path snapshotFile(path);
+	CoTaskMemFree(path);
+#else
+	std::filesystem::path snapshotFile;
+	const char* cache = std::getenv("XDG_CACHE_HOME");
+	const char* home = std::getenv("HOME");
+	if (cache != nullptr && *cache != '\0')
+	{
+		snapshotFile = std::filesystem::u8path(cache);
+	}
+	else if (home != nullptr)
+	{
+		snapshotFile = std::filesystem::u8path(home) / ".cache";
+	}
+	else
+	{
+		return std::string();
+	}
+#endif
+	snapshotFile /= CONSTANT::SNAPSHOT_FOLDER;
+	snapshotFile /= CONSTANT::SNAPSHOT_FILE;
+	return snapshotFile.u8string();
+}
+/**
+ * @brief Gets where the install index is cached, next to the snapshot.
+ *
+ * @return Cache path in UTF-8, empty if there's nowhere to put it.
+ */
+std::string FindSave::GetInstallIndexFilePath()
+{
+	std::string snapshotFile = GetSnapshotFilePath();
+	if (snapshotFile.empty())
+	{
+		return std::string();
+	}
+	return (std::filesystem::u8path(snapshotFile).parent_path() / CONSTANT::INSTALL_INDEX_FILE).u8string();
+}
+/**
+ * @brief Gets where deleted saves wait to be purged.
+ *
+ * Next to the snapshot, which normally puts it on the same drive as LocalLow so
+ * saves can be moved there with a rename.
+ *
+ * @return Staging folder path in UTF-8, empty if there's nowhere to put it.
+ */
+std::string FindSave::GetStagingFolderPath()
+{
+	std::string snapshotFile = GetSnapshotFilePath();
+	if (snapshotFile.empty())
+	{
+		return std::string();
+	}
+	return (std::filesystem::u8path(snapshotFile).parent_path() / CONSTANT::STAGING_FOLDER).u8string();
+}
 
 /**
  * @brief Extracts game name from path.
  *
- * Gets deepest folder in path, getting the last \ to achieve this.
+ * Gets deepest folder in path, getting the last \ (or /) to achieve this.
  *
  *
  * @param path Should be a string with the game name as the last folder in path.
@@ -259,7 +1186,7 @@ bool FindSave::GameExists(const std::string& path)
  */
 std::string FindSave::ExtractGameName(const std::string& path)
 {
-	return path.substr(path.find_last_of('\\') + 1, path.size() - 1);
+	return path.substr(path.find_last_of("\\/") + 1, path.size() - 1);
 }
 
 /**
@@ -270,101 +1197,75 @@ std::string FindSave::ExtractGameName(const std::string& path)
  */
 void FindSave::RemoveEmptyFolders()
 {
-	for (const std::string& path : companyPath)
+	for (size_t company = 0; company < saveIndex.GetCompanyCount(); ++company)
 	{
-		std::filesystem::path pathToUTF8 = std::filesystem::u8path(path);
+		RemoveEmptyFolder(std::string(saveIndex.GetCompany(company)));
+	}
+}
+/**
+ * @brief Removes one company folder if nothing is left in it.
+ *
+ * @param path The company folder in UTF-8.
+ */
+void FindSave::RemoveEmptyFolder(const std::string& path)
+{
+	std::filesystem::path pathToUTF8 = std::filesystem::u8path(path);
 
-		if (std::filesystem::is_empty(pathToUTF8))
-		{
-			std::filesystem::remove(pathToUTF8);
-		}
+	// a folder that's already gone or can't be read is left alone.
+	std::error_code error;
+	if (std::filesystem::is_empty(pathToUTF8, error) && !error)
+	{
+		std::filesystem::remove(pathToUTF8, error);
 	}
 }
 
 /**
  * @brief Delete the associated PlayerPref registry key alongside the LocalLow folder.
  *
- * Checks if game path exists in the registry, then deletes it.
- * It also checks the company folder afterwards and deletes that as well if empty. 	 
+ * Same as DeletePlayerPrefPaths with a single save, which is better for many.
  *
  * @param path The direct path to the game, used to extract company & game folder.
  */
 void FindSave::DeletePlayerPrefPath(const std::string& path)
 {
-	std::string toBackSlash = FwdSlashToBackSlash(path);
-	std::string removeFluff = toBackSlash.substr(toBackSlash.find("LocalLow\\") + 9, toBackSlash.size());
-	std::string toRegPath = ("SOFTWARE\\" + removeFluff);
-
-	// convert to wstring
-	std::filesystem::path test = std::filesystem::u8path(toRegPath);
-	std::wstring utf8Path = test.wstring();
-
-
-
-	HKEY hKey;
-	LONG result = RegOpenKeyExW(HKEY_CURRENT_USER, utf8Path.c_str(), 0, KEY_READ, &hKey);
-
-	if (result == ERROR_SUCCESS)
-	{
-		LONG deleteKey = RegDeleteKeyW(HKEY_CURRENT_USER, utf8Path.c_str());
-
-		// also delete company folder if its empty.
-		DeleteEmptyRegistryFolder(utf8Path);
-
-
-
-	}
+	DeletePlayerPrefPaths(std::vector<std::string>{ path });
 }
 /**
- * @brief Delete the path directory if it is empty on the registry.
+ * @brief Deletes the PlayerPrefs of many deleted saves in one pass.
  *
- * Used after deleting the PlayerPrefs for associated game.
- * Deletes company folder if it is empty.
- * 
+ * Each game's key goes, and so does its company's key if that leaves it empty.
+ * Safe to call from any thread, batches are applied one at a time.
+ * A LocalLow inside a Wine or Proton prefix has them in the prefix's user.reg.
+ * Otherwise, outside Windows, Unity keeps PlayerPrefs inside the save folder, so there's nothing to do.
  *
- * @param path The direct path to the game in registry.
+ * @param paths The save folders, in UTF-8.
+ * @param root The LocalLow folder they were in, the user's own if empty.
+ * @return How many registry keys were deleted.
  */
-void FindSave::DeleteEmptyRegistryFolder(const std::wstring& path)
+size_t FindSave::DeletePlayerPrefPaths(const std::vector<std::string>& paths, const std::string& root)
 {
-	HKEY hKey;
-	std::wstring utf8Path = path;
+	std::string localLow = root.empty() ? GetAppDataPath() : root;
 
-	// get company name, so we can check inside it.
-	utf8Path = utf8Path.substr(0, utf8Path.find_last_of('\\'));
-	// open reg key
-	LONG result = RegOpenKeyExW(HKEY_CURRENT_USER, utf8Path.c_str(), 0, KEY_READ, &hKey);
-	if (result == ERROR_SUCCESS)
+	std::lock_guard<std::mutex> lock(playerPrefsMutex);
+	// which backend depends on the root, unless one has been set.
+	std::unique_ptr<PlayerPrefsBackend> rootBackend;
+	PlayerPrefsBackend* backend = playerPrefs.get();
+	if (backend == nullptr)
 	{
-		DWORD subKeyCount = 0;
-		// if key exists, check if theres any folders in it, if none, delete.
-		result = RegQueryInfoKeyW(hKey, nullptr, nullptr, nullptr, &subKeyCount, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
-
-		if (result == ERROR_SUCCESS)
-		{
-			if (subKeyCount == 0)
-			{
-				LONG deleteKey = RegDeleteKeyW(HKEY_CURRENT_USER, utf8Path.c_str());
-			}
-		}
+		rootBackend = PlayerPrefsBackend::Create(localLow);
+		backend = rootBackend.get();
 	}
+
+	PlayerPrefsPlan plan = PlayerPrefsCleaner::Plan(*backend, localLow, paths);
+	return PlayerPrefsCleaner::Apply(*backend, plan);
 }
 /**
- * @brief Changes all forward slashes to backslashes for registry path compatibility
- *
- * Finds all double forward slashes which represents one forward slash, and changes
- * them to double back slashes.
- * 
+ * @brief Swaps where PlayerPrefs are deleted from, e.g. for an in-memory stand-in.
  *
- * @param str The string to be evaluated, which should be a path.
+ * @param backend The new backend, nullptr goes back to picking one for each root.
  */
-std::string FindSave::FwdSlashToBackSlash(const std::string& str)
+void FindSave::SetPlayerPrefsBackend(std::unique_ptr<PlayerPrefsBackend> backend)
 {
-	std::string convertedString = str;
-	size_t pos = 0;
-	while ((convertedString.find("//", pos) != std::string::npos))
-	{
-		convertedString.replace(pos, 2, "\\");
-	}
-
-	return convertedString;
-}
\ No newline at end of file
+	std::lock_guard<std::mutex> lock(playerPrefsMutex);
+	playerPrefs = std::move(backend);
+}
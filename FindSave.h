@@ -1,39 +1,173 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <filesystem>
+#include <memory>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include "SaveIndex.h"
+#include "ScanSnapshot.h"
+#include "ScanStats.h"
+#include "TraceRecorder.h"
+#include "WalkPolicy.h"
+#include "DirectoryReader.h"
+#include "LogHeaderReader.h"
+#include "PlayerPrefsBackend.h"
+#include "Constants.h"
+
+class ThreadPool;
+class IoLimiter;
+class InstallIndex;
+
+// Optional hooks into a running scan. Called from the scan's worker threads,
+// so whatever they do has to be thread safe.
+struct ScanObserver
+{
+	// a company folder is done, saves is empty if it had none
+	std::function<void(const std::string& companyPath, const std::vector<SaveEntry>& saves, size_t companiesDone, size_t companyCount)> onCompanyScanned;
+	// set to true from any thread to stop the scan early
+	const std::atomic<bool>* cancelled = nullptr;
+	// false drops each company once it has been reported: nothing is added to the
+	// index and no snapshot is written, so memory doesn't grow with LocalLow
+	bool keepResults = true;
+	// counters to add this scan's work to, optional
+	ScanStats* stats = nullptr;
+	// gets a span per phase, company, folder tree and Player.log read, optional
+	TraceRecorder* trace = nullptr;
+};
 
 class FindSave
 {
 public:
-	void GetUnusedSavePaths(const std::string& path);
-	void GetCompanyPaths(const std::string& path);
-	void GetUnknownSavePaths(const std::string& path);
+	bool ScanSaves(const std::string& path, const ScanObserver& observer = ScanObserver());
+	bool ScanCompanies(const std::vector<std::string>& companyPaths, const ScanObserver& observer = ScanObserver());
+	bool ScanRoots(const std::vector<std::string>& roots, const ScanObserver& observer = ScanObserver());
+	void SetScanThreadCount(unsigned int threadCount);
+	void SetIoLimit(unsigned int limit);
+	void SetWalkPolicy(const WalkPolicy& policy);
+	void SetPortableListing(bool portable);
+	void SetRingLogReads(bool ring);
+	void SetSnapshotPath(const std::string& path);
+	void SetInstallSources(const std::vector<std::string>& steamFolders, const std::string& cacheFile);
+
+	void ClearSaves();
+	void AddCompanySaves(const std::string& companyPath, const std::vector<SaveEntry>& saves);
+	void ReplaceCompanySaves(const std::string& companyPath, const std::vector<SaveEntry>& saves);
+	void SetSaveSize(const std::string& gamePath, const FolderSize& size);
+	void PruneSaveSizes();
 
 	std::string GetAppDataPath();
+	std::string GetSnapshotFilePath();
+	std::string GetInstallIndexFilePath();
+	std::string GetStagingFolderPath();
 	std::string ExtractGameName(const std::string& path);
 
 	void RemoveEmptyFolders();
+	void RemoveEmptyFolder(const std::string& path);
 	void DeletePlayerPrefPath(const std::string& path);
+	size_t DeletePlayerPrefPaths(const std::vector<std::string>& paths, const std::string& root = std::string());
+	void SetPlayerPrefsBackend(std::unique_ptr<PlayerPrefsBackend> backend);
 
 
 
-	std::vector<std::string> GetUnlinkedPathsVector() const { return unlinkedSavePaths; }
-	std::vector<std::string> GetUnknownPathsVector() const { return unknownSavePaths; }
-	std::vector<std::string> GetCompanyPathsVector() const { return companyPath; }
-	
+	const SaveIndex& GetSaveIndex() const { return saveIndex; }
 
 
 
 private:
-	std::string FwdSlashToBackSlash(const std::string& str);
-	bool GameExists(const std::string& path);
+	// a subfolder to walk, with its mtime if the listing had it
+	struct Subfolder
+	{
+		std::filesystem::path path;
+		int64_t mtime = DirectoryReader::NO_MTIME;
+	};
+
+	// results of one folder tree, filled by a single task.
+	struct TreeScan
+	{
+		std::vector<SaveEntry> saves;
+		// every folder walked, parents numbered from the tree's root
+		std::vector<SnapshotDirectory> directories;
+		// folders whose Player.log has to be read, see ReadPendingLogs
+		std::vector<std::string> pendingLogs;
+		bool subtreeHasPlayerLog = false;
+	};
+
+	// one company folder, its trees kept in directory order for merging.
+	struct CompanyScan
+	{
+		std::filesystem::path folder;
+		// from the LocalLow listing, NO_MTIME if it has to be read
+		int64_t mtime = DirectoryReader::NO_MTIME;
+		std::vector<std::unique_ptr<TreeScan>> slots;
+		// slot holding the company folder's own marker files, if any
+		size_t ownSlot = SIZE_MAX;
+		// the company task plus one per tree, the last one out merges the slots
+		std::atomic<size_t> pendingTasks{ 1 };
+		std::vector<SaveEntry> saves;
+		// every folder walked, the company folder first
+		std::vector<SnapshotDirectory> directories;
+		// folders whose Player.log has to be read, gathered from every tree
+		std::vector<std::string> pendingLogs;
+		// their headers, filled in by ReadPendingLogs as they come in
+		std::vector<LogHeader> logHeaders;
+		// logs not in yet, the last one in finishes the company
+		std::atomic<size_t> logsLeft{ 0 };
+	};
+
+	// state shared by every task of one ScanSaves call.
+	struct ScanRun
+	{
+		ThreadPool& pool;
+		const ScanObserver& observer;
+		size_t companyCount;
+		// last scan of the same folder, or nullptr
+		const ScanSnapshot* previous;
+		// shared by every folder listing and log read of the scan
+		IoLimiter* ioLimiter;
+		const DirectoryReader& reader;
+		// for saves with no game path of their own
+		const InstallIndex& installs;
+		std::atomic<size_t> companiesDone{ 0 };
+	};
 
-	void DeleteEmptyRegistryFolder(const std::wstring& path);
+	void RunCompanyScans(std::deque<CompanyScan>& companies, const ScanObserver& observer, const ScanSnapshot* previous);
+	void ListCompanies(const std::string& root, std::deque<CompanyScan>& companies);
+	void ScanCompany(ScanRun& run, CompanyScan& company);
+	void ScanTree(const Subfolder& root, const std::string& companyPath, TreeScan& result, const ScanRun& run);
+	void PruneChildren(size_t depth, bool hasPlayerLog, const ScanRun& run, std::vector<Subfolder>& children) const;
+	bool ReadFolder(DirectoryReader::Folder& folder, const ScanRun& run, SnapshotDirectory& directory, std::vector<Subfolder>& children, std::vector<std::string>& pendingLogs);
+	bool CheckPlayerLog(const DirectoryReader::Folder& folder, const ScanRun& run, const ScanSnapshot::Record* previous, SnapshotDirectory& directory);
+	SaveEntry MakeSave(const std::string& companyPath, const SnapshotDirectory& directory);
+	bool WriteSnapshot(const std::string& root, const std::deque<CompanyScan>& companies);
+	void FinishCompanyTask(ScanRun& run, CompanyScan& company);
+	void ResolveUnknownSaves(const ScanRun& run, CompanyScan& company);
+	void ReadPendingLogs(ScanRun& run, std::deque<CompanyScan>& companies);
+	void FinishCompanyLogs(ScanRun& run, CompanyScan& company);
+	void ProbeCompany(ScanRun& run, CompanyScan& company);
+	void ReportCompany(ScanRun& run, CompanyScan& company);
+	static bool IsCancelled(const ScanObserver& observer);
 
-	std::vector<std::string> unlinkedSavePaths;
-	std::vector<std::string> unknownSavePaths;
-	std::vector<std::string> companyPath;
+	SaveIndex saveIndex;
+	unsigned int scanThreadCount = CONSTANT::SCAN_THREAD_COUNT;
+	unsigned int ioLimit = CONSTANT::SCAN_IO_LIMIT;
+	WalkPolicy walkPolicy;
+	// std::filesystem instead of the platform's listing calls, for benchmarks
+	bool portableListing = false;
+	// io_uring for Player.log reads where the kernel has it, off reads them on the pool
+	bool ringLogReads = true;
 	std::string appDataPath;
+	std::string snapshotPath;
+	// Steam folders for the install index, none leaves output_log.txt saves Unknown
+	std::vector<std::string> steamFolders;
+	std::string installIndexPath;
+	// set by benchmarks, otherwise each cleanup makes one for its root
+	// guarded so cleanups from different threads don't interleave
+	std::unique_ptr<PlayerPrefsBackend> playerPrefs;
+	std::mutex playerPrefsMutex;
 
 };
 
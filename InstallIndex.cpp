@@ -0,0 +1,513 @@
+#include "InstallIndex.h"
+#include "RootDiscovery.h"
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <system_error>
+
+
+namespace
+{
+	const char* const CACHE_MAGIC = "USDINSTALLS\t1";
+	// StateFlags bit Steam sets once an app is fully installed
+	const unsigned long STEAM_FULLY_INSTALLED = 4;
+	// mtime of a source that wasn't there, it counts as changed once it is
+	const int64_t MISSING_MTIME = INT64_MIN;
+
+	/**
+	 * @brief Splits a cache line on tabs.
+	 */
+	std::vector<std::string> SplitFields(const std::string& line)
+	{
+		std::vector<std::string> fields;
+		size_t start = 0;
+		for (;;)
+		{
+			size_t tab = line.find('\t', start);
+			fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+			if (tab == std::string::npos)
+			{
+				return fields;
+			}
+			start = tab + 1;
+		}
+	}
+
+	/**
+	 * @brief Checks that a value can go in a cache line as it is.
+	 */
+	bool IsPlain(const std::string& value)
+	{
+		return value.find_first_of("\t\r\n") == std::string::npos;
+	}
+}
+
+/**
+ * @brief Gets the index of the given Steam folders, from the cache if nothing has changed since it was written.
+ *
+ * @param steamFolders Steam installs to read, see RootDiscovery::FindSteamFolders.
+ * @param cacheFile Where the index is cached, in UTF-8. Empty reads Steam every time.
+ * @param rebuilt Set to true if Steam was read, false if the cache was used. Optional.
+ * @return The index, empty if there is no Steam.
+ */
+InstallIndex InstallIndex::LoadOrBuild(const std::vector<std::filesystem::path>& steamFolders, const std::string& cacheFile, bool* rebuilt)
+{
+	std::vector<std::string> folders;
+	for (const std::filesystem::path& steam : steamFolders)
+	{
+		folders.push_back(steam.u8string());
+	}
+
+	InstallIndex index;
+	if (!cacheFile.empty() && index.Load(cacheFile) && index.steamFolders == folders && index.IsCurrent())
+	{
+		if (rebuilt != nullptr)
+		{
+			*rebuilt = false;
+		}
+		return index;
+	}
+
+	index = InstallIndex();
+	for (const std::filesystem::path& steam : steamFolders)
+	{
+		index.AddSteam(steam);
+	}
+	if (!cacheFile.empty())
+	{
+		index.Save(cacheFile);
+	}
+	if (rebuilt != nullptr)
+	{
+		*rebuilt = true;
+	}
+	return index;
+}
+
+/**
+ * @brief Adds every app installed in every library of a Steam install.
+ *
+ * A library listed by several Steam installs (or twice in one) is only read once.
+ *
+ * @param steam The Steam folder, the one holding steamapps.
+ */
+void InstallIndex::AddSteam(const std::filesystem::path& steam)
+{
+	steamFolders.push_back(steam.u8string());
+	AddSource(steam / "steamapps" / "libraryfolders.vdf");
+
+	std::vector<std::filesystem::path> libraries = RootDiscovery::ReadLibraryFolders(steam);
+	libraries.insert(libraries.begin(), steam);
+	for (const std::filesystem::path& library : libraries)
+	{
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(library, error);
+		if (librariesSeen.insert((error ? library : canonical).u8string()).second)
+		{
+			AddLibrary(library);
+		}
+	}
+}
+
+/**
+ * @brief Adds the apps of one Steam library, one per appmanifest_*.acf.
+ *
+ * The steamapps folder is a source as well, its mtime changes when a manifest
+ * is added or removed.
+ */
+void InstallIndex::AddLibrary(const std::filesystem::path& library)
+{
+	std::filesystem::path steamapps = library / "steamapps";
+	AddSource(steamapps);
+
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(steamapps, error), end; !error && it != end; it.increment(error))
+	{
+		std::string fileName = it->path().filename().u8string();
+		if (fileName.compare(0, 12, "appmanifest_") != 0 || fileName.size() < 16 || fileName.compare(fileName.size() - 4, 4, ".acf") != 0)
+		{
+			continue;
+		}
+
+		AddSource(it->path());
+		++manifestsRead;
+		InstalledGame game;
+		if (ReadManifest(it->path(), library, game))
+		{
+			Add(game);
+		}
+	}
+}
+
+/**
+ * @brief Reads one app out of its manifest, and its Unity names out of its install.
+ *
+ * @param manifest The appmanifest_*.acf.
+ * @param library The library it's in.
+ * @param game Filled with the app.
+ * @return False if the app isn't fully installed or its folder is gone.
+ */
+bool InstallIndex::ReadManifest(const std::filesystem::path& manifest, const std::filesystem::path& library, InstalledGame& game) const
+{
+	std::map<std::string, std::string> values = ReadKeyValues(manifest);
+	const std::string& installDir = values["installdir"];
+	if (installDir.empty())
+	{
+		return false;
+	}
+
+	auto stateFlags = values.find("stateflags");
+	if (stateFlags != values.end() && (std::strtoul(stateFlags->second.c_str(), nullptr, 10) & STEAM_FULLY_INSTALLED) == 0)
+	{
+		return false;
+	}
+
+	std::filesystem::path installFolder = library / "steamapps" / "common" / std::filesystem::u8path(installDir);
+	std::error_code error;
+	if (!std::filesystem::is_directory(installFolder, error))
+	{
+		return false;
+	}
+
+	game.name = values["name"];
+	game.folderName = installDir;
+	game.installPath = installFolder.u8string();
+	game.source = "Steam " + values["appid"];
+	ReadAppInfo(installFolder, game.company, game.product);
+	return true;
+}
+
+/**
+ * @brief Reads the company and product names out of a Unity game's <Game>_Data/app.info.
+ *
+ * Unity writes the company on the first line and the product on the second,
+ * the same names the game's LocalLow folders are under.
+ *
+ * @return False if the folder has no app.info, it isn't a Unity game then.
+ */
+bool InstallIndex::ReadAppInfo(const std::filesystem::path& installFolder, std::string& company, std::string& product)
+{
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(installFolder, error), end; !error && it != end; it.increment(error))
+	{
+		std::string folderName = it->path().filename().u8string();
+		if (folderName.size() < 5 || Normalize(folderName.substr(folderName.size() - 5)) != "data" || folderName[folderName.size() - 5] != '_')
+		{
+			// not <Game>_Data, in any case.
+			continue;
+		}
+
+		std::ifstream input(it->path() / "app.info", std::ios::binary);
+		std::string companyLine;
+		std::string productLine;
+		if (!std::getline(input, companyLine) || !std::getline(input, productLine))
+		{
+			continue;
+		}
+		for (std::string* line : { &companyLine, &productLine })
+		{
+			if (!line->empty() && line->back() == '\r')
+			{
+				line->pop_back();
+			}
+		}
+		if (!companyLine.empty() && !productLine.empty())
+		{
+			company = companyLine;
+			product = productLine;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Reads the top level values of a Valve KeyValues file, like an appmanifest.
+ *
+ * Nested blocks (depots, user config) are stepped over.
+ *
+ * @return The values directly inside the outer block, keys in lower case.
+ */
+std::map<std::string, std::string> InstallIndex::ReadKeyValues(const std::filesystem::path& file)
+{
+	std::ifstream input(file, std::ios::binary);
+	std::string text((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+	std::map<std::string, std::string> values;
+	int depth = 0;
+	std::string key;
+	bool haveKey = false;
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		char c = text[i];
+		if (c == '"')
+		{
+			std::string token;
+			for (++i; i < text.size() && text[i] != '"'; ++i)
+			{
+				// \\ and \" are the only escapes Steam writes.
+				if (text[i] == '\\' && i + 1 < text.size())
+				{
+					++i;
+				}
+				token += text[i];
+			}
+
+			if (!haveKey)
+			{
+				key = std::move(token);
+				haveKey = true;
+				continue;
+			}
+			if (depth == 1)
+			{
+				for (char& keyChar : key)
+				{
+					keyChar = static_cast<char>(std::tolower(static_cast<unsigned char>(keyChar)));
+				}
+				values[key] = std::move(token);
+			}
+			haveKey = false;
+		}
+		else if (c == '{' || c == '}')
+		{
+			depth += c == '{' ? 1 : -1;
+			haveKey = false;
+		}
+		else if (c == '/' && i + 1 < text.size() && text[i + 1] == '/')
+		{
+			i = text.find('\n', i);
+			if (i == std::string::npos)
+			{
+				break;
+			}
+		}
+	}
+	return values;
+}
+
+/**
+ * @brief Adds a game from any launcher.
+ *
+ * Games with Unity names are only found by them. The rest are found by their
+ * name and folder name, unless another such game has the same one.
+ */
+void InstallIndex::Add(const InstalledGame& game)
+{
+	size_t index = games.size();
+	games.push_back(game);
+
+	if (!game.company.empty() && !game.product.empty())
+	{
+		byCompanyProduct.emplace(Normalize(game.company) + '\x1F' + Normalize(game.product), index);
+		return;
+	}
+	AddName(Normalize(game.name), index);
+	AddName(Normalize(game.folderName), index);
+}
+
+/**
+ * @brief Maps a name to a game, or to NO_GAME once a second game has it.
+ */
+void InstallIndex::AddName(const std::string& key, size_t game)
+{
+	if (key.empty())
+	{
+		return;
+	}
+	auto added = byName.emplace(key, game);
+	if (!added.second && added.first->second != game)
+	{
+		added.first->second = NO_GAME;
+	}
+}
+
+/**
+ * @brief Finds the install of the game a LocalLow save folder belongs to.
+ *
+ * @param company The company folder's name.
+ * @param game The game folder's name, the one directly in the company folder.
+ * @return The game, or nullptr if no launcher has it (or several games could be it).
+ */
+const InstalledGame* InstallIndex::Find(std::string_view company, std::string_view game) const
+{
+	std::string productKey = Normalize(game);
+	auto exact = byCompanyProduct.find(Normalize(company) + '\x1F' + productKey);
+	if (exact != byCompanyProduct.end())
+	{
+		return &games[exact->second];
+	}
+
+	auto named = byName.find(productKey);
+	if (named != byName.end() && named->second != NO_GAME)
+	{
+		return &games[named->second];
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Folds a name down to what matters for matching: lower case ASCII letters and digits.
+ *
+ * Bytes of non-ASCII characters are kept as they are.
+ */
+std::string InstallIndex::Normalize(std::string_view name)
+{
+	std::string key;
+	key.reserve(name.size());
+	for (char c : name)
+	{
+		unsigned char byte = static_cast<unsigned char>(c);
+		if (byte >= 0x80)
+		{
+			key += c;
+		}
+		else if (std::isalnum(byte))
+		{
+			key += static_cast<char>(std::tolower(byte));
+		}
+	}
+	return key;
+}
+
+/**
+ * @brief Reads an index written by Save.
+ *
+ * @return False if there is no cache or it isn't one this version wrote.
+ */
+bool InstallIndex::Load(const std::string& cacheFile)
+{
+	std::ifstream input(std::filesystem::u8path(cacheFile), std::ios::binary);
+	std::string line;
+	if (!std::getline(input, line) || line != CACHE_MAGIC)
+	{
+		return false;
+	}
+
+	while (std::getline(input, line))
+	{
+		std::vector<std::string> fields = SplitFields(line);
+		if (fields[0] == "steam" && fields.size() == 2)
+		{
+			steamFolders.push_back(fields[1]);
+		}
+		else if (fields[0] == "source" && fields.size() == 3)
+		{
+			sources.push_back({ fields[2], std::strtoll(fields[1].c_str(), nullptr, 10) });
+		}
+		else if (fields[0] == "game" && fields.size() == 7)
+		{
+			InstalledGame game;
+			game.name = fields[1];
+			game.folderName = fields[2];
+			game.company = fields[3];
+			game.product = fields[4];
+			game.installPath = fields[5];
+			game.source = fields[6];
+			Add(game);
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Writes the index and what it was read from, replacing the old cache once the new one is complete.
+ *
+ * @return False if it couldn't be written, or something in it can't go in a cache line.
+ */
+bool InstallIndex::Save(const std::string& cacheFile) const
+{
+	std::ostringstream out;
+	out << CACHE_MAGIC << '\n';
+	for (const std::string& steam : steamFolders)
+	{
+		if (!IsPlain(steam))
+		{
+			return false;
+		}
+		out << "steam\t" << steam << '\n';
+	}
+	for (const Source& source : sources)
+	{
+		if (!IsPlain(source.path))
+		{
+			return false;
+		}
+		out << "source\t" << source.mtime << '\t' << source.path << '\n';
+	}
+	for (const InstalledGame& game : games)
+	{
+		for (const std::string* field : { &game.name, &game.folderName, &game.company, &game.product, &game.installPath, &game.source })
+		{
+			if (!IsPlain(*field))
+			{
+				return false;
+			}
+		}
+		out << "game\t" << game.name << '\t' << game.folderName << '\t' << game.company << '\t' << game.product
+			<< '\t' << game.installPath << '\t' << game.source << '\n';
+	}
+
+	std::filesystem::path target = std::filesystem::u8path(cacheFile);
+	std::filesystem::path temporary = target;
+	temporary += ".tmp";
+
+	std::error_code error;
+	std::filesystem::create_directories(target.parent_path(), error);
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		std::string contents = out.str();
+		file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+		if (!file)
+		{
+			file.close();
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporary, target, error);
+	return !error;
+}
+
+/**
+ * @brief Checks that nothing the index was read from has changed since.
+ *
+ * One stat per manifest and library, against reading and parsing them all.
+ */
+bool InstallIndex::IsCurrent() const
+{
+	for (const Source& source : sources)
+	{
+		if (ReadSourceMtime(std::filesystem::u8path(source.path)) != source.mtime)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Notes a file or folder the index is being read from.
+ */
+void InstallIndex::AddSource(const std::filesystem::path& path)
+{
+	sources.push_back({ path.u8string(), ReadSourceMtime(path) });
+}
+
+/**
+ * @brief Gets a source's mtime, MISSING_MTIME if it isn't there.
+ */
+int64_t InstallIndex::ReadSourceMtime(const std::filesystem::path& path)
+{
+	std::error_code error;
+	std::filesystem::file_time_type mtime = std::filesystem::last_write_time(path, error);
+	return error ? MISSING_MTIME : static_cast<int64_t>(mtime.time_since_epoch().count());
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A game a launcher says is installed.
+struct InstalledGame
+{
+	// what the launcher calls it
+	std::string name;
+	// the install folder's own name
+	std::string folderName;
+	// from the game's <Game>_Data/app.info, empty if it has none (not a Unity game)
+	std::string company;
+	std::string product;
+	// the install folder, in UTF-8
+	std::string installPath;
+	// where it was found, e.g. "Steam 620"
+	std::string source;
+};
+
+// Every game the launchers on this machine have installed, looked up by the
+// names a Unity save folder is under.
+//
+// Built from Steam: each Steam folder's libraryfolders.vdf lists its libraries,
+// and every appmanifest_*.acf in a library's steamapps names one installed app
+// and its folder under steamapps/common. A Unity game's <Game>_Data/app.info
+// holds the company and product names it saves under in LocalLow, so a save
+// folder's company and game folder names lead straight to its install. Apps
+// without an app.info are found by their Steam name or install folder name alone,
+// as long as only one app goes by it. Other launchers can add their games with Add.
+//
+// Names are normalized (ASCII folded to lower case, anything but letters and
+// digits dropped) before they go into the hash tables, so "Hollow Knight"
+// finds "hollow_knight".
+//
+// Reading every manifest and app.info costs a few hundred file reads, so the
+// index is cached on disk with the mtime of every file and folder it was read
+// from, and only read again from Steam once one of them has changed.
+class InstallIndex
+{
+public:
+	static InstallIndex LoadOrBuild(const std::vector<std::filesystem::path>& steamFolders, const std::string& cacheFile, bool* rebuilt = nullptr);
+
+	void AddSteam(const std::filesystem::path& steam);
+	void Add(const InstalledGame& game);
+	const InstalledGame* Find(std::string_view company, std::string_view game) const;
+
+	bool Load(const std::string& cacheFile);
+	bool Save(const std::string& cacheFile) const;
+	bool IsCurrent() const;
+
+	size_t GetGameCount() const { return games.size(); }
+	size_t GetManifestsRead() const { return manifestsRead; }
+
+	static std::string Normalize(std::string_view name);
+
+private:
+	// a file or folder the index was read from, and its mtime then
+	struct Source
+	{
+		std::string path;
+		int64_t mtime = 0;
+	};
+
+	void AddLibrary(const std::filesystem::path& library);
+	bool ReadManifest(const std::filesystem::path& manifest, const std::filesystem::path& library, InstalledGame& game) const;
+	static bool ReadAppInfo(const std::filesystem::path& installFolder, std::string& company, std::string& product);
+	static std::map<std::string, std::string> ReadKeyValues(const std::filesystem::path& file);
+	void AddSource(const std::filesystem::path& path);
+	static int64_t ReadSourceMtime(const std::filesystem::path& path);
+	void AddName(const std::string& key, size_t game);
+
+	std::vector<InstalledGame> games;
+	// the Steam folders it was built from, in UTF-8
+	std::vector<std::string> steamFolders;
+	std::vector<Source> sources;
+	// every library read so far, links resolved
+	std::set<std::string> librariesSeen;
+	// normalized company, a 0x1F, normalized product
+	std::unordered_map<std::string, size_t> byCompanyProduct;
+	// normalized name or folder name of games without Unity names, NO_GAME if several share it
+	std::unordered_map<std::string, size_t> byName;
+	size_t manifestsRead = 0;
+
+	static constexpr size_t NO_GAME = SIZE_MAX;
+};
@@ -0,0 +1,181 @@
+#include "InstallProbe.h"
+#include "ScanStats.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <cctype>
+
+
+/**
+ * @brief Checks which install paths exist, stat'ing as little as possible.
+ *
+ * @param installPaths Paths extracted from Player.log headers, duplicates are fine.
+ * @param stats Counts the paths stat'ed, optional.
+ * @return One flag per input path, true if it exists.
+ */
+std::vector<bool> InstallProbe::ProbeAll(const std::vector<std::string>& installPaths, ScanStats* stats)
+{
+	Node root;
+	std::vector<Node*> leaves;
+	leaves.reserve(installPaths.size());
+
+	for (const std::string& installPath : installPaths)
+	{
+		Node* node = &root;
+		std::string path;
+		for (const std::string& component : SplitPath(installPath))
+		{
+			// keep the drive root as "C:/" or "/", stat'ing "C:" means the current folder on C.
+			if (path.empty())
+			{
+				path = component + "/";
+			}
+			else
+			{
+				if (path.back() != '/')
+				{
+					path += '/';
+				}
+				path += component;
+			}
+
+			std::unique_ptr<Node>& child = node->children[ComponentKey(component)];
+			if (!child)
+			{
+				child = std::make_unique<Node>();
+				child->path = path;
+			}
+			node = child.get();
+		}
+
+		node->terminal = node != &root;
+		leaves.push_back(node);
+	}
+
+	// the root is only a container, its children are the drives.
+	root.exists = true;
+	for (auto& child : root.children)
+	{
+		ProbeNode(*child.second, stats);
+	}
+
+	std::vector<bool> results;
+	results.reserve(leaves.size());
+	for (const Node* leaf : leaves)
+	{
+		results.push_back(leaf != &root && leaf->exists);
+	}
+	return results;
+}
+
+/**
+ * @brief Checks one folder of the trie, then its children.
+ *
+ * A folder that neither ends a path nor splits into several is skipped, the child
+ * below it answers for it. Once a folder is missing, its whole subtree is.
+ *
+ * @param node The folder to check.
+ * @param stats Counts the paths stat'ed, optional.
+ */
+void InstallProbe::ProbeNode(Node& node, ScanStats* stats)
+{
+	Node* current = &node;
+	// follow single child chains without stat'ing, the end of the chain tells us enough.
+	while (!current->terminal && current->children.size() == 1)
+	{
+		current->exists = true;
+		current = current->children.begin()->second.get();
+	}
+
+	if (stats != nullptr)
+	{
+		++stats->pathsProbed;
+	}
+	if (!PathExists(current->path))
+	{
+		MarkMissing(*current);
+		return;
+	}
+
+	current->exists = true;
+	for (auto& child : current->children)
+	{
+		ProbeNode(*child.second, stats);
+	}
+}
+
+/**
+ * @brief Marks a folder and everything under it as missing, without touching the disk.
+ */
+void InstallProbe::MarkMissing(Node& node)
+{
+	node.exists = false;
+	for (auto& child : node.children)
+	{
+		MarkMissing(*child.second);
+	}
+}
+
+/**
+ * @brief Stats one path.
+ *
+ * Only a clear "not found" counts as missing. Anything else (access denied, drive
+ * not ready) counts as existing, we'd rather miss an orphaned save than offer to
+ * delete the save of a game that is still there.
+ */
+bool InstallProbe::PathExists(const std::string& path)
+{
+	std::error_code error;
+	bool exists = std::filesystem::exists(std::filesystem::u8path(path), error);
+	return exists || error;
+}
+
+/**
+ * @brief Splits a path into folders, accepting both slash styles.
+ *
+ * A leading slash becomes an empty first component, so "/home/x" and "C:/x" both
+ * start with their root.
+ */
+std::vector<std::string> InstallProbe::SplitPath(const std::string& path)
+{
+	std::vector<std::string> components;
+	std::string component;
+	for (size_t i = 0; i < path.size(); ++i)
+	{
+		char c = path[i];
+		if (c != '/' && c != '\\')
+		{
+			component += c;
+			continue;
+		}
+
+		if (!component.empty() || i == 0)
+		{
+			components.push_back(component);
+		}
+		component.clear();
+	}
+	if (!component.empty())
+	{
+		components.push_back(component);
+	}
+
+	return components;
+}
+
+/**
+ * @brief Key used to match folders, Windows paths are case insensitive.
+ */
+std::string InstallProbe::ComponentKey(const std::string& component)
+{
+#ifdef _WIN32
+	std::string key = component;
+	for (char& c : key)
+	{
+		c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	}
+	return key;
+#else
+	return component;
+#endif
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+struct ScanStats;
+
+// Answers "is this game still installed" for a set of install paths at once.
+//
+// The paths are put in a trie of path components, so duplicates collapse and games
+// sharing a library folder share its node. The trie is checked from the top down:
+// a missing folder makes everything under it missing without another stat, and
+// only folders where paths split (or end) are stat'ed at all.
+//
+// A scan probes each company's games on their own as soon as the company's logs
+// are read, on whichever thread finished them, so companies waiting on a slow
+// network/sleeping drive are checked in parallel with each other.
+class InstallProbe
+{
+public:
+	static std::vector<bool> ProbeAll(const std::vector<std::string>& installPaths, ScanStats* stats = nullptr);
+
+private:
+	struct Node
+	{
+		// path up to and including this component, as written in the first log that had it
+		std::string path;
+		std::map<std::string, std::unique_ptr<Node>> children;
+		// an install path ends here
+		bool terminal = false;
+		bool exists = false;
+	};
+
+	static std::vector<std::string> SplitPath(const std::string& path);
+	static std::string ComponentKey(const std::string& component);
+	static void ProbeNode(Node& node, ScanStats* stats);
+	static void MarkMissing(Node& node);
+	static bool PathExists(const std::string& path);
+};
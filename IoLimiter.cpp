@@ -0,0 +1,58 @@
+#include "IoLimiter.h"
+
+
+/**
+ * @brief Makes a limiter shared by one scan.
+ *
+ * @param limit Operations allowed at once, 0 doesn't limit anything.
+ */
+IoLimiter::IoLimiter(unsigned int limit) : limit(limit)
+{
+}
+
+/**
+ * @brief Waits for a free slot, unless there is no limit.
+ */
+IoLimiter::Slot::Slot(IoLimiter* limiter) : limiter(limiter != nullptr && limiter->limit != 0 ? limiter : nullptr)
+{
+	if (this->limiter != nullptr)
+	{
+		this->limiter->Acquire();
+	}
+}
+
+/**
+ * @brief Gives the slot back to the next waiting operation.
+ */
+IoLimiter::Slot::~Slot()
+{
+	Release();
+}
+
+/**
+ * @brief Gives the slot back early, once the operation is done with the disk.
+ */
+void IoLimiter::Slot::Release()
+{
+	if (limiter != nullptr)
+	{
+		limiter->Release();
+		limiter = nullptr;
+	}
+}
+
+void IoLimiter::Acquire()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	released.wait(lock, [this]() { return inFlight < limit; });
+	++inFlight;
+}
+
+void IoLimiter::Release()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		--inFlight;
+	}
+	released.notify_one();
+}
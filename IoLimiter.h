@@ -0,0 +1,47 @@
+#pragma once
+#include <condition_variable>
+#include <mutex>
+
+// Caps how many filesystem operations are in flight at once, across every
+// thread that shares it.
+//
+// A scan over many roots runs on one pool, and the pool may have more threads
+// than the disks behind the roots can usefully serve. Each folder listing or
+// log read holds a Slot for as long as it touches the disk, the rest of the
+// work (merging, classifying) runs unlimited.
+class IoLimiter
+{
+public:
+	explicit IoLimiter(unsigned int limit);
+
+	IoLimiter(const IoLimiter&) = delete;
+	IoLimiter& operator=(const IoLimiter&) = delete;
+
+	// one operation's turn, held until it goes out of scope. A null limiter lets everything through.
+	class Slot
+	{
+	public:
+		explicit Slot(IoLimiter* limiter);
+		~Slot();
+
+		Slot(const Slot&) = delete;
+		Slot& operator=(const Slot&) = delete;
+
+		void Release();
+
+	private:
+		IoLimiter* limiter;
+	};
+
+	unsigned int GetLimit() const { return limit; }
+
+private:
+	void Acquire();
+	void Release();
+
+	// 0 means unlimited
+	unsigned int limit;
+	unsigned int inFlight = 0;
+	std::mutex mutex;
+	std::condition_variable released;
+};
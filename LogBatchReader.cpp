@@ -0,0 +1,516 @@
+#include "LogBatchReader.h"
+#include "ThreadPool.h"
+#include "IoLimiter.h"
+#include "ScanStats.h"
+#include "TraceRecorder.h"
+#include "Constants.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#endif
+
+
+namespace
+{
+	bool IsCancelled(const std::atomic<bool>* cancelled)
+	{
+		return cancelled != nullptr && cancelled->load(std::memory_order_relaxed);
+	}
+
+	uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+#ifdef __linux__
+	// A bare io_uring, set up with the raw syscalls so nothing beyond the
+	// kernel headers is needed. Only used from the thread that made it.
+	class Ring
+	{
+	public:
+		explicit Ring(unsigned int entries)
+		{
+			io_uring_params params;
+			std::memset(&params, 0, sizeof(params));
+			fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+			if (fd < 0)
+			{
+				return;
+			}
+
+			sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+			cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (singleMap)
+			{
+				sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+			}
+
+			sqRing = Map(sqRingBytes, IORING_OFF_SQ_RING);
+			cqRing = singleMap ? sqRing : Map(cqRingBytes, IORING_OFF_CQ_RING);
+			sqeBytes = params.sq_entries * sizeof(io_uring_sqe);
+			sqes = static_cast<io_uring_sqe*>(Map(sqeBytes, IORING_OFF_SQES));
+			if (sqRing == nullptr || cqRing == nullptr || sqes == nullptr)
+			{
+				Close();
+				return;
+			}
+
+			char* sq = static_cast<char*>(sqRing);
+			sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+			sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+			sqMask = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+			sqEntries = params.sq_entries;
+			sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+
+			char* cq = static_cast<char*>(cqRing);
+			cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+			cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+			cqMask = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+			cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+		}
+
+		~Ring()
+		{
+			Close();
+		}
+
+		Ring(const Ring&) = delete;
+		Ring& operator=(const Ring&) = delete;
+
+		bool IsOpen() const { return fd >= 0; }
+
+		// the kernel has every opcode given, needs 5.6 for the probe itself.
+		bool Supports(const std::vector<uint8_t>& opcodes) const
+		{
+			const unsigned int opCount = 256;
+			std::unique_ptr<char[]> buffer(new char[sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op)]());
+			io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.get());
+			if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, opCount) < 0)
+			{
+				return false;
+			}
+			for (uint8_t opcode : opcodes)
+			{
+				if (opcode > probe->last_op || (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) == 0)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// the next free submission entry, zeroed, or nullptr if the queue is full
+		io_uring_sqe* NextEntry()
+		{
+			unsigned int head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+			if (queuedTail - head >= sqEntries)
+			{
+				return nullptr;
+			}
+
+			unsigned int index = queuedTail & sqMask;
+			io_uring_sqe* entry = &sqes[index];
+			std::memset(entry, 0, sizeof(*entry));
+			sqArray[index] = index;
+			++queuedTail;
+			++unsubmitted;
+			return entry;
+		}
+
+		// hands the queued entries to the kernel and waits for at least one completion.
+		bool SubmitAndWait()
+		{
+			__atomic_store_n(sqTail, queuedTail, __ATOMIC_RELEASE);
+			for (;;)
+			{
+				long result = ::syscall(__NR_io_uring_enter, fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+				if (result >= 0)
+				{
+					unsubmitted -= std::min(unsubmitted, static_cast<unsigned int>(result));
+					return true;
+				}
+				if (errno != EINTR)
+				{
+					return false;
+				}
+			}
+		}
+
+		bool PopCompletion(io_uring_cqe& completion)
+		{
+			unsigned int head = *cqHead;
+			if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+			{
+				return false;
+			}
+			completion = cqes[head & cqMask];
+			__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+			return true;
+		}
+
+	private:
+		void* Map(size_t bytes, off_t offset)
+		{
+			void* map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+			return map == MAP_FAILED ? nullptr : map;
+		}
+
+		void Close()
+		{
+			if (sqes != nullptr)
+			{
+				::munmap(sqes, sqeBytes);
+			}
+			if (cqRing != nullptr && cqRing != sqRing)
+			{
+				::munmap(cqRing, cqRingBytes);
+			}
+			if (sqRing != nullptr)
+			{
+				::munmap(sqRing, sqRingBytes);
+			}
+			sqes = nullptr;
+			cqRing = nullptr;
+			sqRing = nullptr;
+			if (fd >= 0)
+			{
+				::close(fd);
+				fd = -1;
+			}
+		}
+
+		int fd = -1;
+		void* sqRing = nullptr;
+		void* cqRing = nullptr;
+		io_uring_sqe* sqes = nullptr;
+		size_t sqRingBytes = 0;
+		size_t cqRingBytes = 0;
+		size_t sqeBytes = 0;
+
+		unsigned int* sqHead = nullptr;
+		unsigned int* sqTail = nullptr;
+		unsigned int* sqArray = nullptr;
+		unsigned int sqMask = 0;
+		unsigned int sqEntries = 0;
+		unsigned int* cqHead = nullptr;
+		unsigned int* cqTail = nullptr;
+		unsigned int cqMask = 0;
+		io_uring_cqe* cqes = nullptr;
+
+		// our own copy of the tail, published on submit
+		unsigned int queuedTail = 0;
+		unsigned int unsubmitted = 0;
+	};
+
+	const std::vector<uint8_t> RING_OPCODES = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE };
+#endif
+}
+
+/**
+ * @brief Reads the header of every log, io_uring first if it's there, the pool for the rest.
+ *
+ * @param paths Player.log paths in UTF-8.
+ * @param pool Pool for the logs io_uring didn't read. Must be idle, this waits on it.
+ * @param ioLimiter The scan's limiter. Its limit also caps the logs in flight on the ring. Optional.
+ * @param useRing Try io_uring, false always reads on the pool.
+ * @param onLogRead Called once per log as soon as its header is final, Unreadable
+ *		  if it couldn't be read. From this thread for the ring and from the pool's
+ *		  threads for the rest, so possibly several at once.
+ * @param stats Counts the logs opened and bytes read, optional.
+ * @param trace Gets a span per log, optional.
+ * @param cancelled Stops starting new logs once set, optional. Logs not started aren't passed on.
+ */
+void LogBatchReader::ReadAll(const std::vector<std::string>& paths, ThreadPool& pool, IoLimiter* ioLimiter, bool useRing, const LogCallback& onLogRead,
+	ScanStats* stats, TraceRecorder* trace, const std::atomic<bool>* cancelled)
+{
+	std::vector<bool> done(paths.size(), false);
+	if (paths.empty())
+	{
+		return;
+	}
+
+	if (useRing && IsRingAvailable())
+	{
+		unsigned int limit = ioLimiter != nullptr ? ioLimiter->GetLimit() : 0;
+		unsigned int depth = limit != 0 ? limit : CONSTANT::LOG_RING_DEPTH;
+		depth = static_cast<unsigned int>(std::min<size_t>(depth, paths.size()));
+		// whatever a broken ring left unread goes to the pool below.
+		ReadOnRing(paths, depth, onLogRead, done, stats, trace, cancelled);
+	}
+
+	ReadOnPool(paths, pool, ioLimiter, onLogRead, done, stats, trace, cancelled);
+}
+
+/**
+ * @brief Checks once whether this kernel lets us open, read and close files through io_uring.
+ */
+bool LogBatchReader::IsRingAvailable()
+{
+#ifdef __linux__
+	static const bool available = []()
+		{
+			Ring ring(1);
+			return ring.IsOpen() && ring.Supports(RING_OPCODES);
+		}();
+	return available;
+#else
+	return false;
+#endif
+}
+
+/**
+ * @brief Reads logs through one io_uring, up to depth of them at a time.
+ *
+ * Every log in flight owns a slot with its own buffer and goes open, read, close,
+ * one submission at a time. A new log takes the slot as soon as the close is in.
+ *
+ * @param done Set for every log passed to onLogRead.
+ * @return False if the ring couldn't be set up or failed part way.
+ */
+bool LogBatchReader::ReadOnRing(const std::vector<std::string>& paths, unsigned int depth, const LogCallback& onLogRead, std::vector<bool>& done,
+	ScanStats* stats, TraceRecorder* trace, const std::atomic<bool>* cancelled)
+{
+#ifdef __linux__
+	Ring ring(depth);
+	if (!ring.IsOpen())
+	{
+		return false;
+	}
+
+	enum class Stage { Open, Read, Close };
+	struct Slot
+	{
+		size_t log = 0;
+		int fd = -1;
+		Stage stage = Stage::Open;
+		std::string buffer;
+		TraceRecorder::Clock::time_point start;
+	};
+
+	const size_t maxBytes = CONSTANT::LOG_HEADER_BYTES;
+	std::vector<Slot> slots(depth);
+	std::vector<size_t> freeSlots;
+	for (size_t i = depth; i-- > 0;)
+	{
+		slots[i].buffer.resize(maxBytes);
+		freeSlots.push_back(i);
+	}
+
+	// one entry per busy slot, so the queue (depth long) never runs out.
+	auto queueOpen = [&](size_t index)
+		{
+			Slot& slot = slots[index];
+			io_uring_sqe* entry = ring.NextEntry();
+			entry->opcode = IORING_OP_OPENAT;
+			entry->fd = AT_FDCWD;
+			entry->addr = reinterpret_cast<uint64_t>(paths[slot.log].c_str());
+			entry->open_flags = O_RDONLY | O_CLOEXEC;
+			entry->user_data = index;
+			slot.stage = Stage::Open;
+		};
+	auto queueRead = [&](size_t index)
+		{
+			Slot& slot = slots[index];
+			io_uring_sqe* entry = ring.NextEntry();
+			entry->opcode = IORING_OP_READ;
+			entry->fd = slot.fd;
+			entry->addr = reinterpret_cast<uint64_t>(slot.buffer.data());
+			entry->len = static_cast<uint32_t>(maxBytes);
+			entry->off = 0;
+			entry->user_data = index;
+			slot.stage = Stage::Read;
+		};
+	auto queueClose = [&](size_t index)
+		{
+			Slot& slot = slots[index];
+			io_uring_sqe* entry = ring.NextEntry();
+			entry->opcode = IORING_OP_CLOSE;
+			entry->fd = slot.fd;
+			entry->user_data = index;
+			slot.stage = Stage::Close;
+		};
+
+	std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+	size_t next = 0;
+	bool failed = false;
+	for (;;)
+	{
+		while (!freeSlots.empty() && next < paths.size() && !IsCancelled(cancelled))
+		{
+			size_t index = freeSlots.back();
+			freeSlots.pop_back();
+			slots[index].log = next++;
+			slots[index].start = TraceRecorder::Clock::now();
+			queueOpen(index);
+		}
+		if (freeSlots.size() == slots.size())
+		{
+			break;
+		}
+
+		if (!ring.SubmitAndWait())
+		{
+			failed = true;
+			break;
+		}
+
+		io_uring_cqe completion;
+		while (ring.PopCompletion(completion))
+		{
+			size_t index = static_cast<size_t>(completion.user_data);
+			Slot& slot = slots[index];
+			int result = completion.res;
+
+			if (slot.stage == Stage::Open)
+			{
+				if (result < 0)
+				{
+					// can't be opened, Unreadable.
+					done[slot.log] = true;
+					onLogRead(slot.log, LogHeader());
+					freeSlots.push_back(index);
+					continue;
+				}
+				slot.fd = result;
+				queueRead(index);
+			}
+			else if (slot.stage == Stage::Read)
+			{
+				if (result == -EINTR || result == -EAGAIN)
+				{
+					queueRead(index);
+					continue;
+				}
+				LogHeader header;
+				if (result >= 0)
+				{
+					header = LogHeaderReader::Parse(std::string_view(slot.buffer.data(), static_cast<size_t>(result)), maxBytes);
+					if (stats != nullptr)
+					{
+						++stats->filesOpened;
+						++stats->logsReadOnRing;
+						stats->bytesRead += header.bytesRead;
+					}
+				}
+				done[slot.log] = true;
+				// the close goes in first, so it runs while the header is handled.
+				queueClose(index);
+				onLogRead(slot.log, header);
+			}
+			else
+			{
+				slot.fd = -1;
+				if (trace != nullptr)
+				{
+					trace->Record("Player.log", "scan", slot.start, TraceRecorder::Clock::now(), paths[slot.log]);
+				}
+				freeSlots.push_back(index);
+			}
+		}
+	}
+
+	if (failed)
+	{
+		// what the kernel already has still reads into the slots' buffers and opens
+		// files, so every busy slot is waited for before either goes. Logs caught
+		// part way aren't passed on, the pool reads them again.
+		size_t busy = slots.size() - freeSlots.size();
+		while (busy > 0 && ring.SubmitAndWait())
+		{
+			io_uring_cqe completion;
+			while (ring.PopCompletion(completion))
+			{
+				Slot& slot = slots[static_cast<size_t>(completion.user_data)];
+				if (slot.stage == Stage::Open && completion.res >= 0)
+				{
+					::close(completion.res);
+				}
+				else if (slot.stage == Stage::Read)
+				{
+					::close(slot.fd);
+				}
+				slot.fd = -1;
+				--busy;
+			}
+		}
+
+		if (busy > 0)
+		{
+			// the ring won't even wait now. Files it opened and hasn't handed
+			// back are lost, the buffers are left to it rather than freed under it.
+			for (Slot& slot : slots)
+			{
+				if (slot.stage == Stage::Read && slot.fd >= 0)
+				{
+					::close(slot.fd);
+				}
+			}
+			new std::vector<Slot>(std::move(slots));
+		}
+	}
+	if (stats != nullptr)
+	{
+		stats->logReadMicroseconds += MicrosecondsSince(started);
+	}
+	return !failed;
+#else
+	return false;
+#endif
+}
+
+/**
+ * @brief Reads the logs the ring didn't on the pool, one task per log.
+ *
+ * @param done Logs already read, skipped here.
+ */
+void LogBatchReader::ReadOnPool(const std::vector<std::string>& paths, ThreadPool& pool, IoLimiter* ioLimiter, const LogCallback& onLogRead, const std::vector<bool>& done,
+	ScanStats* stats, TraceRecorder* trace, const std::atomic<bool>* cancelled)
+{
+	for (size_t i = 0; i < paths.size(); ++i)
+	{
+		if (done[i])
+		{
+			continue;
+		}
+
+		pool.Submit([&paths, &onLogRead, i, ioLimiter, stats, trace, cancelled]()
+			{
+				if (IsCancelled(cancelled))
+				{
+					return;
+				}
+
+				LogHeader header;
+				{
+					IoLimiter::Slot slot(ioLimiter);
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					TraceRecorder::Span span(trace, "Player.log", "scan", paths[i]);
+					header = LogHeaderReader::Read(paths[i]);
+					if (stats != nullptr)
+					{
+						if (header.status != LogHeaderStatus::Unreadable)
+						{
+							++stats->filesOpened;
+							stats->bytesRead += header.bytesRead;
+						}
+						stats->logReadMicroseconds += MicrosecondsSince(start);
+					}
+				}
+				onLogRead(i, header);
+			});
+	}
+	pool.Wait();
+}
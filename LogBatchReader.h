@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include "LogHeaderReader.h"
+
+class ThreadPool;
+class IoLimiter;
+class TraceRecorder;
+struct ScanStats;
+
+// Reads the headers of a whole scan's worth of Player.logs in one go.
+//
+// The walk only notes which logs it needs, so here every one of them is known up
+// front. On Linux they go through one io_uring: each log is an openat, a single
+// read of its first LOG_HEADER_BYTES and a close, with a bounded number of logs
+// in flight, so a cold cache or a slow disk works through them back to back
+// instead of the scan waiting out one open/read/close round trip after another.
+// Each read is matched by LogHeaderReader::Parse as soon as it completes, while
+// the others are still in flight, and handed on right away, so whoever is
+// waiting on a few of the logs can carry on before the rest are read.
+//
+// Where there is no io_uring (Windows, kernels before 5.6, sandboxes that block
+// it) or it's turned off, the logs are read with LogHeaderReader::Read on the
+// pool, each holding an IoLimiter slot.
+class LogBatchReader
+{
+public:
+	// gets each log's index in paths and its header, once the header is final
+	using LogCallback = std::function<void(size_t log, const LogHeader& header)>;
+
+	static void ReadAll(const std::vector<std::string>& paths, ThreadPool& pool, IoLimiter* ioLimiter, bool useRing, const LogCallback& onLogRead,
+		ScanStats* stats = nullptr, TraceRecorder* trace = nullptr, const std::atomic<bool>* cancelled = nullptr);
+	static bool IsRingAvailable();
+
+private:
+	static bool ReadOnRing(const std::vector<std::string>& paths, unsigned int depth, const LogCallback& onLogRead, std::vector<bool>& done,
+		ScanStats* stats, TraceRecorder* trace, const std::atomic<bool>* cancelled);
+	static void ReadOnPool(const std::vector<std::string>& paths, ThreadPool& pool, IoLimiter* ioLimiter, const LogCallback& onLogRead, const std::vector<bool>& done,
+		ScanStats* stats, TraceRecorder* trace, const std::atomic<bool>* cancelled);
+};
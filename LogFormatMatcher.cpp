@@ -0,0 +1,262 @@
+#include "LogFormatMatcher.h"
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace
+{
+	// One header line layout: keyword, then the install path.
+	struct LogPattern
+	{
+		std::string_view keyword;
+		LogFormat format;
+		// the path runs up to this character, '\n' means the end of the line
+		char terminator;
+		// the path ends in a file/folder inside the game, drop it
+		bool dropLastComponent;
+		// a loose match, only used if nothing else matched anywhere in the header
+		bool fallback;
+	};
+
+	constexpr LogPattern patterns[] =
+	{
+		{ "Mono path[0] = '", LogFormat::MonoPath, '\'', false, false },
+		{ "Mono config path = '", LogFormat::MonoConfigPath, '\'', false, false },
+		{ "Loading player data from ", LogFormat::Loading, '\n', false, false },
+		{ "Discovering subsystems at path ", LogFormat::SubsystemsPath, '\n', true, false },
+		{ "Player data archive not found at `", LogFormat::DataArchive, '`', false, false },
+		// any other line with the word 'path' in it, which hopefully guarantees the game path.
+		{ "path ", LogFormat::PathLine, '\n', true, true },
+	};
+
+	constexpr size_t patternCount = std::size(patterns);
+	static_assert(patternCount <= 8, "pattern matches are kept in an 8 bit mask");
+
+	constexpr size_t CountStates()
+	{
+		size_t states = 1;
+		for (const LogPattern& pattern : patterns)
+		{
+			states += pattern.keyword.size();
+		}
+		return states;
+	}
+
+	constexpr size_t CountClasses()
+	{
+		std::array<bool, 256> used{};
+		size_t classes = 1;
+		for (const LogPattern& pattern : patterns)
+		{
+			for (char c : pattern.keyword)
+			{
+				unsigned char byte = static_cast<unsigned char>(c);
+				if (!used[byte])
+				{
+					used[byte] = true;
+					++classes;
+				}
+			}
+		}
+		return classes;
+	}
+
+	constexpr size_t maxStates = CountStates();
+	constexpr size_t classCount = CountClasses();
+	static_assert(maxStates <= 256, "states are stored as 8 bit");
+
+	// The keywords as a DFA. Bytes that appear in no keyword share class 0,
+	// which keeps the table small enough to stay in cache.
+	struct Automaton
+	{
+		std::array<uint8_t, 256> byteClass{};
+		std::array<std::array<uint8_t, classCount>, maxStates> next{};
+		// bit i set means patterns[i] ends at this state
+		std::array<uint8_t, maxStates> matches{};
+	};
+
+	constexpr Automaton BuildAutomaton()
+	{
+		Automaton automaton{};
+
+		size_t classes = 1;
+		for (const LogPattern& pattern : patterns)
+		{
+			for (char c : pattern.keyword)
+			{
+				unsigned char byte = static_cast<unsigned char>(c);
+				if (automaton.byteClass[byte] == 0)
+				{
+					automaton.byteClass[byte] = static_cast<uint8_t>(classes++);
+				}
+			}
+		}
+
+		// trie of the keywords, 0 means no edge (nothing points back at the root).
+		std::array<std::array<uint8_t, classCount>, maxStates> trie{};
+		size_t states = 1;
+		for (size_t i = 0; i < patternCount; ++i)
+		{
+			size_t state = 0;
+			for (char c : patterns[i].keyword)
+			{
+				uint8_t cls = automaton.byteClass[static_cast<unsigned char>(c)];
+				if (trie[state][cls] == 0)
+				{
+					trie[state][cls] = static_cast<uint8_t>(states++);
+				}
+				state = trie[state][cls];
+			}
+			automaton.matches[state] |= static_cast<uint8_t>(1u << i);
+		}
+
+		// breadth first, so every failure link points at a finished state.
+		std::array<uint8_t, maxStates> fail{};
+		std::array<uint8_t, maxStates> queue{};
+		size_t head = 0;
+		size_t tail = 0;
+
+		for (size_t cls = 0; cls < classCount; ++cls)
+		{
+			uint8_t child = trie[0][cls];
+			automaton.next[0][cls] = child;
+			if (child != 0)
+			{
+				fail[child] = 0;
+				queue[tail++] = child;
+			}
+		}
+
+		while (head < tail)
+		{
+			uint8_t state = queue[head++];
+			automaton.matches[state] |= automaton.matches[fail[state]];
+
+			for (size_t cls = 0; cls < classCount; ++cls)
+			{
+				uint8_t child = trie[state][cls];
+				if (child != 0)
+				{
+					fail[child] = automaton.next[fail[state]][cls];
+					automaton.next[state][cls] = child;
+					queue[tail++] = child;
+				}
+				else
+				{
+					automaton.next[state][cls] = automaton.next[fail[state]][cls];
+				}
+			}
+		}
+
+		return automaton;
+	}
+
+	constexpr Automaton automaton = BuildAutomaton();
+
+	/**
+	 * @brief Cuts the install path out of the header, starting right after a keyword.
+	 *
+	 * @param header The whole header buffer.
+	 * @param start Index of the first character after the keyword.
+	 * @param pattern The layout that matched.
+	 * @param path Receives the install path.
+	 * @return False if the line doesn't actually hold a path (e.g. no closing quote).
+	 */
+	bool ExtractPath(std::string_view header, size_t start, const LogPattern& pattern, std::string_view& path)
+	{
+		size_t lineEnd = header.find_first_of("\r\n", start);
+		std::string_view rest = header.substr(start, lineEnd == std::string_view::npos ? std::string_view::npos : lineEnd - start);
+
+		if (pattern.terminator != '\n')
+		{
+			size_t end = rest.find(pattern.terminator);
+			if (end == std::string_view::npos)
+			{
+				return false;
+			}
+			rest = rest.substr(0, end);
+		}
+
+		if (pattern.dropLastComponent)
+		{
+			rest = rest.substr(0, rest.find_last_of('/'));
+		}
+
+		while (!rest.empty() && rest.back() == ' ')
+		{
+			rest.remove_suffix(1);
+		}
+
+		path = rest;
+		return !path.empty();
+	}
+}
+
+
+/**
+ * @brief Finds the install path in a Player.log header in a single pass.
+ *
+ * The first exact layout found wins straight away. The loose "path" layout is
+ * only remembered, and used if the whole header has nothing better.
+ *
+ * @param header The start of the log, see LogHeaderReader.
+ * @return The install path and which layout it came from, NotFound if none matched.
+ */
+LogHeader LogFormatMatcher::Match(std::string_view header)
+{
+	LogHeader result;
+	result.status = LogHeaderStatus::NotFound;
+
+	std::string_view fallbackPath;
+	LogFormat fallbackFormat = LogFormat::None;
+
+	uint8_t state = 0;
+	for (size_t i = 0; i < header.size(); ++i)
+	{
+		state = automaton.next[state][automaton.byteClass[static_cast<unsigned char>(header[i])]];
+		uint8_t matched = automaton.matches[state];
+		if (matched == 0)
+		{
+			continue;
+		}
+
+		for (size_t p = 0; p < patternCount; ++p)
+		{
+			if ((matched & (1u << p)) == 0)
+			{
+				continue;
+			}
+
+			const LogPattern& pattern = patterns[p];
+			std::string_view path;
+			if (!ExtractPath(header, i + 1, pattern, path))
+			{
+				continue;
+			}
+
+			if (!pattern.fallback)
+			{
+				result.status = LogHeaderStatus::Found;
+				result.format = pattern.format;
+				result.installPath = std::string(path);
+				return result;
+			}
+			if (fallbackFormat == LogFormat::None)
+			{
+				fallbackPath = path;
+				fallbackFormat = pattern.format;
+			}
+		}
+	}
+
+	if (fallbackFormat != LogFormat::None)
+	{
+		result.status = LogHeaderStatus::Found;
+		result.format = fallbackFormat;
+		result.installPath = std::string(fallbackPath);
+	}
+
+	return result;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string_view>
+#include "LogHeaderReader.h"
+
+// Finds the game install path in a Player.log header, whichever layout it uses.
+//
+// Every known header line is a keyword followed by the path. All keywords are
+// compiled into one Aho-Corasick automaton at compile time, so the header is
+// walked once, a byte at a time, no matter how many layouts there are.
+// Adding a layout is one more row in the pattern table in LogFormatMatcher.cpp.
+class LogFormatMatcher
+{
+public:
+	static LogHeader Match(std::string_view header);
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <string_view>
+#include "LogHeaderReader.h"
+
+// Player.log headers as Unity writes them, with the path LogFormatMatcher should
+// pull out of each. Used to check the matcher and to measure its throughput.
+// Install paths have been swapped for made up ones, the rest is as found in the wild.
+namespace LOG_CORPUS
+{
+	struct Sample
+	{
+		std::string_view name;
+		std::string_view header;
+		LogFormat format;
+		std::string_view installPath;
+	};
+
+	constexpr Sample SAMPLES[] =
+	{
+		{
+			"mono-2017-windows",
+			"Mono path[0] = 'C:/Program Files (x86)/Steam/steamapps/common/Hollow Game/Hollow Game_Data/Managed'\r\n"
+			"Mono config path = 'C:/Program Files (x86)/Steam/steamapps/common/Hollow Game/Mono/etc'\r\n"
+			"PlayerConnection initialized from C:/Program Files (x86)/Steam/steamapps/common/Hollow Game/Hollow Game_Data (debug = 0)\r\n"
+			"PlayerConnection initialized network socket : 0.0.0.0 55162\r\n",
+			LogFormat::MonoPath,
+			"C:/Program Files (x86)/Steam/steamapps/common/Hollow Game/Hollow Game_Data/Managed"
+		},
+		{
+			"mono-2019-linux",
+			"Mono path[0] = '/home/user/.local/share/Steam/steamapps/common/Tiny Farm/TinyFarm_Data/Managed'\n"
+			"Mono config path = '/home/user/.local/share/Steam/steamapps/common/Tiny Farm/TinyFarm_Data/MonoBleedingEdge/etc'\n"
+			"Preloaded 'lib_burst_generated.so'\n",
+			LogFormat::MonoPath,
+			"/home/user/.local/share/Steam/steamapps/common/Tiny Farm/TinyFarm_Data/Managed"
+		},
+		{
+			"mono-config-only",
+			"[Physics::Module] Initialized MultithreadedJobDispatcher with 7 workers.\r\n"
+			"Mono config path = 'D:/SteamLibrary/steamapps/common/Orbit/MonoBleedingEdge/etc'\r\n",
+			LogFormat::MonoConfigPath,
+			"D:/SteamLibrary/steamapps/common/Orbit/MonoBleedingEdge/etc"
+		},
+		{
+			"loading-5x",
+			"Loading player data from D:/Games/Old Castle/Old Castle_Data/data.unity3d\r\n"
+			"Initialize engine version: 5.6.7f1 (e80cc3114ac1)\r\n"
+			"GfxDevice: creating device client; threaded=1\r\n",
+			LogFormat::Loading,
+			"D:/Games/Old Castle/Old Castle_Data/data.unity3d"
+		},
+		{
+			"subsystems-2020",
+			"[Subsystems] Discovering subsystems at path E:/Epic Games/Sky Rails/Sky Rails_Data/UnitySubsystems\r\n"
+			"GfxDevice: creating device client; threaded=1; jobified=1\r\n"
+			"Direct3D:\r\n"
+			"    Version:  Direct3D 11.0 [level 11.1]\r\n",
+			LogFormat::SubsystemsPath,
+			"E:/Epic Games/Sky Rails/Sky Rails_Data"
+		},
+		{
+			"data-archive-2021",
+			"Initialize engine version: 2021.3.16f1 (4016570cf34f)\r\n"
+			"Player data archive not found at `C:/GOG Games/Moth Lantern/Moth Lantern_Data/data.unity3d`, using local filesystem\r\n"
+			"[Subsystems] Discovering subsystems at path C:/GOG Games/Moth Lantern/Moth Lantern_Data/UnitySubsystems\r\n",
+			LogFormat::DataArchive,
+			"C:/GOG Games/Moth Lantern/Moth Lantern_Data/data.unity3d"
+		},
+		{
+			"subsystems-after-gfx",
+			"Initialize engine version: 2022.3.5f1 (9674261d40ee)\r\n"
+			"[Subsystems] Discovering subsystems at path C:/Games/Deep Well/Deep Well_Data/UnitySubsystems\r\n",
+			LogFormat::SubsystemsPath,
+			"C:/Games/Deep Well/Deep Well_Data"
+		},
+		{
+			"loose-path-line",
+			"Initialize engine version: 2018.4.36f1 (6cd387d23174)\r\n"
+			"Fallback handler could not load library at path C:/Games/Grid Runner/Grid Runner_Data/Mono/mono.dll\r\n",
+			LogFormat::PathLine,
+			"C:/Games/Grid Runner/Grid Runner_Data/Mono"
+		},
+		{
+			"no-path",
+			"Initialize engine version: 2019.4.40f1 (ffc62b691db5)\r\n"
+			"GfxDevice: creating device client; threaded=1\r\n"
+			"Begin MonoManager ReloadAssembly\r\n",
+			LogFormat::None,
+			""
+		},
+		{
+			"empty",
+			"",
+			LogFormat::None,
+			""
+		},
+	};
+}
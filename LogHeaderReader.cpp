@@ -0,0 +1,119 @@
+#include "LogHeaderReader.h"
+#include "LogFormatMatcher.h"
+#include <string>
+#include <string_view>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+
+/**
+ * @brief Reads the start of a Player.log and extracts the game install path from it.
+ *
+ * Only the first maxBytes of the log are ever read, with a single read call, so
+ * a log that has grown to hundreds of MB costs the same as a fresh one. Unity
+ * writes the lines we're after right at the start, so nothing is lost.
+ *
+ * @param path The direct path to the Player.log file.
+ * @param maxBytes How much of the log to read at most.
+ * @return The install path and which header layout it came from, or why there is none.
+ */
+LogHeader LogHeaderReader::Read(const std::string& path, size_t maxBytes)
+{
+	// reused between logs, every scan thread gets its own.
+	thread_local std::string buffer;
+
+	if (!ReadPrefix(path, maxBytes, buffer))
+	{
+		return LogHeader();
+	}
+	return Parse(buffer, maxBytes);
+}
+
+/**
+ * @brief Extracts the game install path from the start of a Player.log read elsewhere.
+ *
+ * For logs read in batches, see LogBatchReader.
+ *
+ * @param prefix The first bytes of the log, at most maxBytes.
+ * @param maxBytes How much was asked for, a prefix this long was cut short.
+ * @return The install path and which header layout it came from, or why there is none.
+ */
+LogHeader LogHeaderReader::Parse(std::string_view prefix, size_t maxBytes)
+{
+	std::string_view header = prefix;
+	// a full buffer most likely cut the last line in half, don't trust it.
+	if (prefix.size() == maxBytes)
+	{
+		size_t lastNewLine = header.find_last_of('\n');
+		header = lastNewLine == std::string_view::npos ? std::string_view() : header.substr(0, lastNewLine);
+	}
+
+	LogHeader result = LogFormatMatcher::Match(header);
+	result.bytesRead = prefix.size();
+	return result;
+}
+
+/**
+ * @brief Reads up to maxBytes from the start of a file in one call.
+ *
+ * The log is opened with full sharing, as the game may still be running and writing to it.
+ *
+ * @param path Path to the file, in UTF-8.
+ * @param maxBytes How much to read at most.
+ * @param buffer Receives the bytes read.
+ * @return False if the file couldn't be opened or read.
+ */
+bool LogHeaderReader::ReadPrefix(const std::string& path, size_t maxBytes, std::string& buffer)
+{
+	buffer.resize(maxBytes);
+
+#ifdef _WIN32
+	std::wstring widePath = std::filesystem::u8path(path).wstring();
+	HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		buffer.clear();
+		return false;
+	}
+
+	DWORD bytesRead = 0;
+	BOOL readOk = ReadFile(file, buffer.data(), static_cast<DWORD>(maxBytes), &bytesRead, nullptr);
+	CloseHandle(file);
+	if (!readOk)
+	{
+		buffer.clear();
+		return false;
+	}
+	buffer.resize(bytesRead);
+#else
+	int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0)
+	{
+		buffer.clear();
+		return false;
+	}
+
+	ssize_t bytesRead;
+	do
+	{
+		bytesRead = pread(file, buffer.data(), maxBytes, 0);
+	} while (bytesRead < 0 && errno == EINTR);
+	close(file);
+	if (bytesRead < 0)
+	{
+		buffer.clear();
+		return false;
+	}
+	buffer.resize(static_cast<size_t>(bytesRead));
+#endif
+
+	return true;
+}
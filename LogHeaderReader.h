@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include "Constants.h"
+
+// Which of the known Player.log header layouts the install path came from.
+enum class LogFormat
+{
+	None,
+	MonoPath,		// Mono path[0] = '(game path)'
+	MonoConfigPath,	// Mono config path = '(game path)'
+	Loading,		// Loading player data from (game path)
+	SubsystemsPath,	// [Subsystems] Discovering subsystems at path (game path)/UnitySubsystems
+	DataArchive,	// Player data archive not found at `(game path)`, using local filesystem
+	PathLine		// any other line with "path (game path)/..."
+};
+
+enum class LogHeaderStatus
+{
+	Found,		// install path extracted
+	NotFound,	// log read, but no known header in the prefix
+	Unreadable	// log couldn't be opened or read
+};
+
+// What the start of a Player.log says about the game.
+struct LogHeader
+{
+	LogHeaderStatus status = LogHeaderStatus::Unreadable;
+	LogFormat format = LogFormat::None;
+	std::string installPath;
+	// bytes read from the log to get here
+	size_t bytesRead = 0;
+};
+
+class LogHeaderReader
+{
+public:
+	static LogHeader Read(const std::string& path, size_t maxBytes = CONSTANT::LOG_HEADER_BYTES);
+	static LogHeader Parse(std::string_view prefix, size_t maxBytes = CONSTANT::LOG_HEADER_BYTES);
+
+private:
+	static bool ReadPrefix(const std::string& path, size_t maxBytes, std::string& buffer);
+};
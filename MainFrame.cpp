@@ -1,8 +1,22 @@
 #include "MainFrame.h"
 #include <wx/wx.h>
+#include <wx/filename.h>
 #include "FindSave.h"
+#include "RootDiscovery.h"
 #include "Constants.h"
+#include <wx/filedlg.h>
+#include <wx/stdpaths.h>
 #include <filesystem>
+#include <mutex>
+#include <utility>
+
+wxDEFINE_EVENT(EVT_SCAN_BATCH, wxThreadEvent);
+wxDEFINE_EVENT(EVT_SCAN_FINISHED, wxThreadEvent);
+wxDEFINE_EVENT(EVT_WATCH_CHANGES, wxThreadEvent);
+wxDEFINE_EVENT(EVT_DELETE_PROGRESS, wxThreadEvent);
+wxDEFINE_EVENT(EVT_DELETE_FINISHED, wxThreadEvent);
+wxDEFINE_EVENT(EVT_SIZE_BATCH, wxThreadEvent);
+wxDEFINE_EVENT(EVT_SIZES_FINISHED, wxThreadEvent);
 
 
 
@@ -11,25 +25,116 @@
  *
  * Initializes all the elements using wxWidgets which include:
  * 2 uneditable text labels
- * 2 CheckListBox
- * 4 buttons
+ * 2 checkable save lists
+ * 5 buttons
+ * 1 progress bar, 1 checkbox and a status bar
+ *
+ * The lists start with the last scan if one was saved, or empty otherwise.
+ * The scan runs in the background and fills them in as results come in, so
+ * the window shows up straight away. Once it is done LocalLow is watched and
+ * the lists are kept up to date as folders change. Save sizes are measured at
+ * low priority behind the scan and fill in as they come.
  *
+ * Ctrl+Shift+D turns on instrumentation and opens the debug panel.
  *
  * @param title The title of the program which appears on top of the program.
  * @return Constructor
  */
 MainFrame::MainFrame(const wxString& title) : wxFrame(nullptr, wxID_ANY, title)
 {
-	// populate vector with path data
+	launchTime = std::chrono::steady_clock::now();
 	appDataPath = finder.GetAppDataPath();
-	finder.GetCompanyPaths(appDataPath);
-	finder.GetUnusedSavePaths(appDataPath);
-	finder.GetUnknownSavePaths(appDataPath);
 
 	wxPanel* panel = new wxPanel(this);
 	AddSavePathForm(panel,CONSTANT::UNLINKED_FORM_TITLE);
 	AddSavePathForm(panel, CONSTANT::UNKNOWN_FORM_TITLE, 1, CONSTANT::FORM_X_OFFSET);
 
+	// scan progress
+	scanProgress = new wxGauge(panel,
+		wxID_ANY,
+		100,
+		wxPoint(CONSTANT::SCAN_GAUGE_POS.first, CONSTANT::SCAN_GAUGE_POS.second),
+		wxSize(CONSTANT::SCAN_GAUGE_SIZE.first, CONSTANT::SCAN_GAUGE_SIZE.second));
+
+	cancelButton = new wxButton(panel,
+		wxID_ANY,
+		"Cancel",
+		wxPoint(CONSTANT::CANCEL_BUTTON_POS.first, CONSTANT::CANCEL_BUTTON_POS.second),
+		wxSize(CONSTANT::CANCEL_BUTTON_SIZE.first, CONSTANT::CANCEL_BUTTON_SIZE.second));
+	cancelButton->Bind(wxEVT_BUTTON, &MainFrame::OnCancelScanClicked, this);
+
+	undoButton = new wxButton(panel,
+		wxID_ANY,
+		"Undo delete",
+		wxPoint(CONSTANT::UNDO_BUTTON_POS.first, CONSTANT::UNDO_BUTTON_POS.second),
+		wxSize(CONSTANT::UNDO_BUTTON_SIZE.first, CONSTANT::UNDO_BUTTON_SIZE.second));
+	undoButton->Bind(wxEVT_BUTTON, &MainFrame::OnUndoDeleteClicked, this);
+	undoButton->Disable();
+
+	archiveCheckBox = new wxCheckBox(panel,
+		wxID_ANY,
+		"Zip first",
+		wxPoint(CONSTANT::ARCHIVE_CHECKBOX_POS.first, CONSTANT::ARCHIVE_CHECKBOX_POS.second));
+	archiveCheckBox->SetToolTip("Write the checked saves into a zip file before deleting them");
+
+	// scan status on the left, timings on the right
+	CreateStatusBar(2);
+
+	Bind(EVT_SCAN_BATCH, &MainFrame::OnScanBatch, this);
+	Bind(EVT_SCAN_FINISHED, &MainFrame::OnScanFinished, this);
+	Bind(EVT_WATCH_CHANGES, &MainFrame::OnWatchChanges, this);
+	Bind(EVT_DELETE_PROGRESS, &MainFrame::OnDeleteProgress, this);
+	Bind(EVT_DELETE_FINISHED, &MainFrame::OnDeleteFinished, this);
+	Bind(EVT_SIZE_BATCH, &MainFrame::OnSizeBatch, this);
+	Bind(EVT_SIZES_FINISHED, &MainFrame::OnSizesFinished, this);
+	Bind(wxEVT_CLOSE_WINDOW, &MainFrame::OnClose, this);
+
+	int debugPanelId = wxWindow::NewControlId();
+	wxAcceleratorEntry shortcuts[1];
+	shortcuts[0].Set(wxACCEL_CTRL | wxACCEL_SHIFT, 'D', debugPanelId);
+	SetAcceleratorTable(wxAcceleratorTable(1, shortcuts));
+	Bind(wxEVT_MENU, &MainFrame::OnDebugPanelShortcut, this, debugPanelId);
+
+	// runs once the event loop is going, which is when the window is actually up.
+	CallAfter([this]()
+		{
+			windowShownTime = std::chrono::steady_clock::now();
+			UpdateTimings();
+		});
+
+	// saves deleted last time but not purged yet are purged now.
+	std::string stagingPath = finder.GetStagingFolderPath();
+	if (!stagingPath.empty())
+	{
+		staging = std::make_unique<SaveStaging>(stagingPath);
+		staging->Start([this](const std::vector<std::string>& originalPaths)
+			{
+				// PlayerPrefs stay until the save can't come back.
+				finder.DeletePlayerPrefPaths(originalPaths);
+				CallAfter([this]() { UpdateUndoButton(); });
+			});
+	}
+
+	snapshotPath = finder.GetSnapshotFilePath();
+	installIndexPath = finder.GetInstallIndexFilePath();
+	for (const std::filesystem::path& steam : RootDiscovery::FindSteamFolders())
+	{
+		steamFolders.push_back(steam.u8string());
+	}
+	ShowSnapshot();
+	RescanDirectory();
+}
+
+/**
+ * @brief Stops any running scan or deletion before the frame goes away.
+ */
+MainFrame::~MainFrame()
+{
+	StopWatching();
+	StopScan();
+	StopDeletion();
+	StopSizing();
+	staging.reset();
 }
 
 /**
@@ -62,18 +167,24 @@ void MainFrame::AddSavePathForm(wxPanel* panel,std::string formTitle,int pathTyp
 		formTitle,
 		wxPoint(CONSTANT::LIST_TITLE_POS.first + posXOffset, CONSTANT::LIST_TITLE_POS.second + posYOffset));
 
-	// convert string paths to a wxArrayString
-	wxArrayString choices = GenerateCheckListElements(pathType);
-	
-
-	// checklist
-
-	// populate list with games
-	wxCheckListBox* pathList = new wxCheckListBox(panel,
-		wxID_ANY,
+	// checklist, its rows come straight from the save index.
+	SaveListCtrl* pathList = new SaveListCtrl(panel,
 		wxPoint(CONSTANT::LISTBOX_POS.first + posXOffset, CONSTANT::LISTBOX_POS.second + posYOffset),
 		wxSize(CONSTANT::LISTBOX_SIZE.first, CONSTANT::LISTBOX_SIZE.second),
-		choices);
+		finder.GetSaveIndex(),
+		pathType == 0 ? SaveClass::Unlinked : SaveClass::Unknown);
+	pathLists[pathType] = pathList;
+
+	// what the checked saves add up to
+	wxStaticText* checkedTotal = new wxStaticText(panel,
+		wxID_ANY,
+		"",
+		wxPoint(CONSTANT::CHECKED_TOTAL_POS.first + posXOffset, CONSTANT::CHECKED_TOTAL_POS.second + posYOffset));
+	pathList->SetTotalLabel(checkedTotal);
+
+	// no rescanning or deleting while a scan is filling the lists
+	scanLockedButtons.push_back(rescanButton);
+	scanLockedButtons.push_back(deleteButton);
 
 	// bind buttons to functions
 	rescanButton->Bind(wxEVT_BUTTON, [this, pathList, pathType](wxCommandEvent& event) { this->OnRescanClicked(event, pathList, pathType); });
@@ -83,185 +194,1184 @@ void MainFrame::AddSavePathForm(wxPanel* panel,std::string formTitle,int pathTyp
 }
 
 /**
- * @brief Deletes selected elements from the CheckListBox
+ * @brief Deletes checked saves from the list
  *
  * Deletes the save files located in LocalLow and PlayerPrefs in registry.
  * Also checks if the company folder is empty afterwards, and removes that 
  * in LocalLow and Registry.
-
-
+ * The checked saves are moved into the staging folder first, which is instant,
+ * and taken out of the lists straight away. They can be undone until the purger
+ * deletes them for good. Any that can't be moved (another drive) are handed to a
+ * background thread as one batch, and OnDeleteFinished reports the outcome and rescans.
+ * With "Zip first" checked the saves are written into a zip file instead, and each
+ * one is deleted as soon as it is in there, with no staging as the zip is the way back.
+ *
  * @param event Required for event handling
- * @param list The list of elements in the CheckListBox
+ * @param list The list whose checked saves are deleted
  * @param pathType 0 means list with unlinked game paths, whilst 1 is unknown game paths
  *		  used to differentiate which button is pressed and which list to use.
  */
-void MainFrame::OnDeleteClicked(wxCommandEvent& event, wxCheckListBox* list, int pathType)
+void MainFrame::OnDeleteClicked(wxCommandEvent& event, SaveListCtrl* list, int pathType)
 {
+	// the lists are still being filled, rows may not line up with the index yet.
+	if (scanning || deleting)
+	{
+		return;
+	}
+
 	// early return if 0 checked items
-	wxArrayInt checkedItems;
-	list->GetCheckedItems(checkedItems);
-	if (checkedItems.empty())
+	std::vector<std::string> checkedPaths = list->GetCheckedPaths();
+	if (checkedPaths.empty())
 	{
 		wxMessageBox("No checked items");
 		return;
 	}
 
-	// go thru all list elements, get checked items & delete
-	for (int i = 0; i < list->GetCount(); ++i)
+	std::string archiveFile;
+	if (archiveCheckBox->IsChecked())
+	{
+		wxFileDialog saveDialog(this,
+			"Zip the saves before deleting them",
+			wxStandardPaths::Get().GetDocumentsDir(),
+			"Unity saves " + wxDateTime::Now().Format("%Y-%m-%d %H-%M") + ".zip",
+			"Zip archive (*.zip)|*.zip",
+			wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+		if (saveDialog.ShowModal() != wxID_OK)
+		{
+			return;
+		}
+		archiveFile = saveDialog.GetPath().ToStdString(wxConvUTF8);
+	}
+	else if (staging)
+	{
+		StageResult staged = staging->StageAll(checkedPaths);
+		RemoveSavesFromLists(staged.staged);
+		UpdateUndoButton();
+		SetStatusText(wxString::Format("Deleted %llu saves, they can be undone for %d seconds",
+			static_cast<unsigned long long>(staged.staged.size()), CONSTANT::UNDO_WINDOW_MS / 1000), 0);
+
+		checkedPaths = std::move(staged.unstaged);
+		if (checkedPaths.empty())
+		{
+			return;
+		}
+	}
+
+	// the rescan after the deletion catches up on everything, the watcher would only repeat it.
+	StopWatching();
+	StopDeletion();
+
+	cancelDelete = false;
+	SetDeleting(true);
+	scanProgress->SetValue(0);
+	SetStatusText(wxString::Format(archiveFile.empty() ? "Deleting %llu saves..." : "Zipping and deleting %llu saves...",
+		static_cast<unsigned long long>(checkedPaths.size())), 0);
+
+	deleteThread = std::thread(&MainFrame::RunDeletion, this, std::move(checkedPaths), std::move(archiveFile));
+}
+
+/**
+ * @brief Deletes the saves on the background thread and posts progress to the frame.
+ *
+ * PlayerPrefs of the saves that went are deleted in one batch at the end,
+ * along with company folders left empty.
+ *
+ * @param paths The checked save folders.
+ * @param archiveFile Zip to write each save into before it is deleted, empty for none.
+ */
+void MainFrame::RunDeletion(std::vector<std::string> paths, std::string archiveFile)
+{
+	DeletionObserver observer;
+	observer.cancelled = &cancelDelete;
+	observer.trace = instrumented ? &trace : nullptr;
+	observer.onProgress = [this](const DeletionProgress& progress)
+		{
+			wxThreadEvent* event = new wxThreadEvent(EVT_DELETE_PROGRESS);
+			event->SetPayload(progress);
+			wxQueueEvent(this, event);
+		};
+	std::vector<std::string> deleted;
+	std::mutex deletedMutex;
+	observer.onItemDeleted = [&deleted, &deletedMutex](const std::string& path)
+		{
+			std::lock_guard<std::mutex> lock(deletedMutex);
+			deleted.push_back(path);
+		};
+
+	DeletionEngine engine;
+	engine.SetArchive(archiveFile);
+	DeletionSummary summary = engine.DeleteAll(paths, observer);
+
+	// delete PlayerPref keys for the games that went, in one pass over the registry.
+	finder.DeletePlayerPrefPaths(deleted);
+
+	// only the companies the saves were in can have been left empty.
+	std::set<std::string> companyPaths;
+	for (const std::string& path : deleted)
+	{
+		companyPaths.insert(std::filesystem::u8path(path).parent_path().u8string());
+	}
+	for (const std::string& companyPath : companyPaths)
+	{
+		finder.RemoveEmptyFolder(companyPath);
+	}
+
+	wxThreadEvent* event = new wxThreadEvent(EVT_DELETE_FINISHED);
+	event->SetPayload(summary);
+	wxQueueEvent(this, event);
+}
+
+/**
+ * @brief Shows how far the deletion has got.
+ *
+ * @param event Carries a DeletionProgress.
+ */
+void MainFrame::OnDeleteProgress(wxThreadEvent& event)
+{
+	if (!deleting)
+	{
+		return;
+	}
+
+	DeletionProgress progress = event.GetPayload<DeletionProgress>();
+	if (progress.itemCount > 0)
+	{
+		scanProgress->SetValue(static_cast<int>(progress.itemsDone * 100 / progress.itemCount));
+	}
+	wxString archived;
+	if (progress.itemsArchived > 0)
+	{
+		archived = wxString::Format("%llu zipped, ", static_cast<unsigned long long>(progress.itemsArchived));
+	}
+	SetStatusText(wxString::Format("Deleting... %llu/%llu saves, ",
+		static_cast<unsigned long long>(progress.itemsDone),
+		static_cast<unsigned long long>(progress.itemCount))
+		+ archived
+		+ wxString::Format("%llu files, ", static_cast<unsigned long long>(progress.filesRemoved))
+		+ wxFileName::GetHumanReadableSize(wxULongLong(progress.bytesRemoved)), 0);
+}
+
+/**
+ * @brief Reports how the deletion went in one message, then rescans.
+ *
+ * @param event Carries a DeletionSummary.
+ */
+void MainFrame::OnDeleteFinished(wxThreadEvent& event)
+{
+	if (deleteThread.joinable())
+	{
+		deleteThread.join();
+	}
+
+	DeletionSummary summary = event.GetPayload<DeletionSummary>();
+	lastDeletion = summary;
+	hasDeleted = true;
+	UpdateDebugPanel();
+	SetDeleting(false);
+	scanProgress->SetValue(summary.cancelled ? 0 : 100);
+	SetStatusText(summary.cancelled ? "Deletion cancelled" : "Saves deleted", 0);
+
+	wxString message = wxString::Format("Deleted %llu of %llu saves (%llu files, ",
+		static_cast<unsigned long long>(summary.itemsDeleted),
+		static_cast<unsigned long long>(summary.itemCount),
+		static_cast<unsigned long long>(summary.filesRemoved))
+		+ wxFileName::GetHumanReadableSize(wxULongLong(summary.bytesRemoved)) + ").";
+	if (summary.archive.bytesWritten > 0)
 	{
-		if (list->IsChecked(i))
+		message += wxString::Format("\nZipped %llu saves first, ", static_cast<unsigned long long>(summary.archive.itemsArchived))
+			+ wxFileName::GetHumanReadableSize(wxULongLong(summary.archive.bytesWritten)) + ".";
+	}
+	if (!summary.archive.error.empty())
+	{
+		message += "\nZipping stopped early, saves not yet in the zip were left as they were:\n"
+			+ wxString::FromUTF8(summary.archive.error);
+		if (summary.archive.itemsArchived > 0)
 		{
-			std::filesystem::path pathToUTF8;
-			// unlinked
-			if (pathType == 0)
+			message += summary.archive.readable
+				? "\nThe zip holds every save that was deleted."
+				: "\nThe saves that were deleted are in the zip, but it has no central directory. A zip repair tool (zip -FF) can get them back.";
+		}
+	}
+	if (summary.cancelled)
+	{
+		message += "\nCancelled, the remaining saves were left as they were.";
+	}
+	if (!summary.errors.empty())
+	{
+		message += "\n\nCould not delete:" + FormatDeletionErrors(summary.errors);
+	}
+	wxMessageBox(message, "Delete", summary.errors.empty() ? wxICON_INFORMATION : wxICON_WARNING);
+
+	RescanDirectory();
+}
+
+/**
+ * @brief Puts the most recently deleted saves back, then rescans to list them again.
+ *
+ * @param event Required for event handling
+ */
+void MainFrame::OnUndoDeleteClicked(wxCommandEvent& event)
+{
+	if (!staging || scanning || deleting)
+	{
+		return;
+	}
+
+	std::vector<DeletionError> errors;
+	std::vector<std::string> restored = staging->UndoLastBatch(errors);
+	UpdateUndoButton();
+	if (restored.empty() && errors.empty())
+	{
+		wxMessageBox("Nothing to undo, the deleted saves have already been purged.");
+		return;
+	}
+
+	if (!errors.empty())
+	{
+		wxMessageBox(wxString::Format("Restored %llu saves.\n\nCould not restore:", static_cast<unsigned long long>(restored.size()))
+			+ FormatDeletionErrors(errors), "Undo delete", wxICON_WARNING);
+	}
+	RescanDirectory();
+}
+
+/**
+ * @brief Takes deleted saves out of the index and the lists without a rescan.
+ *
+ * Company folders left empty are removed, undo puts them back if needed.
+ *
+ * @param removed The saves that were moved away.
+ */
+void MainFrame::RemoveSavesFromLists(const std::vector<StagedSave>& removed)
+{
+	if (removed.empty())
+	{
+		return;
+	}
+
+	// looked up by the index's views without copying them.
+	std::set<std::string, std::less<>> removedPaths;
+	for (const StagedSave& save : removed)
+	{
+		removedPaths.insert(save.originalPath);
+	}
+
+	const SaveIndex& index = finder.GetSaveIndex();
+	std::set<std::string> affectedCompanies;
+	for (size_t entry = 0; entry < index.GetCount(); ++entry)
+	{
+		if (removedPaths.count(index.GetGamePath(entry)) != 0)
+		{
+			affectedCompanies.emplace(index.GetCompanyPath(entry));
+		}
+	}
+
+	// what is left of each affected company, an empty company drops out of the index.
+	ScanBatch batch;
+	for (const std::string& companyPath : affectedCompanies)
+	{
+		std::vector<SaveEntry> remaining;
+		for (size_t entry = 0; entry < index.GetCount(); ++entry)
+		{
+			if (index.GetCompanyPath(entry) == companyPath && removedPaths.count(index.GetGamePath(entry)) == 0)
 			{
-				// convert to UTF8 incase the path isn't English and uses symbols.
-				pathToUTF8 = std::filesystem::u8path(finder.GetUnlinkedPathsVector()[i]);
+				remaining.push_back(index.GetEntry(entry));
+			}
+		}
+		batch.companyPaths.push_back(companyPath);
+		batch.companySaves.push_back(std::move(remaining));
+	}
+	ApplyCompanyUpdates(batch);
+
+	for (const std::string& companyPath : affectedCompanies)
+	{
+		finder.RemoveEmptyFolder(companyPath);
+	}
+}
+
+/**
+ * @brief Enables Undo delete while there is a deletion that can still be undone.
+ */
+void MainFrame::UpdateUndoButton()
+{
+	undoButton->Enable(staging && staging->CanUndo() && !scanning && !deleting);
+}
+
+/**
+ * @brief Lists failed deletions one per line, up to DELETE_ERRORS_SHOWN of them.
+ */
+wxString MainFrame::FormatDeletionErrors(const std::vector<DeletionError>& errors)
+{
+	wxString text;
+	for (size_t i = 0; i < errors.size() && i < CONSTANT::DELETE_ERRORS_SHOWN; ++i)
+	{
+		text += "\n" + wxString::FromUTF8(errors[i].path) + "\n    " + wxString::FromUTF8(errors[i].message);
+	}
+	if (errors.size() > CONSTANT::DELETE_ERRORS_SHOWN)
+	{
+		text += wxString::Format("\n...and %llu more", static_cast<unsigned long long>(errors.size() - CONSTANT::DELETE_ERRORS_SHOWN));
+	}
+	return text;
+}
+/**
+ * @brief Rescans directory and updates the lists
+ *
+ * @param event Required for event handling
+ * @param list The list whose Rescan button was pressed
+ * @param pathType 0 means list with unlinked game paths, whilst 1 is unknown game paths
+ *		  used to differentiate which button is pressed and which list to use.
+ */
+void MainFrame::OnRescanClicked(wxCommandEvent& event, SaveListCtrl* list, int pathType)
+{
+	RescanDirectory();
+
+}
+/**
+ * @brief Rescans directory and updates the lists
+ *
+ * Clears both lists and starts a background scan, the lists are
+ * refilled as OnScanBatch receives results. If the lists hold the last scan
+ * from disk they are kept until the new scan is done instead.
+ * Does nothing if a scan is already running.
+ *
+ */
+void MainFrame::RescanDirectory()
+{
+	if (scanning || deleting)
+	{
+		return;
+	}
+
+	// make sure the previous scan thread is gone before starting a new one.
+	StopScan();
+
+	if (!showingSnapshot)
+	{
+		ClearLists();
+		firstResultShown = false;
+	}
+
+	++scanGeneration;
+	cancelScan = false;
+	scanStats.Reset();
+	scanStartTime = std::chrono::steady_clock::now();
+	if (!firstResultShown)
+	{
+		firstResultFrom = scanStartTime;
+	}
+	SetScanning(true);
+	SetStatusText(showingSnapshot ? "Showing last scan, checking for changes..." : "Scanning...", 0);
+
+	scanThread = std::thread(&MainFrame::RunScan, this, appDataPath, scanGeneration);
+}
+
+/**
+ * @brief Runs the scan on the background thread and posts its results to the frame.
+ *
+ * Company results are gathered into batches so the GUI isn't flooded with one
+ * event per folder. A batch is posted once it is big enough or old enough,
+ * and the very first result is posted on its own so it shows up as soon as possible.
+ *
+ * @param path The LocalLow folder to scan.
+ * @param generation Which scan this is, lets the frame ignore leftovers from an older scan.
+ */
+void MainFrame::RunScan(std::string path, unsigned int generation)
+{
+	std::mutex batchMutex;
+	ScanBatch batch;
+	size_t batchSaves = 0;
+	bool postedResult = false;
+	auto lastPost = std::chrono::steady_clock::now();
 
+	auto postBatch = [this, generation, &batch, &batchSaves, &lastPost]()
+		{
+			wxThreadEvent* event = new wxThreadEvent(EVT_SCAN_BATCH);
+			event->SetInt(generation);
+			event->SetPayload(batch);
+			wxQueueEvent(this, event);
+
+			batch.companyPaths.clear();
+			batch.companySaves.clear();
+			batchSaves = 0;
+			lastPost = std::chrono::steady_clock::now();
+		};
+
+	ScanObserver observer;
+	observer.cancelled = &cancelScan;
+	if (instrumented)
+	{
+		observer.stats = &scanStats;
+		observer.trace = &trace;
+	}
+	observer.onCompanyScanned = [&](const std::string& companyPath, const std::vector<SaveEntry>& saves, size_t companiesDone, size_t companyCount)
+		{
+			std::lock_guard<std::mutex> lock(batchMutex);
+			batch.companiesDone = companiesDone;
+			batch.companyCount = companyCount;
+			if (!saves.empty())
+			{
+				batch.companyPaths.push_back(companyPath);
+				batch.companySaves.push_back(saves);
+				batchSaves += saves.size();
 			}
-			// unknown
-			else if (pathType == 1)
+
+			bool firstResult = !postedResult && batchSaves > 0;
+			bool batchFull = batchSaves >= CONSTANT::SCAN_BATCH_SIZE;
+			bool batchOld = std::chrono::steady_clock::now() - lastPost >= std::chrono::milliseconds(CONSTANT::SCAN_BATCH_INTERVAL_MS);
+			if (firstResult || batchFull || batchOld)
 			{
-				// convert to UTF8 incase the path isn't English and uses symbols.
-				pathToUTF8 = std::filesystem::u8path(finder.GetUnknownPathsVector()[i]);
+				postedResult = postedResult || batchSaves > 0;
+				postBatch();
+			}
+		};
 
+	FindSave scanner;
+	scanner.SetSnapshotPath(snapshotPath);
+	scanner.SetInstallSources(steamFolders, installIndexPath);
+	bool completed = scanner.ScanSaves(path, observer);
 
-			}
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		if (!batch.companyPaths.empty())
+		{
+			postBatch();
+		}
+	}
+
+	wxThreadEvent* finished = new wxThreadEvent(EVT_SCAN_FINISHED);
+	finished->SetInt(generation);
+	finished->SetExtraLong(completed ? 1 : 0);
+	wxQueueEvent(this, finished);
+}
 
-			// delete folder
-			if (std::filesystem::exists(pathToUTF8))
+/**
+ * @brief Adds a batch of scan results to the index and the lists.
+ *
+ * While the last scan is on show the batch is held back instead, see OnScanFinished.
+ *
+ * @param event Carries the ScanBatch posted by RunScan.
+ */
+void MainFrame::OnScanBatch(wxThreadEvent& event)
+{
+	if (static_cast<unsigned int>(event.GetInt()) != scanGeneration)
+	{
+		return;
+	}
+
+	ScanBatch batch = event.GetPayload<ScanBatch>();
+	if (showingSnapshot)
+	{
+		pendingBatches.push_back(batch);
+	}
+	else
+	{
+		AddSavesToLists(batch.companyPaths, batch.companySaves);
+	}
+
+	if (batch.companyCount > 0)
+	{
+		scanProgress->SetValue(static_cast<int>(batch.companiesDone * 100 / batch.companyCount));
+	}
+	SetStatusText(wxString::Format("Scanning... %llu/%llu folders", static_cast<unsigned long long>(batch.companiesDone), static_cast<unsigned long long>(batch.companyCount)), 0);
+	UpdateTimings();
+}
+
+/**
+ * @brief Unlocks the GUI once the background scan is done or cancelled.
+ *
+ * If the last scan was on show, a completed scan replaces it in one go, only
+ * rows that differ are redrawn and checks stay. A cancelled one leaves it as it is.
+ *
+ * @param event GetExtraLong is 1 if the scan completed, 0 if it was cancelled.
+ */
+void MainFrame::OnScanFinished(wxThreadEvent& event)
+{
+	if (static_cast<unsigned int>(event.GetInt()) != scanGeneration)
+	{
+		return;
+	}
+
+	if (scanThread.joinable())
+	{
+		scanThread.join();
+	}
+	scanEndTime = std::chrono::steady_clock::now();
+
+	bool completed = event.GetExtraLong() == 1;
+	if (showingSnapshot)
+	{
+		showingSnapshot = false;
+		if (completed)
+		{
+			finder.ClearSaves();
+			for (const ScanBatch& batch : pendingBatches)
 			{
-				try
+				for (size_t i = 0; i < batch.companyPaths.size(); ++i)
 				{
-					std::filesystem::remove_all(pathToUTF8);
+					finder.AddCompanySaves(batch.companyPaths[i], batch.companySaves[i]);
 				}
-				catch (const std::filesystem::filesystem_error& e)
-				{
-					wxMessageBox("Error deleting file: ", e.what());
-				}
-				catch (const std::exception& e)
-				{
-					wxMessageBox("Unexpected error:", e.what());
+			}
+			SyncLists();
+		}
+		pendingBatches.clear();
+	}
+	if (completed)
+	{
+		finder.PruneSaveSizes();
+		QueueSizes();
+	}
 
-				}
+	scanProgress->SetValue(completed ? 100 : 0);
+	SetStatusText(completed ? "Scan complete" : "Scan cancelled", 0);
+	SetScanning(false);
+	UpdateTimings();
+	UpdateDebugPanel();
 
+	// the watcher may have seen folders change after the scan had been past them.
+	for (const ScanBatch& batch : pendingWatchBatches)
+	{
+		ApplyCompanyUpdates(batch);
+	}
+	pendingWatchBatches.clear();
 
-			}
+	if (rescanAfterScan)
+	{
+		rescanAfterScan = false;
+		RescanDirectory();
+	}
+	else if (completed)
+	{
+		StartWatching();
+	}
+}
+
+/**
+ * @brief Fills the lists with the last scan saved to disk, if there is one.
+ *
+ * The snapshot is only used if it was taken of the same LocalLow folder. The
+ * saves in it may be out of date, the scan started right after replaces them.
+ */
+void MainFrame::ShowSnapshot()
+{
+	if (snapshotPath.empty())
+	{
+		return;
+	}
+
+	std::unique_ptr<ScanSnapshot> snapshot = ScanSnapshot::Load(snapshotPath);
+	if (!snapshot || snapshot->GetRoot() != appDataPath)
+	{
+		return;
+	}
+
+	std::vector<std::string> companyPaths;
+	std::vector<std::vector<SaveEntry>> companySaves;
+	for (auto& company : snapshot->GetCompanySaves())
+	{
+		companyPaths.push_back(std::move(company.first));
+		companySaves.push_back(std::move(company.second));
+	}
 
-			// delete PlayerPref key for associated game in the registry.
-			finder.DeletePlayerPrefPath(pathToUTF8.u8string());
+	ClearLists();
+	AddSavesToLists(companyPaths, companySaves);
+	showingSnapshot = true;
+	firstResultShown = true;
+	firstResultTime = std::chrono::steady_clock::now();
+	firstResultFrom = launchTime;
+}
 
+/**
+ * @brief Empties the index and both lists.
+ */
+void MainFrame::ClearLists()
+{
+	finder.ClearSaves();
+	SyncLists();
+}
 
+/**
+ * @brief Brings both lists up to date after the index changed.
+ */
+void MainFrame::SyncLists()
+{
+	for (SaveListCtrl* list : pathLists)
+	{
+		if (list != nullptr)
+		{
+			list->Sync();
 		}
 	}
-	finder.RemoveEmptyFolders();
+}
+
+/**
+ * @brief Adds company results to the index, the lists grow by the new rows.
+ *
+ * @param companyPaths Company folders, in scan order.
+ * @param companySaves The saves of each company folder.
+ */
+void MainFrame::AddSavesToLists(const std::vector<std::string>& companyPaths, const std::vector<std::vector<SaveEntry>>& companySaves)
+{
+	size_t firstEntry = finder.GetSaveIndex().GetCount();
+	for (size_t i = 0; i < companyPaths.size(); ++i)
+	{
+		finder.AddCompanySaves(companyPaths[i], companySaves[i]);
+	}
 
+	size_t rowsAdded = 0;
+	for (SaveListCtrl* list : pathLists)
+	{
+		rowsAdded += list->AddRowsFrom(firstEntry);
+	}
 
+	if (!firstResultShown && rowsAdded > 0)
+	{
+		firstResultShown = true;
+		firstResultTime = std::chrono::steady_clock::now();
+	}
 
+	// measured after the rows are up, so sizes never hold up a result.
+	QueueSizes();
+}
 
-	wxMessageBox("Saves deleted");
+/**
+ * @brief Queues the listed saves that have no current size for measuring.
+ *
+ * Sizes kept from an earlier scan are reused as long as the folder's mtime
+ * hasn't changed, so a rescan only measures what changed.
+ */
+void MainFrame::QueueSizes()
+{
+	const SaveIndex& index = finder.GetSaveIndex();
+	for (SaveClass classification : { SaveClass::Unlinked, SaveClass::Unknown })
+	{
+		for (size_t entry : index.GetRows(classification))
+		{
+			if (index.GetSize(entry) != nullptr)
+			{
+				continue;
+			}
+			std::string path(index.GetGamePath(entry));
+			if (sizesRequested.insert(path).second)
+			{
+				sizeQueue.push_back(std::move(path));
+			}
+		}
+	}
+	StartSizing();
+}
 
-	RescanDirectory(list, pathType);
-	
+/**
+ * @brief Starts measuring the queued saves, unless a run is already going.
+ *
+ * Saves queued during a run wait for OnSizesFinished.
+ */
+void MainFrame::StartSizing()
+{
+	if (sizing || sizeQueue.empty())
+	{
+		return;
+	}
 
+	if (sizeThread.joinable())
+	{
+		sizeThread.join();
+	}
+	cancelSizes = false;
+	sizing = true;
+	sizeThread = std::thread(&MainFrame::RunSizing, this, std::move(sizeQueue));
+	sizeQueue.clear();
 }
+
 /**
- * @brief Rescans directory and updates the CheckListBox
+ * @brief Measures saves on the background thread and posts the sizes to the frame.
  *
- * Clears the CheckListBox, rescans the directory and appends the new list.
- * 
- * 
- * @param event Required for event handling
- * @param list The current list of elements in the CheckListBox
- * @param pathType 0 means list with unlinked game paths, whilst 1 is unknown game paths
- *		  used to differentiate which button is pressed and which list to use.
+ * Sizes are gathered into batches, posted at most every SCAN_BATCH_INTERVAL_MS
+ * like scan results.
+ *
+ * @param paths The save folders to measure.
+ */
+void MainFrame::RunSizing(std::vector<std::string> paths)
+{
+	std::mutex batchMutex;
+	SizeBatch batch;
+	auto lastPost = std::chrono::steady_clock::now();
+
+	auto postBatch = [this, &batch, &lastPost]()
+		{
+			wxThreadEvent* event = new wxThreadEvent(EVT_SIZE_BATCH);
+			event->SetPayload(batch);
+			wxQueueEvent(this, event);
+
+			batch.paths.clear();
+			batch.sizes.clear();
+			lastPost = std::chrono::steady_clock::now();
+		};
+
+	SizeObserver observer;
+	observer.cancelled = &cancelSizes;
+	observer.onMeasured = [&](const std::string& path, const FolderSize& size)
+		{
+			std::lock_guard<std::mutex> lock(batchMutex);
+			batch.paths.push_back(path);
+			batch.sizes.push_back(size);
+			if (std::chrono::steady_clock::now() - lastPost >= std::chrono::milliseconds(CONSTANT::SCAN_BATCH_INTERVAL_MS))
+			{
+				postBatch();
+			}
+		};
+
+	// low priority, a running scan keeps the disk to itself.
+	SizeAggregator aggregator;
+	aggregator.SetBackground(true);
+	aggregator.MeasureAll(paths, observer);
+
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		if (!batch.paths.empty())
+		{
+			postBatch();
+		}
+	}
+
+	wxQueueEvent(this, new wxThreadEvent(EVT_SIZES_FINISHED));
+}
+
+/**
+ * @brief Stores measured sizes in the index and shows them in the lists.
+ *
+ * @param event Carries the SizeBatch posted by RunSizing.
+ */
+void MainFrame::OnSizeBatch(wxThreadEvent& event)
+{
+	SizeBatch batch = event.GetPayload<SizeBatch>();
+	for (size_t i = 0; i < batch.paths.size(); ++i)
+	{
+		finder.SetSaveSize(batch.paths[i], batch.sizes[i]);
+		sizesRequested.erase(batch.paths[i]);
+	}
+
+	for (SaveListCtrl* list : pathLists)
+	{
+		list->OnSizesChanged();
+	}
+}
+
+/**
+ * @brief Starts on the saves queued while the last run was measuring.
+ *
+ * Saves the run didn't report, because they were gone or it was cancelled,
+ * can be queued again.
  */
-void MainFrame::OnRescanClicked(wxCommandEvent& event, wxCheckListBox* list, int pathType)
+void MainFrame::OnSizesFinished(wxThreadEvent& event)
 {
-	RescanDirectory(list, pathType);
+	if (sizeThread.joinable())
+	{
+		sizeThread.join();
+	}
+	sizing = false;
 
+	sizesRequested = std::set<std::string>(sizeQueue.begin(), sizeQueue.end());
+	StartSizing();
+}
+
+/**
+ * @brief Cancels the size thread, if any, and waits for it.
+ */
+void MainFrame::StopSizing()
+{
+	cancelSizes = true;
+	if (sizeThread.joinable())
+	{
+		sizeThread.join();
+	}
 }
+
 /**
- * @brief Rescans directory and updates the CheckListBox
+ * @brief Asks the running scan to stop, what was found so far stays in the lists.
  *
- * Clears the CheckListBox, rescans the directory and appends the new list.
+ * A running deletion stops too, saves already deleted stay deleted.
  *
+ * @param event Required for event handling
+ */
+void MainFrame::OnCancelScanClicked(wxCommandEvent& event)
+{
+	cancelScan = true;
+	cancelDelete = true;
+}
+
+/**
+ * @brief Stops the scan and any deletion before closing, so no thread outlives the frame.
  *
  * @param event Required for event handling
- * @param list The current list of elements in the CheckListBox
- * @param pathType 0 means list with unlinked game paths, whilst 1 is unknown game paths
- *		  used to differentiate which button is pressed and which list to use.
  */
-void MainFrame::RescanDirectory(wxCheckListBox* list, int pathType)
+void MainFrame::OnClose(wxCloseEvent& event)
+{
+	StopWatching();
+	StopScan();
+	StopDeletion();
+	StopSizing();
+	// anything not purged yet is purged on the next start.
+	staging.reset();
+	event.Skip();
+}
+
+/**
+ * @brief Starts watching LocalLow, if it isn't already and the platform can.
+ */
+void MainFrame::StartWatching()
 {
-	// clear list and rescan directory
-	list->Clear();
-	finder.GetCompanyPaths(appDataPath);
-	// update path vector
-	switch (pathType)
+	if (watcher)
 	{
-	case 0:
-		finder.GetUnusedSavePaths(appDataPath);
-		break;
-	case 1:
-		finder.GetUnknownSavePaths(appDataPath);
-		break;
+		return;
 	}
 
-	// readd new paths
-	wxArrayString choices = GenerateCheckListElements(pathType);
+	watcher = DirectoryWatcher::Create();
+	if (!watcher)
+	{
+		return;
+	}
 
-	for (const auto& updatedPath : choices)
+	stopWatching = false;
+	bool started = watcher->Start(appDataPath, [this](const std::vector<std::string>& companyPaths, bool fullRescan)
+		{
+			RescanChangedCompanies(companyPaths, fullRescan);
+		});
+	if (!started)
 	{
-		list->Append(updatedPath);
+		watcher.reset();
 	}
 }
 
 /**
- * @brief Formats the game path string into a compatible wxString to add to wxArrayString
- *
- * Gets the game path, extracts game name and adds to wxArrayString.
- * Used to rescan directory and update the list.
+ * @brief Stops the watcher, cancelling a company rescan it may be in the middle of.
+ */
+void MainFrame::StopWatching()
+{
+	stopWatching = true;
+	if (watcher)
+	{
+		watcher->Stop();
+		watcher.reset();
+	}
+}
+
+/**
+ * @brief Rescans the company folders the watcher reported and posts the results to the frame.
  *
+ * Runs on the watcher thread, so the GUI never waits on the disk.
  *
- * @param pathType 0 means list with unlinked game paths, whilst 1 is unknown game paths
- *		  used to differentiate which button is pressed and which list to use.
- * @returns A list of wxArrayStrings of unlinked/unknown game paths for wxCheckListBox.
+ * @param companyPaths Company folders that changed.
+ * @param fullRescan Events were lost, the whole of LocalLow has to be scanned again.
  */
-wxArrayString MainFrame::GenerateCheckListElements(int pathType)
+void MainFrame::RescanChangedCompanies(const std::vector<std::string>& companyPaths, bool fullRescan)
 {
-	wxArrayString choices;
+	if (fullRescan)
+	{
+		wxThreadEvent* event = new wxThreadEvent(EVT_WATCH_CHANGES);
+		event->SetExtraLong(1);
+		wxQueueEvent(this, event);
+		return;
+	}
+
+	std::mutex batchMutex;
+	ScanBatch batch;
+	ScanObserver observer;
+	observer.cancelled = &stopWatching;
+	observer.trace = instrumented ? &trace : nullptr;
+	observer.onCompanyScanned = [&batchMutex, &batch](const std::string& companyPath, const std::vector<SaveEntry>& saves, size_t companiesDone, size_t companyCount)
+		{
+			// companies without saves are sent too, their old saves have to go.
+			std::lock_guard<std::mutex> lock(batchMutex);
+			batch.companyPaths.push_back(companyPath);
+			batch.companySaves.push_back(saves);
+			batch.companiesDone = companiesDone;
+			batch.companyCount = companyCount;
+		};
 
-	switch (pathType)
+	FindSave scanner;
+	scanner.SetInstallSources(steamFolders, installIndexPath);
+	if (!scanner.ScanCompanies(companyPaths, observer))
 	{
-	case 0:
+		return;
+	}
+
+	wxThreadEvent* event = new wxThreadEvent(EVT_WATCH_CHANGES);
+	event->SetExtraLong(0);
+	event->SetPayload(batch);
+	wxQueueEvent(this, event);
+}
+
+/**
+ * @brief Applies company folders rescanned by the watcher.
+ *
+ * Held back while a scan is running, OnScanFinished applies them afterwards.
+ *
+ * @param event Carries a ScanBatch, or GetExtraLong is 1 if everything has to be rescanned.
+ */
+void MainFrame::OnWatchChanges(wxThreadEvent& event)
+{
+	if (event.GetExtraLong() == 1)
 	{
-		// unlinked games
-		for (const std::string& path : finder.GetUnlinkedPathsVector())
+		if (scanning)
+		{
+			rescanAfterScan = true;
+		}
+		else
 		{
-			// ensure it is encoded properly to UT8 if there are symbols.
-			std::string gameName = finder.ExtractGameName(path);
-			wxString str = wxString::FromUTF8(gameName.c_str());
-			choices.Add(str);
+			RescanDirectory();
 		}
+		return;
+	}
+
+	ScanBatch batch = event.GetPayload<ScanBatch>();
+	if (scanning)
+	{
+		pendingWatchBatches.push_back(batch);
+		return;
+	}
+
+	ApplyCompanyUpdates(batch);
+}
+
+/**
+ * @brief Swaps rescanned companies into the index and syncs the lists with it.
+ *
+ * Rows stay checked as long as their save folder is still listed.
+ *
+ * @param batch The rescanned companies, with their saves now.
+ */
+void MainFrame::ApplyCompanyUpdates(const ScanBatch& batch)
+{
+	for (size_t i = 0; i < batch.companyPaths.size(); ++i)
+	{
+		finder.ReplaceCompanySaves(batch.companyPaths[i], batch.companySaves[i]);
+	}
+	SyncLists();
+	QueueSizes();
+
+	SetStatusText(wxString::Format("Updated %llu folders", static_cast<unsigned long long>(batch.companyPaths.size())), 0);
+}
+
+/**
+ * @brief Cancels the scan thread, if any, and waits for it.
+ */
+void MainFrame::StopScan()
+{
+	cancelScan = true;
+	if (scanThread.joinable())
+	{
+		scanThread.join();
+	}
+}
 
+/**
+ * @brief Cancels the deletion thread, if any, and waits for it.
+ */
+void MainFrame::StopDeletion()
+{
+	cancelDelete = true;
+	if (deleteThread.joinable())
+	{
+		deleteThread.join();
+	}
+}
 
-		break;
+/**
+ * @brief Locks/unlocks the buttons that can't be used while scanning.
+ *
+ * @param isScanning True when a scan has just started.
+ */
+void MainFrame::SetScanning(bool isScanning)
+{
+	scanning = isScanning;
+	for (wxButton* button : scanLockedButtons)
+	{
+		button->Enable(!isScanning);
 	}
-	case 1:
-		// unknown games
-		for (const std::string& path : finder.GetUnknownPathsVector())
+	cancelButton->Enable(isScanning);
+	UpdateUndoButton();
+}
+
+/**
+ * @brief Locks/unlocks the buttons that can't be used while deleting.
+ *
+ * @param isDeleting True when a deletion has just started.
+ */
+void MainFrame::SetDeleting(bool isDeleting)
+{
+	deleting = isDeleting;
+	for (wxButton* button : scanLockedButtons)
+	{
+		button->Enable(!isDeleting);
+	}
+	cancelButton->Enable(isDeleting);
+	UpdateUndoButton();
+}
+
+/**
+ * @brief Shows time to first window, time to first result and total scan time.
+ *
+ * Times are taken from when the frame was created, a dash means it hasn't happened yet.
+ */
+void MainFrame::UpdateTimings()
+{
+	auto milliseconds = [](bool happened, std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
 		{
-			// ensure it is encoded properly to UT8 if there are symbols.
-			std::string gameName = finder.ExtractGameName(path);
-			wxString str = wxString::FromUTF8(gameName.c_str());
-			choices.Add(str);
+			if (!happened)
+			{
+				return wxString("-");
+			}
+			return wxString::Format("%lld ms", static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count()));
+		};
 
-		}
-		break;
+	wxString timings = "Window: " + milliseconds(windowShownTime != std::chrono::steady_clock::time_point(), launchTime, windowShownTime);
+	timings += " | First result: " + milliseconds(firstResultShown, firstResultFrom, firstResultTime);
+	timings += " | Scan: " + milliseconds(!scanning, scanStartTime, scanEndTime);
+	SetStatusText(timings, 1);
+}
+
+/**
+ * @brief Turns instrumentation on and shows the debug panel.
+ *
+ * Scans count and trace nothing until this is first pressed, so the counters
+ * start with the next scan.
+ *
+ * @param event Required for event handling
+ */
+void MainFrame::OnDebugPanelShortcut(wxCommandEvent& event)
+{
+	instrumented = true;
+	ShowDebugPanel();
+}
+
+/**
+ * @brief Opens the debug panel, made the first time it is asked for.
+ *
+ * The panel isn't modal and closing it only hides it.
+ */
+void MainFrame::ShowDebugPanel()
+{
+	if (debugPanel == nullptr)
+	{
+		debugPanel = new wxDialog(this,
+			wxID_ANY,
+			"Scan statistics",
+			wxDefaultPosition,
+			wxSize(CONSTANT::DEBUG_PANEL_SIZE.first, CONSTANT::DEBUG_PANEL_SIZE.second));
+
+		debugText = new wxTextCtrl(debugPanel,
+			wxID_ANY,
+			wxEmptyString,
+			wxPoint(CONSTANT::DEBUG_TEXT_POS.first, CONSTANT::DEBUG_TEXT_POS.second),
+			wxSize(CONSTANT::DEBUG_TEXT_SIZE.first, CONSTANT::DEBUG_TEXT_SIZE.second),
+			wxTE_MULTILINE | wxTE_READONLY);
 
+		wxButton* refreshButton = new wxButton(debugPanel,
+			wxID_ANY,
+			"Refresh",
+			wxPoint(CONSTANT::DEBUG_REFRESH_BUTTON_POS.first, CONSTANT::DEBUG_REFRESH_BUTTON_POS.second),
+			wxSize(CONSTANT::DEBUG_BUTTON_SIZE.first, CONSTANT::DEBUG_BUTTON_SIZE.second));
+		refreshButton->Bind(wxEVT_BUTTON, [this](wxCommandEvent& event) { UpdateDebugPanel(); });
 
+		wxButton* exportButton = new wxButton(debugPanel,
+			wxID_ANY,
+			"Export trace...",
+			wxPoint(CONSTANT::DEBUG_EXPORT_BUTTON_POS.first, CONSTANT::DEBUG_EXPORT_BUTTON_POS.second),
+			wxSize(CONSTANT::DEBUG_BUTTON_SIZE.first, CONSTANT::DEBUG_BUTTON_SIZE.second));
+		exportButton->Bind(wxEVT_BUTTON, &MainFrame::OnExportTraceClicked, this);
 	}
 
-	return choices;
+	UpdateDebugPanel();
+	debugPanel->Show();
+	debugPanel->Raise();
+}
+
+/**
+ * @brief Shows the last scan's counters and phase timings, and the last deletion's.
+ *
+ * Does nothing while the panel has never been opened.
+ */
+void MainFrame::UpdateDebugPanel()
+{
+	if (debugText == nullptr)
+	{
+		return;
+	}
+
+	auto line = [](const char* name, uint64_t value)
+		{
+			return wxString::Format("%-24s %llu\n", name, static_cast<unsigned long long>(value));
+		};
+	auto milliseconds = [](const char* name, uint64_t microseconds)
+		{
+			return wxString::Format("%-24s %.1f ms\n", name, microseconds / 1000.0);
+		};
+
+	wxString text = scanning ? "Scan (running)\n" : "Last scan\n";
+	text += line("directories visited", scanStats.directoriesVisited);
+	text += line("directories listed", scanStats.directoriesRead);
+	text += line("entries checked", scanStats.entriesChecked);
+	text += line("logs opened", scanStats.filesOpened);
+	text += line("bytes read", scanStats.bytesRead);
+	text += line("logs read on io_uring", scanStats.logsReadOnRing);
+	text += line("install paths probed", scanStats.pathsProbed);
+	text += line("Steam manifests read", scanStats.manifestsRead);
+	text += line("unknown saves resolved", scanStats.unknownResolved);
+	text += line("folder cache hits", scanStats.folderCacheHits);
+	text += line("log cache hits", scanStats.logCacheHits);
+	text += milliseconds("install index", scanStats.installIndexMicroseconds);
+	text += milliseconds("list companies", scanStats.listMicroseconds);
+	text += milliseconds("walk", scanStats.walkMicroseconds);
+	text += milliseconds("read logs", scanStats.logsMicroseconds);
+	text += milliseconds("write snapshot", scanStats.snapshotMicroseconds);
+	text += milliseconds("listing, all threads", scanStats.listingMicroseconds);
+	text += milliseconds("log reads, all threads", scanStats.logReadMicroseconds);
+	text += milliseconds("probes, all threads", scanStats.probeMicroseconds);
+
+	text += "\nLast deletion\n";
+	if (hasDeleted)
+	{
+		text += line("saves deleted", lastDeletion.itemsDeleted);
+		text += line("files removed", lastDeletion.filesRemoved);
+		text += line("folders removed", lastDeletion.foldersRemoved);
+		text += line("bytes removed", lastDeletion.bytesRemoved);
+		text += line("errors", lastDeletion.errors.size());
+		text += milliseconds("wall time", static_cast<uint64_t>(lastDeletion.milliseconds) * 1000);
+		text += line("saves zipped", lastDeletion.archive.itemsArchived);
+		text += line("bytes zipped", lastDeletion.archive.bytesRead);
+		text += line("zip size", lastDeletion.archive.bytesWritten);
+		text += milliseconds("zip wall time", static_cast<uint64_t>(lastDeletion.archive.milliseconds) * 1000);
+	}
+	else
+	{
+		text += "none yet\n";
+	}
+
+	text += "\n" + line("trace spans", trace.GetEventCount());
+	debugText->ChangeValue(text);
+}
+
+/**
+ * @brief Saves every span recorded since instrumentation was turned on as a Chrome trace.
+ *
+ * The file opens in chrome://tracing or ui.perfetto.dev.
+ *
+ * @param event Required for event handling
+ */
+void MainFrame::OnExportTraceClicked(wxCommandEvent& event)
+{
+	wxFileDialog saveDialog(debugPanel,
+		"Export trace",
+		wxEmptyString,
+		"scan-trace.json",
+		"Chrome trace (*.json)|*.json",
+		wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+	if (saveDialog.ShowModal() != wxID_OK)
+	{
+		return;
+	}
+
+	if (!trace.WriteChromeTrace(saveDialog.GetPath().ToStdString(wxConvUTF8)))
+	{
+		wxMessageBox("Could not write " + saveDialog.GetPath(), "Export trace", wxICON_WARNING);
+	}
 }
@@ -1,23 +1,160 @@
 #pragma once
 #include <wx/wx.h>
 #include "FindSave.h"
+#include "DirectoryWatcher.h"
+#include "DeletionEngine.h"
+#include "SaveStaging.h"
+#include "SizeAggregator.h"
+#include "SaveListCtrl.h"
+#include "ScanStats.h"
+#include "TraceRecorder.h"
 #include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <set>
+
+// Finished company folders, posted from the scan thread (and the watcher) to the frame.
+struct ScanBatch
+{
+	std::vector<std::string> companyPaths;
+	std::vector<std::vector<SaveEntry>> companySaves;
+	size_t companiesDone = 0;
+	size_t companyCount = 0;
+};
+
+// Measured save folders, posted from the size thread to the frame.
+struct SizeBatch
+{
+	std::vector<std::string> paths;
+	std::vector<FolderSize> sizes;
+};
+
+wxDECLARE_EVENT(EVT_SCAN_BATCH, wxThreadEvent);
+wxDECLARE_EVENT(EVT_SCAN_FINISHED, wxThreadEvent);
+wxDECLARE_EVENT(EVT_WATCH_CHANGES, wxThreadEvent);
+wxDECLARE_EVENT(EVT_DELETE_PROGRESS, wxThreadEvent);
+wxDECLARE_EVENT(EVT_DELETE_FINISHED, wxThreadEvent);
+wxDECLARE_EVENT(EVT_SIZE_BATCH, wxThreadEvent);
+wxDECLARE_EVENT(EVT_SIZES_FINISHED, wxThreadEvent);
 
 class MainFrame : public wxFrame
 {
 public:
 	MainFrame(const wxString& title);
-	void OnDeleteClicked(wxCommandEvent& event, wxCheckListBox* list, int pathType);
+	~MainFrame();
+	void OnDeleteClicked(wxCommandEvent& event, SaveListCtrl* list, int pathType);
 
-	void OnRescanClicked(wxCommandEvent& event, wxCheckListBox* list, int pathType);
-	void RescanDirectory(wxCheckListBox* list, int pathType);
+	void OnRescanClicked(wxCommandEvent& event, SaveListCtrl* list, int pathType);
+	void RescanDirectory();
+	void OnScanBatch(wxThreadEvent& event);
+	void OnScanFinished(wxThreadEvent& event);
+	void OnCancelScanClicked(wxCommandEvent& event);
+	void OnUndoDeleteClicked(wxCommandEvent& event);
+	void OnWatchChanges(wxThreadEvent& event);
+	void OnDeleteProgress(wxThreadEvent& event);
+	void OnDeleteFinished(wxThreadEvent& event);
+	void OnSizeBatch(wxThreadEvent& event);
+	void OnSizesFinished(wxThreadEvent& event);
+	void OnDebugPanelShortcut(wxCommandEvent& event);
+	void OnClose(wxCloseEvent& event);
 
-	wxArrayString GenerateCheckListElements(int pathType);
 	void AddSavePathForm(wxPanel* wxPanel, std::string formTitle, int pathType = 0, int posXOffset = 0, int posYOffset = 0);
 
 private:
+	void RunScan(std::string path, unsigned int generation);
+	void ShowSnapshot();
+	void ClearLists();
+	void AddSavesToLists(const std::vector<std::string>& companyPaths, const std::vector<std::vector<SaveEntry>>& companySaves);
+	void StartWatching();
+	void StopWatching();
+	void RescanChangedCompanies(const std::vector<std::string>& companyPaths, bool fullRescan);
+	void ApplyCompanyUpdates(const ScanBatch& batch);
+	void SyncLists();
+	void QueueSizes();
+	void StartSizing();
+	void RunSizing(std::vector<std::string> paths);
+	void StopSizing();
+	void RunDeletion(std::vector<std::string> paths, std::string archiveFile);
+	void StopScan();
+	void StopDeletion();
+	void SetScanning(bool isScanning);
+	void SetDeleting(bool isDeleting);
+	void RemoveSavesFromLists(const std::vector<StagedSave>& removed);
+	void UpdateUndoButton();
+	static wxString FormatDeletionErrors(const std::vector<DeletionError>& errors);
+	void UpdateTimings();
+	void ShowDebugPanel();
+	void UpdateDebugPanel();
+	void OnExportTraceClicked(wxCommandEvent& event);
+
 	FindSave finder;
+	// 0 is the unlinked list, 1 is the unknown list
+	SaveListCtrl* pathLists[2] = { nullptr, nullptr };
+	std::vector<wxButton*> scanLockedButtons;
+	wxGauge* scanProgress = nullptr;
+	wxButton* cancelButton = nullptr;
+	wxButton* undoButton = nullptr;
+	wxCheckBox* archiveCheckBox = nullptr;
+
+	// background scan
+	std::thread scanThread;
+	std::atomic<bool> cancelScan{ false };
+	bool scanning = false;
+	unsigned int scanGeneration = 0;
+
+	// background deletion of the checked saves
+	std::thread deleteThread;
+	std::atomic<bool> cancelDelete{ false };
+	bool deleting = false;
+	// deleted saves wait here until they can no longer be undone, null if there is nowhere to put them
+	std::unique_ptr<SaveStaging> staging;
+
+	// background measuring of save folder sizes, once the saves are listed
+	std::thread sizeThread;
+	std::atomic<bool> cancelSizes{ false };
+	bool sizing = false;
+	// saves waiting for the next measuring run, and every save waiting or being measured
+	std::vector<std::string> sizeQueue;
+	std::set<std::string> sizesRequested;
+
+	// last scan loaded from disk, shown until the scan running behind it finishes
+	std::string snapshotPath;
+	bool showingSnapshot = false;
+
+	// Steam installs found at startup and where their index is cached, for saves with no game path
+	std::vector<std::string> steamFolders;
+	std::string installIndexPath;
+	std::vector<ScanBatch> pendingBatches;
+
+	// watch mode, started after the first complete scan
+	std::unique_ptr<DirectoryWatcher> watcher;
+	std::atomic<bool> stopWatching{ false };
+	// changes that came in while a scan was running, applied once it is done
+	std::vector<ScanBatch> pendingWatchBatches;
+	bool rescanAfterScan = false;
+
+	// timings shown in the status bar
+	std::chrono::steady_clock::time_point launchTime;
+	std::chrono::steady_clock::time_point windowShownTime;
+	std::chrono::steady_clock::time_point scanStartTime;
+	std::chrono::steady_clock::time_point firstResultTime;
+	// launch when the first result came from the snapshot, otherwise the scan start
+	std::chrono::steady_clock::time_point firstResultFrom;
+	std::chrono::steady_clock::time_point scanEndTime;
+	bool firstResultShown = false;
 	std::string appDataPath;
 
+	// instrumentation, off until the debug panel is first opened
+	std::atomic<bool> instrumented{ false };
+	ScanStats scanStats;
+	TraceRecorder trace;
+	DeletionSummary lastDeletion;
+	bool hasDeleted = false;
+	wxDialog* debugPanel = nullptr;
+	wxTextCtrl* debugText = nullptr;
+
 };
 
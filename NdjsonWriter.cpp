@@ -0,0 +1,138 @@
+#include "NdjsonWriter.h"
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+
+/**
+ * @brief Adds a string field.
+ *
+ * @param key Field name.
+ * @param value UTF-8 text, escaped as needed.
+ */
+JsonObject& JsonObject::Add(std::string_view key, std::string_view value)
+{
+	AddKey(key);
+	AddString(value);
+	return *this;
+}
+
+/**
+ * @brief Adds a string field, so string literals don't end up as bools.
+ */
+JsonObject& JsonObject::Add(std::string_view key, const char* value)
+{
+	return Add(key, std::string_view(value));
+}
+
+/**
+ * @brief Adds a true/false field.
+ */
+JsonObject& JsonObject::Add(std::string_view key, bool value)
+{
+	AddKey(key);
+	text += value ? "true" : "false";
+	return *this;
+}
+
+/**
+ * @brief Adds a number field.
+ */
+JsonObject& JsonObject::Add(std::string_view key, uint64_t value)
+{
+	AddKey(key);
+	text += std::to_string(value);
+	return *this;
+}
+
+/**
+ * @brief Closes the object and gets its text, without the newline.
+ */
+const std::string& JsonObject::ToString()
+{
+	if (!closed)
+	{
+		text += '}';
+		closed = true;
+	}
+	return text;
+}
+
+/**
+ * @brief Writes the key and the separator before it.
+ */
+void JsonObject::AddKey(std::string_view key)
+{
+	if (text.size() > 1)
+	{
+		text += ',';
+	}
+	AddString(key);
+	text += ':';
+}
+
+/**
+ * @brief Writes a quoted string, escaping quotes, backslashes and control characters.
+ *
+ * Anything else, UTF-8 included, is written as it is.
+ */
+void JsonObject::AddString(std::string_view value)
+{
+	text += '"';
+	for (char c : value)
+	{
+		switch (c)
+		{
+		case '"':
+			text += "\\\"";
+			break;
+		case '\\':
+			text += "\\\\";
+			break;
+		case '\n':
+			text += "\\n";
+			break;
+		case '\r':
+			text += "\\r";
+			break;
+		case '\t':
+			text += "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+				text += escaped;
+			}
+			else
+			{
+				text += c;
+			}
+			break;
+		}
+	}
+	text += '"';
+}
+
+/**
+ * @brief Writes to the given stream.
+ */
+NdjsonWriter::NdjsonWriter(std::ostream& out) : out(out)
+{
+}
+
+/**
+ * @brief Writes one record as a line and flushes it.
+ *
+ * @param record The record, closed by this call.
+ */
+void NdjsonWriter::Write(JsonObject& record)
+{
+	const std::string& line = record.ToString();
+
+	std::lock_guard<std::mutex> lock(writeMutex);
+	out.write(line.data(), static_cast<std::streamsize>(line.size()));
+	out.put('\n');
+	out.flush();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// One flat JSON object, keys kept in the order they were added.
+class JsonObject
+{
+public:
+	JsonObject& Add(std::string_view key, std::string_view value);
+	JsonObject& Add(std::string_view key, const char* value);
+	JsonObject& Add(std::string_view key, bool value);
+	JsonObject& Add(std::string_view key, uint64_t value);
+
+	const std::string& ToString();
+
+private:
+	void AddKey(std::string_view key);
+	void AddString(std::string_view value);
+
+	std::string text = "{";
+	bool closed = false;
+};
+
+// Writes newline delimited JSON, one object per line. Safe to call from the
+// scan's worker threads, lines never interleave and each one is flushed as soon
+// as it is written so whatever reads the stream sees results straight away.
+class NdjsonWriter
+{
+public:
+	explicit NdjsonWriter(std::ostream& out);
+
+	void Write(JsonObject& record);
+
+private:
+	std::ostream& out;
+	std::mutex writeMutex;
+};
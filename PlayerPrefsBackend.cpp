@@ -0,0 +1,290 @@
+#include "PlayerPrefsBackend.h"
+#include "UserRegPlayerPrefsBackend.h"
+#include <cwctype>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+	// PlayerPrefs in HKEY_CURRENT_USER\SOFTWARE, which stays open for the backend's lifetime.
+	class Win32PlayerPrefsBackend : public PlayerPrefsBackend
+	{
+	public:
+		Win32PlayerPrefsBackend()
+		{
+			if (RegOpenKeyExW(HKEY_CURRENT_USER, L"SOFTWARE", 0, KEY_READ | DELETE, &software) != ERROR_SUCCESS)
+			{
+				software = nullptr;
+			}
+		}
+
+		~Win32PlayerPrefsBackend() override
+		{
+			if (software != nullptr)
+			{
+				RegCloseKey(software);
+			}
+		}
+
+		std::vector<std::wstring> ListCompanies() override
+		{
+			return ListSubkeys(software);
+		}
+
+		std::vector<std::wstring> ListGames(const std::wstring& company) override
+		{
+			HKEY companyKey = nullptr;
+			if (software == nullptr || RegOpenKeyExW(software, company.c_str(), 0, KEY_ENUMERATE_SUB_KEYS | KEY_QUERY_VALUE, &companyKey) != ERROR_SUCCESS)
+			{
+				return std::vector<std::wstring>();
+			}
+
+			std::vector<std::wstring> games = ListSubkeys(companyKey);
+			RegCloseKey(companyKey);
+			return games;
+		}
+
+		bool DeleteGame(const std::wstring& company, const std::wstring& game) override
+		{
+			std::wstring path = company + L"\\" + game;
+			return software != nullptr && RegDeleteTreeW(software, path.c_str()) == ERROR_SUCCESS;
+		}
+
+		bool DeleteCompany(const std::wstring& company) override
+		{
+			return software != nullptr && RegDeleteKeyW(software, company.c_str()) == ERROR_SUCCESS;
+		}
+
+	private:
+		/**
+		 * @brief Gets the names of a key's subkeys, sized up front so it's one query plus one call per name.
+		 */
+		static std::vector<std::wstring> ListSubkeys(HKEY key)
+		{
+			std::vector<std::wstring> names;
+			DWORD subKeyCount = 0;
+			DWORD maxNameLength = 0;
+			if (key == nullptr || RegQueryInfoKeyW(key, nullptr, nullptr, nullptr, &subKeyCount, &maxNameLength, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr) != ERROR_SUCCESS)
+			{
+				return names;
+			}
+
+			names.reserve(subKeyCount);
+			std::wstring name(maxNameLength + 1, L'\0');
+			for (DWORD i = 0; ; ++i)
+			{
+				DWORD length = static_cast<DWORD>(name.size());
+				LONG result = RegEnumKeyExW(key, i, &name[0], &length, nullptr, nullptr, nullptr, nullptr);
+				if (result != ERROR_SUCCESS)
+				{
+					break;
+				}
+				names.emplace_back(name.data(), length);
+			}
+			return names;
+		}
+
+		HKEY software = nullptr;
+	};
+#endif
+}
+
+
+/**
+ * @brief Makes the PlayerPrefs backend for the games in a LocalLow folder.
+ *
+ * A LocalLow inside a Wine or Proton prefix gets the prefix's user.reg. Other
+ * than that, outside Windows, Unity keeps PlayerPrefs inside the save folder,
+ * so there's nothing to clean up and an empty in-memory backend stands in.
+ *
+ * @param localLow The LocalLow folder, in UTF-8.
+ */
+std::unique_ptr<PlayerPrefsBackend> PlayerPrefsBackend::Create(const std::string& localLow)
+{
+	std::filesystem::path userReg = UserRegPlayerPrefsBackend::FindUserReg(std::filesystem::u8path(localLow));
+	if (!userReg.empty())
+	{
+		return std::make_unique<UserRegPlayerPrefsBackend>(userReg);
+	}
+
+#ifdef _WIN32
+	return std::make_unique<Win32PlayerPrefsBackend>();
+#else
+	return std::make_unique<MemoryPlayerPrefsBackend>();
+#endif
+}
+
+/**
+ * @brief Adds a game key, and its company key if it's new.
+ */
+void MemoryPlayerPrefsBackend::AddGame(const std::wstring& company, const std::wstring& game)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Company& entry = companies[FoldName(company)];
+	if (entry.name.empty())
+	{
+		entry.name = company;
+	}
+	entry.games.emplace(FoldName(game), game);
+}
+
+/**
+ * @brief Checks whether a game key exists, not counted as a call.
+ */
+bool MemoryPlayerPrefsBackend::HasGame(const std::wstring& company, const std::wstring& game)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = companies.find(FoldName(company));
+	return found != companies.end() && found->second.games.count(FoldName(game)) != 0;
+}
+
+/**
+ * @brief Checks whether a company key exists, not counted as a call.
+ */
+bool MemoryPlayerPrefsBackend::HasCompany(const std::wstring& company)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return companies.count(FoldName(company)) != 0;
+}
+
+/**
+ * @brief Gets how many backend calls have been made so far.
+ */
+size_t MemoryPlayerPrefsBackend::GetCallCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return callCount;
+}
+
+std::vector<std::wstring> MemoryPlayerPrefsBackend::ListCompanies()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	++callCount;
+	std::vector<std::wstring> names;
+	for (const auto& company : companies)
+	{
+		names.push_back(company.second.name);
+	}
+	return names;
+}
+
+std::vector<std::wstring> MemoryPlayerPrefsBackend::ListGames(const std::wstring& company)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	++callCount;
+	std::vector<std::wstring> names;
+	auto found = companies.find(FoldName(company));
+	if (found != companies.end())
+	{
+		for (const auto& game : found->second.games)
+		{
+			names.push_back(game.second);
+		}
+	}
+	return names;
+}
+
+bool MemoryPlayerPrefsBackend::DeleteGame(const std::wstring& company, const std::wstring& game)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	++callCount;
+	auto found = companies.find(FoldName(company));
+	return found != companies.end() && found->second.games.erase(FoldName(game)) != 0;
+}
+
+bool MemoryPlayerPrefsBackend::DeleteCompany(const std::wstring& company)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	++callCount;
+	auto found = companies.find(FoldName(company));
+	if (found == companies.end() || !found->second.games.empty())
+	{
+		return false;
+	}
+	companies.erase(found);
+	return true;
+}
+
+/**
+ * @brief Lower cases a key name, so names compare the way the registry compares them.
+ */
+std::wstring PlayerPrefsBackend::FoldName(const std::wstring& name)
+{
+	std::wstring folded = name;
+	for (wchar_t& c : folded)
+	{
+		if (c >= L'A' && c <= L'Z')
+		{
+			c = static_cast<wchar_t>(c - L'A' + L'a');
+		}
+		else if (c >= 0x80)
+		{
+			c = static_cast<wchar_t>(std::towlower(static_cast<std::wint_t>(c)));
+		}
+	}
+	return folded;
+}
+
+/**
+ * @brief Converts a folder or key name from UTF-8.
+ *
+ * Done by hand, path::wstring needs a UTF-8 locale outside Windows and throws
+ * on anything but ASCII without one. Bad sequences come out as U+FFFD.
+ */
+std::wstring PlayerPrefsBackend::ToWide(const std::string& utf8)
+{
+	std::wstring wide;
+	wide.reserve(utf8.size());
+	for (size_t i = 0; i < utf8.size(); )
+	{
+		unsigned char lead = static_cast<unsigned char>(utf8[i]);
+		unsigned int codePoint = lead;
+		size_t length = 1;
+		if (lead >= 0xF0 && lead < 0xF8)
+		{
+			codePoint = lead & 0x07;
+			length = 4;
+		}
+		else if (lead >= 0xE0)
+		{
+			codePoint = lead & 0x0F;
+			length = 3;
+		}
+		else if (lead >= 0xC0)
+		{
+			codePoint = lead & 0x1F;
+			length = 2;
+		}
+		else if (lead >= 0x80)
+		{
+			codePoint = 0xFFFD;
+		}
+
+		size_t end = i + length;
+		for (++i; i < end; ++i)
+		{
+			unsigned char next = i < utf8.size() ? static_cast<unsigned char>(utf8[i]) : 0;
+			if ((next & 0xC0) != 0x80)
+			{
+				codePoint = 0xFFFD;
+				break;
+			}
+			codePoint = (codePoint << 6) | (next & 0x3F);
+		}
+
+		if (codePoint >= 0x10000 && sizeof(wchar_t) == 2)
+		{
+			codePoint -= 0x10000;
+			wide += static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+			wide += static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+		}
+		else
+		{
+			wide += static_cast<wchar_t>(codePoint);
+		}
+	}
+	return wide;
+}
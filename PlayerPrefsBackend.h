@@ -0,0 +1,61 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Where Unity keeps PlayerPrefs: one key per game, HKCU\SOFTWARE\(company)\(game)
+// on Windows. Company and game names are the same as the LocalLow folders.
+//
+// Key names compare case insensitively, as the registry does. A backend may
+// hold deletes back until Commit.
+class PlayerPrefsBackend
+{
+public:
+	static std::unique_ptr<PlayerPrefsBackend> Create(const std::string& localLow);
+	virtual ~PlayerPrefsBackend() = default;
+
+	// every key directly under SOFTWARE
+	virtual std::vector<std::wstring> ListCompanies() = 0;
+	virtual std::vector<std::wstring> ListGames(const std::wstring& company) = 0;
+	// deletes the game's key and everything under it
+	virtual bool DeleteGame(const std::wstring& company, const std::wstring& game) = 0;
+	// deletes the company's key, fails if it still has subkeys
+	virtual bool DeleteCompany(const std::wstring& company) = 0;
+	// makes the deletes so far stick, false if none of them did
+	virtual bool Commit() { return true; }
+
+	static std::wstring FoldName(const std::wstring& name);
+	static std::wstring ToWide(const std::string& utf8);
+};
+
+// PlayerPrefs kept in memory, standing in for the registry where there is none.
+// Counts every call, so benchmarks can tell how many registry round trips a
+// cleanup would have cost.
+class MemoryPlayerPrefsBackend : public PlayerPrefsBackend
+{
+public:
+	void AddGame(const std::wstring& company, const std::wstring& game);
+	bool HasGame(const std::wstring& company, const std::wstring& game);
+	bool HasCompany(const std::wstring& company);
+	size_t GetCallCount();
+
+	std::vector<std::wstring> ListCompanies() override;
+	std::vector<std::wstring> ListGames(const std::wstring& company) override;
+	bool DeleteGame(const std::wstring& company, const std::wstring& game) override;
+	bool DeleteCompany(const std::wstring& company) override;
+
+private:
+	struct Company
+	{
+		std::wstring name;
+		// folded name to name as written
+		std::map<std::wstring, std::wstring> games;
+	};
+
+	std::mutex mutex;
+	// folded name to company
+	std::map<std::wstring, Company> companies;
+	size_t callCount = 0;
+};
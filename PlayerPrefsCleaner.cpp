@@ -0,0 +1,124 @@
+#include "PlayerPrefsCleaner.h"
+#include <filesystem>
+#include <map>
+#include <set>
+
+
+/**
+ * @brief Works out which PlayerPrefs keys go with a batch of deleted saves.
+ *
+ * Only saves sitting directly in a company folder (LocalLow\company\game) have
+ * PlayerPrefs, anything else is skipped. Nothing is deleted here.
+ *
+ * @param backend Where the PlayerPrefs are.
+ * @param root The LocalLow folder the saves were in, in UTF-8.
+ * @param savePaths The deleted save folders, in UTF-8.
+ * @return The game keys that exist, and the company keys that will be empty without them.
+ */
+PlayerPrefsPlan PlayerPrefsCleaner::Plan(PlayerPrefsBackend& backend, const std::string& root, const std::vector<std::string>& savePaths)
+{
+	// requested games per company, by folded name.
+	std::map<std::wstring, std::set<std::wstring>> requested;
+	for (const std::string& savePath : savePaths)
+	{
+		std::wstring company;
+		std::wstring game;
+		if (SplitSavePath(root, savePath, company, game))
+		{
+			requested[PlayerPrefsBackend::FoldName(company)].insert(PlayerPrefsBackend::FoldName(game));
+		}
+	}
+
+	PlayerPrefsPlan plan;
+	if (requested.empty())
+	{
+		return plan;
+	}
+
+	// first level of the trie: every company under SOFTWARE, listed once.
+	std::map<std::wstring, std::wstring> companies;
+	for (const std::wstring& company : backend.ListCompanies())
+	{
+		companies.emplace(PlayerPrefsBackend::FoldName(company), company);
+	}
+
+	for (const auto& request : requested)
+	{
+		auto company = companies.find(request.first);
+		if (company == companies.end())
+		{
+			continue;
+		}
+
+		// second level, only for companies the batch touches.
+		size_t gameCount = 0;
+		size_t deleteCount = 0;
+		for (const std::wstring& game : backend.ListGames(company->second))
+		{
+			++gameCount;
+			if (request.second.count(PlayerPrefsBackend::FoldName(game)) != 0)
+			{
+				plan.games.emplace_back(company->second, game);
+				++deleteCount;
+			}
+		}
+
+		if (deleteCount > 0 && deleteCount == gameCount)
+		{
+			plan.companies.push_back(company->second);
+		}
+	}
+	return plan;
+}
+
+/**
+ * @brief Deletes the keys in a plan, games first then the companies they leave empty.
+ *
+ * @return How many keys were deleted, 0 if the backend couldn't commit them.
+ */
+size_t PlayerPrefsCleaner::Apply(PlayerPrefsBackend& backend, const PlayerPrefsPlan& plan)
+{
+	size_t deleted = 0;
+	for (const auto& game : plan.games)
+	{
+		deleted += backend.DeleteGame(game.first, game.second) ? 1 : 0;
+	}
+	for (const std::wstring& company : plan.companies)
+	{
+		deleted += backend.DeleteCompany(company) ? 1 : 0;
+	}
+	return backend.Commit() ? deleted : 0;
+}
+
+/**
+ * @brief Gets the company and game folder names of a save directly inside a company.
+ *
+ * @return False if the save isn't exactly two folders below root.
+ */
+bool PlayerPrefsCleaner::SplitSavePath(const std::string& root, const std::string& savePath, std::wstring& company, std::wstring& game)
+{
+	std::filesystem::path relative = std::filesystem::u8path(savePath).lexically_relative(std::filesystem::u8path(root));
+
+	std::vector<std::filesystem::path> parts;
+	for (const std::filesystem::path& part : relative)
+	{
+		// a trailing slash on either path gives an empty last part.
+		if (part.empty())
+		{
+			continue;
+		}
+		if (part == "." || part == "..")
+		{
+			return false;
+		}
+		parts.push_back(part);
+	}
+
+	if (parts.size() != 2)
+	{
+		return false;
+	}
+	company = PlayerPrefsBackend::ToWide(parts[0].u8string());
+	game = PlayerPrefsBackend::ToWide(parts[1].u8string());
+	return true;
+}
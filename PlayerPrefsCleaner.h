@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+#include "PlayerPrefsBackend.h"
+
+// The keys a PlayerPrefs cleanup will delete, names as the backend has them.
+struct PlayerPrefsPlan
+{
+	// company, game
+	std::vector<std::pair<std::wstring, std::wstring>> games;
+	// companies left with no games once those are gone
+	std::vector<std::wstring> companies;
+};
+
+// Deletes the PlayerPrefs of a batch of deleted saves in one pass.
+//
+// SOFTWARE is listed once into a company/game trie, and only the companies the
+// batch touches have their games listed. Every game key to delete, and every
+// company key that ends up empty, is worked out from the trie before anything
+// is deleted. A batch then costs one listing plus one call per key, rather than
+// several round trips per save.
+class PlayerPrefsCleaner
+{
+public:
+	static PlayerPrefsPlan Plan(PlayerPrefsBackend& backend, const std::string& root, const std::vector<std::string>& savePaths);
+	static size_t Apply(PlayerPrefsBackend& backend, const PlayerPrefsPlan& plan);
+
+private:
+	static bool SplitSavePath(const std::string& root, const std::string& savePath, std::wstring& company, std::wstring& game);
+};
@@ -0,0 +1,245 @@
+#include "RootDiscovery.h"
+#include <cstdlib>
+#include <fstream>
+#include <system_error>
+
+#ifdef _WIN32
+#include <shlobj.h>
+#endif
+
+
+/**
+ * @brief Lists every LocalLow folder worth scanning, the current user's first.
+ *
+ * @param currentLocalLow The current user's LocalLow, see FindSave::GetAppDataPath.
+ * @return The roots that exist, each folder once.
+ */
+std::vector<ScanRoot> RootDiscovery::FindAll(const std::string& currentLocalLow)
+{
+	RootDiscovery discovery;
+	discovery.AddRoot(std::filesystem::u8path(currentLocalLow), "This user", RootKind::CurrentUser);
+
+#ifdef _WIN32
+	discovery.AddProfileRoots();
+#else
+	const char* home = std::getenv("HOME");
+	const char* winePrefix = std::getenv("WINEPREFIX");
+	if (winePrefix != nullptr && *winePrefix != '\0')
+	{
+		discovery.AddPrefixRoots(std::filesystem::u8path(winePrefix), "Wine");
+	}
+	if (home != nullptr)
+	{
+		discovery.AddPrefixRoots(std::filesystem::u8path(home) / ".wine", "Wine");
+	}
+	for (const std::filesystem::path& steam : FindSteamFolders())
+	{
+		discovery.AddSteamRoots(steam);
+	}
+#endif
+	return discovery.roots;
+}
+
+/**
+ * @brief Lists the Steam installs on this machine, each folder once.
+ *
+ * On Windows that is the one the registry names, or the default under Program
+ * Files. Elsewhere it is the native and Flatpak installs, and the link most
+ * installs leave behind.
+ *
+ * @return Steam folders that exist, the ones holding steamapps.
+ */
+std::vector<std::filesystem::path> RootDiscovery::FindSteamFolders()
+{
+	std::vector<std::filesystem::path> candidates;
+#ifdef _WIN32
+	wchar_t steamPath[MAX_PATH];
+	DWORD size = sizeof(steamPath);
+	if (RegGetValueW(HKEY_CURRENT_USER, L"Software\\Valve\\Steam", L"SteamPath", RRF_RT_REG_SZ, nullptr, steamPath, &size) == ERROR_SUCCESS)
+	{
+		candidates.push_back(std::filesystem::path(steamPath));
+	}
+
+	PWSTR path = NULL;
+	if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_ProgramFilesX86, 0, NULL, &path)))
+	{
+		candidates.push_back(std::filesystem::path(path) / L"Steam");
+	}
+	CoTaskMemFree(path);
+#else
+	const char* home = std::getenv("HOME");
+	if (home != nullptr)
+	{
+		std::filesystem::path homePath = std::filesystem::u8path(home);
+		candidates.push_back(homePath / ".local" / "share" / "Steam");
+		candidates.push_back(homePath / ".var" / "app" / "com.valvesoftware.Steam" / ".local" / "share" / "Steam");
+		candidates.push_back(homePath / ".steam" / "steam");
+	}
+#endif
+
+	std::vector<std::filesystem::path> folders;
+	std::set<std::string> seen;
+	for (const std::filesystem::path& candidate : candidates)
+	{
+		std::error_code error;
+		if (std::filesystem::is_directory(candidate / "steamapps", error) && seen.insert(RootKey(candidate)).second)
+		{
+			folders.push_back(candidate);
+		}
+	}
+	return folders;
+}
+
+/**
+ * @brief Adds the LocalLow of every user in a Wine prefix.
+ *
+ * @param prefix The prefix folder, the one holding drive_c and user.reg.
+ * @param label Names the roots, a user other than Proton's steamuser is added to it.
+ */
+void RootDiscovery::AddPrefixRoots(const std::filesystem::path& prefix, const std::string& label)
+{
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(prefix / "drive_c" / "users", error), end; !error && it != end; it.increment(error))
+	{
+		std::error_code entryError;
+		std::string user = it->path().filename().u8string();
+		if (!it->is_directory(entryError) || user == "Public")
+		{
+			continue;
+		}
+
+		std::string rootLabel = user == "steamuser" ? label : label + " (" + user + ")";
+		AddRoot(it->path() / "AppData" / "LocalLow", rootLabel, RootKind::Prefix);
+	}
+}
+
+/**
+ * @brief Adds the LocalLow of every Proton prefix in every library of a Steam install.
+ *
+ * Roots are labelled with their app id. A library listed by several Steam
+ * installs (or twice in one) only has its prefixes added once, AddRoot sees to that.
+ *
+ * @param steam The Steam folder, the one holding steamapps.
+ */
+void RootDiscovery::AddSteamRoots(const std::filesystem::path& steam)
+{
+	std::vector<std::filesystem::path> libraries = ReadLibraryFolders(steam);
+	libraries.insert(libraries.begin(), steam);
+
+	std::set<std::string> librariesSeen;
+	for (const std::filesystem::path& library : libraries)
+	{
+		if (!librariesSeen.insert(RootKey(library)).second)
+		{
+			continue;
+		}
+
+		std::error_code error;
+		for (std::filesystem::directory_iterator it(library / "steamapps" / "compatdata", error), end; !error && it != end; it.increment(error))
+		{
+			AddPrefixRoots(it->path() / "pfx", "Proton " + it->path().filename().u8string());
+		}
+	}
+}
+
+/**
+ * @brief Adds the AppData\LocalLow of every profile on a Windows machine.
+ *
+ * Profiles without one, or that can't be read, are left out.
+ */
+void RootDiscovery::AddProfileRoots()
+{
+#ifdef _WIN32
+	PWSTR path = NULL;
+	HRESULT result = SHGetKnownFolderPath(FOLDERID_UserProfiles, 0, NULL, &path);
+	if (!SUCCEEDED(result))
+	{
+		return;
+	}
+	std::filesystem::path profiles(path);
+	CoTaskMemFree(path);
+
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(profiles, std::filesystem::directory_options::skip_permission_denied, error), end; !error && it != end; it.increment(error))
+	{
+		std::error_code entryError;
+		if (it->is_directory(entryError) && !it->is_symlink(entryError))
+		{
+			AddRoot(it->path() / "AppData" / "LocalLow", "User " + it->path().filename().u8string(), RootKind::Profile);
+		}
+	}
+#endif
+}
+
+/**
+ * @brief Reads the library folders out of a Steam install's libraryfolders.vdf.
+ *
+ * Only the "path" values are needed, so the file is read line by line rather
+ * than parsed as KeyValues.
+ *
+ * @param steam The Steam folder.
+ * @return Every library folder listed, may include the Steam folder itself.
+ */
+std::vector<std::filesystem::path> RootDiscovery::ReadLibraryFolders(const std::filesystem::path& steam)
+{
+	std::vector<std::filesystem::path> libraries;
+	std::ifstream input(steam / "steamapps" / "libraryfolders.vdf", std::ios::binary);
+	std::string line;
+	while (std::getline(input, line))
+	{
+		size_t key = line.find("\"path\"");
+		if (key == std::string::npos)
+		{
+			continue;
+		}
+		size_t start = line.find('"', key + 6);
+		if (start == std::string::npos)
+		{
+			continue;
+		}
+
+		// \\ is the only escape Steam writes in paths.
+		std::string value;
+		for (size_t i = start + 1; i < line.size() && line[i] != '"'; ++i)
+		{
+			if (line[i] == '\\' && i + 1 < line.size())
+			{
+				++i;
+			}
+			value += line[i];
+		}
+		if (!value.empty())
+		{
+			libraries.push_back(std::filesystem::u8path(value));
+		}
+	}
+	return libraries;
+}
+
+/**
+ * @brief Adds a root if the folder exists and isn't listed yet.
+ */
+void RootDiscovery::AddRoot(const std::filesystem::path& path, const std::string& label, RootKind kind)
+{
+	std::error_code error;
+	if (!std::filesystem::is_directory(path, error) || !seen.insert(RootKey(path)).second)
+	{
+		return;
+	}
+
+	ScanRoot root;
+	root.path = path.u8string();
+	root.label = label;
+	root.kind = kind;
+	roots.push_back(root);
+}
+
+/**
+ * @brief Gets a folder's path with links resolved, so two ways to the same folder compare equal.
+ */
+std::string RootDiscovery::RootKey(const std::filesystem::path& path)
+{
+	std::error_code error;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+	return (error ? path : canonical).u8string();
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
+// Where a LocalLow folder was found.
+enum class RootKind
+{
+	CurrentUser,	// the LocalLow of whoever is running this
+	Profile,	// another Windows profile on the same machine
+	Prefix		// a Wine prefix, Proton's included, its PlayerPrefs are in the prefix's user.reg
+};
+
+// One LocalLow folder to scan.
+struct ScanRoot
+{
+	std::string path;
+	// who or what it belongs to, e.g. "Proton 620" or "User alice"
+	std::string label;
+	RootKind kind = RootKind::CurrentUser;
+};
+
+// Finds every LocalLow folder on the machine that can hold Unity saves.
+//
+// On Windows that is each profile's AppData\LocalLow. Elsewhere it is the
+// native Unity folder, ~/.wine and $WINEPREFIX, and every Proton prefix under
+// steamapps/compatdata of each Steam library, found through the default
+// Steam installs and their libraryfolders.vdf. Inside a prefix every user of
+// drive_c counts, Proton's is steamuser.
+//
+// Roots are only listed if they exist, and the same folder reached twice
+// (~/.steam/steam is usually a link) is only listed once.
+class RootDiscovery
+{
+public:
+	static std::vector<ScanRoot> FindAll(const std::string& currentLocalLow);
+	static std::vector<std::filesystem::path> FindSteamFolders();
+	static std::vector<std::filesystem::path> ReadLibraryFolders(const std::filesystem::path& steam);
+
+	void AddPrefixRoots(const std::filesystem::path& prefix, const std::string& label);
+	void AddSteamRoots(const std::filesystem::path& steam);
+	const std::vector<ScanRoot>& GetRoots() const { return roots; }
+
+private:
+	void AddProfileRoots();
+	void AddRoot(const std::filesystem::path& path, const std::string& label, RootKind kind);
+	static std::string RootKey(const std::filesystem::path& path);
+
+	std::vector<ScanRoot> roots;
+	// RootKey of every root listed
+	std::set<std::string> seen;
+};
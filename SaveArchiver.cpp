@@ -0,0 +1,885 @@
+#include "SaveArchiver.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <set>
+#include <system_error>
+#include <utility>
+#include <zlib.h>
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// zip record signatures
+	const uint32_t LOCAL_HEADER = 0x04034b50;
+	const uint32_t DATA_DESCRIPTOR = 0x08074b50;
+	const uint32_t CENTRAL_HEADER = 0x02014b50;
+	const uint32_t ZIP64_END = 0x06064b50;
+	const uint32_t ZIP64_LOCATOR = 0x07064b50;
+	const uint32_t END_OF_CENTRAL_DIRECTORY = 0x06054b50;
+
+	const uint16_t ZIP64_EXTRA = 0x0001;
+	// names are UTF-8, and sizes follow the data
+	const uint16_t FLAG_UTF8 = 0x0800;
+	const uint16_t FLAG_DESCRIPTOR = 0x0008;
+	const uint16_t METHOD_STORED = 0;
+	const uint16_t METHOD_DEFLATED = 8;
+	const uint16_t VERSION_DEFLATE = 20;
+	const uint16_t VERSION_ZIP64 = 45;
+	const uint32_t ATTRIBUTE_FOLDER = 0x10;
+	const uint32_t ATTRIBUTE_ARCHIVE = 0x20;
+
+	const uint32_t MAX_32 = 0xFFFFFFFF;
+	const uint16_t MAX_16 = 0xFFFF;
+	// files this big get zip64 sizes up front, deflate can grow data a little
+	const uint64_t ZIP64_FILE_SIZE = 0xF0000000;
+
+	void Put16(std::string& bytes, uint16_t value)
+	{
+		bytes += static_cast<char>(value & 0xFF);
+		bytes += static_cast<char>(value >> 8);
+	}
+
+	void Put32(std::string& bytes, uint32_t value)
+	{
+		Put16(bytes, static_cast<uint16_t>(value & 0xFFFF));
+		Put16(bytes, static_cast<uint16_t>(value >> 16));
+	}
+
+	void Put64(std::string& bytes, uint64_t value)
+	{
+		Put32(bytes, static_cast<uint32_t>(value & MAX_32));
+		Put32(bytes, static_cast<uint32_t>(value >> 32));
+	}
+
+	// one deflate stream per thread, reset for every chunk, so small files don't
+	// each pay for setting up zlib's window and hash tables.
+	struct Deflater
+	{
+		z_stream stream{};
+		int level = 0;
+		bool ready = false;
+
+		~Deflater()
+		{
+			if (ready)
+			{
+				deflateEnd(&stream);
+			}
+		}
+
+		bool Start(int compressionLevel)
+		{
+			if (ready && level != compressionLevel)
+			{
+				deflateEnd(&stream);
+				ready = false;
+			}
+			if (ready)
+			{
+				return deflateReset(&stream) == Z_OK;
+			}
+			stream = z_stream{};
+			// raw deflate, the zip headers stand in for zlib's
+			ready = deflateInit2(&stream, compressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+			level = compressionLevel;
+			return ready;
+		}
+	};
+}
+
+
+/**
+ * @brief Writes save folders and everything in them into a new zip file, blocking until done.
+ *
+ * Each save folder goes in as "<company>/<game>/...", with " (2)" and so on
+ * added if two have the same names. Symlinks and junctions are left out, never
+ * followed. A file that can't be read, or changes while it is, fails its save
+ * folder but the rest still goes in. If the archive can't be written the
+ * remaining save folders are never handed on, and the zip is cut back to the
+ * ones that were, see Finish.
+ *
+ * @param paths Save folders in UTF-8.
+ * @param archiveFile The zip to write in UTF-8, replaced if it exists.
+ * @param pool Compresses the chunks, and can be deleting at the same time.
+ * @param observer Gets each save folder as it is archived.
+ * @return What went in, and whether the archive could be written.
+ */
+ArchiveSummary SaveArchiver::ArchiveAll(const std::vector<std::string>& paths, const std::string& archiveFile, ThreadPool& pool, const ArchiveObserver& observer)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	ArchiveRun run(pool, observer, compressionLevel);
+
+	bool opened = OpenFile(run, archiveFile);
+	if (!opened)
+	{
+		Fail(run, archiveFile + ": " + LastErrorMessage());
+	}
+
+	std::set<std::string> usedNames;
+	for (size_t i = 0; i < paths.size() && !run.failed && !IsCancelled(observer); ++i)
+	{
+		std::filesystem::path root = std::filesystem::u8path(paths[i]);
+		std::string name = root.parent_path().filename().u8string() + "/" + root.filename().u8string();
+		std::string unique = name;
+		for (int copy = 2; !usedNames.insert(unique).second; ++copy)
+		{
+			unique = name + " (" + std::to_string(copy) + ")";
+		}
+		AddItem(run, i, root, unique);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(run.recordMutex);
+		run.recordsChanged.wait(lock, [&run]() { return run.records.empty() && !run.writing; });
+	}
+
+	ArchiveSummary summary;
+	if (opened)
+	{
+		TraceRecorder::Span span(observer.trace, "write central directory", "archive");
+		summary.readable = Finish(run, archiveFile);
+	}
+
+	// counted from what is left in the zip, after any cut.
+	summary.itemsArchived = run.itemsArchived;
+	for (const std::shared_ptr<Entry>& entry : run.written)
+	{
+		if (entry->folder)
+		{
+			++summary.foldersArchived;
+		}
+		else
+		{
+			++summary.filesArchived;
+			summary.bytesRead += entry->uncompressedSize;
+		}
+	}
+	summary.bytesWritten = run.offset;
+	summary.milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+	summary.error = run.error;
+	summary.cancelled = IsCancelled(observer);
+	return summary;
+}
+/**
+ * @brief Sets how hard ArchiveAll compresses.
+ *
+ * @param level zlib level, 1 is fastest and 9 smallest.
+ */
+void SaveArchiver::SetCompressionLevel(int level)
+{
+	compressionLevel = std::clamp(level, 1, 9);
+}
+/**
+ * @brief Queues everything in one save folder, then its end.
+ *
+ * Folders are listed on the calling thread, as the queue has room. Files are
+ * read and compressed by the pool.
+ *
+ * @param run The archive the save folder goes in.
+ * @param item Index of the save folder, passed back to the observer.
+ * @param root The save folder.
+ * @param name What it is called in the archive.
+ */
+void SaveArchiver::AddItem(ArchiveRun& run, size_t item, const std::filesystem::path& root, const std::string& name)
+{
+	std::unique_ptr<Record> end = std::make_unique<Record>();
+	end->item = item;
+	end->startTime = std::chrono::steady_clock::now();
+
+	// folders still to list, with their names in the archive
+	std::vector<std::pair<std::filesystem::path, std::string>> folders;
+	folders.emplace_back(root, name + "/");
+	while (!folders.empty() && !run.failed && !IsCancelled(run.observer))
+	{
+		std::pair<std::filesystem::path, std::string> folder = std::move(folders.back());
+		folders.pop_back();
+
+		std::error_code error;
+		std::shared_ptr<Entry> folderEntry = std::make_shared<Entry>();
+		folderEntry->name = folder.second;
+		folderEntry->folder = true;
+		ToDosTime(std::filesystem::last_write_time(folder.first, error), folderEntry->dosTime, folderEntry->dosDate);
+		std::unique_ptr<Record> folderRecord = std::make_unique<Record>();
+		folderRecord->item = item;
+		folderRecord->entry = folderEntry;
+		Queue(run, std::move(folderRecord));
+
+		for (std::filesystem::directory_iterator it(folder.first, error), last; !error && it != last; it.increment(error))
+		{
+			std::error_code entryError;
+			std::filesystem::file_type type = it->symlink_status(entryError).type();
+			std::string entryName = folder.second + it->path().filename().u8string();
+			if (type == std::filesystem::file_type::directory)
+			{
+				folders.emplace_back(it->path(), entryName + "/");
+				continue;
+			}
+			if (type != std::filesystem::file_type::regular)
+			{
+				continue;
+			}
+
+			std::shared_ptr<Entry> file = std::make_shared<Entry>();
+			file->name = entryName;
+			file->path = it->path();
+			file->size = it->file_size(entryError);
+			ToDosTime(it->last_write_time(entryError), file->dosTime, file->dosDate);
+			if (entryError)
+			{
+				if (end->error.empty())
+				{
+					end->error = it->path().u8string() + ": " + entryError.message();
+				}
+				continue;
+			}
+			file->chunkCount = std::max<size_t>(1, static_cast<size_t>((file->size + CONSTANT::ARCHIVE_CHUNK_BYTES - 1) / CONSTANT::ARCHIVE_CHUNK_BYTES));
+			file->zip64 = file->chunkCount > 1 && file->size >= ZIP64_FILE_SIZE;
+			for (size_t chunk = 0; chunk < file->chunkCount; ++chunk)
+			{
+				std::unique_ptr<Record> record = std::make_unique<Record>();
+				record->item = item;
+				record->entry = file;
+				record->chunk = chunk;
+				Queue(run, std::move(record));
+			}
+		}
+		if (error && end->error.empty())
+		{
+			end->error = folder.first.u8string() + ": " + error.message();
+		}
+	}
+
+	// a save folder cut short is never handed on, there is more of it than went in.
+	if (!folders.empty() && end->error.empty())
+	{
+		end->error = "archiving stopped";
+	}
+	Queue(run, std::move(end));
+}
+/**
+ * @brief Adds a record to the back of the queue, waiting for room first.
+ *
+ * File chunks go to the pool to be read and compressed, anything else is
+ * ready to write straight away.
+ */
+void SaveArchiver::Queue(ArchiveRun& run, std::unique_ptr<Record> record)
+{
+	Record* queued = record.get();
+	bool compress = record->entry && !record->entry->folder && record->entry->size > 0;
+	// an empty file has nothing to read, and a deflate stream can't be empty.
+	record->stored = !compress;
+	{
+		std::unique_lock<std::mutex> lock(run.recordMutex);
+		run.recordsChanged.wait(lock, [&run]() { return run.records.size() < CONSTANT::ARCHIVE_CHUNKS_IN_FLIGHT; });
+		run.records.push_back(std::move(record));
+	}
+
+	if (!compress)
+	{
+		WriteReady(run, queued);
+		return;
+	}
+	run.pool.Submit([this, &run, queued]()
+		{
+			{
+				TraceRecorder::Span span(run.observer.trace, "compress chunk", "archive");
+				Compress(run, *queued);
+			}
+			WriteReady(run, queued);
+		});
+}
+/**
+ * @brief Reads one chunk of a file, and deflates it on its own.
+ *
+ * The last chunk of a file finishes the deflate stream, the others end with a
+ * sync flush so the next chunk's blocks can follow straight on. A file that
+ * fits in one chunk is stored as it is if deflating doesn't make it smaller.
+ *
+ * @param run The archive the chunk is for.
+ * @param record The chunk, gets its data, CRC and any error.
+ */
+void SaveArchiver::Compress(ArchiveRun& run, Record& record)
+{
+	const Entry& entry = *record.entry;
+	if (run.failed || IsCancelled(run.observer))
+	{
+		record.error = "archiving stopped";
+		return;
+	}
+
+	uint64_t offset = static_cast<uint64_t>(record.chunk) * CONSTANT::ARCHIVE_CHUNK_BYTES;
+	size_t length = static_cast<size_t>(std::min<uint64_t>(CONSTANT::ARCHIVE_CHUNK_BYTES, entry.size - std::min(entry.size, offset)));
+	bool lastChunk = record.chunk + 1 == entry.chunkCount;
+
+	std::vector<unsigned char> raw(length);
+	std::ifstream in(entry.path, std::ios::binary);
+	if (in && offset > 0)
+	{
+		in.seekg(static_cast<std::streamoff>(offset));
+	}
+	if (in)
+	{
+		in.read(reinterpret_cast<char*>(raw.data()), static_cast<std::streamsize>(length));
+		raw.resize(static_cast<size_t>(in.gcount()));
+	}
+	else
+	{
+		raw.clear();
+	}
+	if (raw.size() != length)
+	{
+		record.error = entry.path.u8string() + ": could not be read completely";
+	}
+	else if (lastChunk && in.peek() != std::ifstream::traits_type::eof())
+	{
+		record.error = entry.path.u8string() + ": grew while being archived";
+	}
+
+	record.rawBytes = raw.size();
+	record.crc = static_cast<uint32_t>(crc32(0, raw.data(), static_cast<uInt>(raw.size())));
+
+	thread_local Deflater deflater;
+	if (!deflater.Start(run.compressionLevel))
+	{
+		record.data = std::move(raw);
+		record.stored = true;
+		if (entry.chunkCount > 1 && record.error.empty())
+		{
+			// a file split in chunks can't be stored, the chunks would have to agree.
+			record.error = entry.path.u8string() + ": could not be compressed";
+		}
+		return;
+	}
+
+	z_stream& stream = deflater.stream;
+	stream.next_in = raw.data();
+	stream.avail_in = static_cast<uInt>(raw.size());
+	int flush = lastChunk ? Z_FINISH : Z_SYNC_FLUSH;
+	// room for the sync flush's empty block on top of the worst case
+	record.data.resize(deflateBound(&stream, static_cast<uLong>(raw.size())) + 16);
+	size_t produced = 0;
+	for (;;)
+	{
+		stream.next_out = record.data.data() + produced;
+		stream.avail_out = static_cast<uInt>(record.data.size() - produced);
+		int result = deflate(&stream, flush);
+		produced = record.data.size() - stream.avail_out;
+		if (result == Z_STREAM_END || (flush == Z_SYNC_FLUSH && stream.avail_in == 0 && stream.avail_out > 0))
+		{
+			break;
+		}
+		if (result != Z_OK && result != Z_BUF_ERROR)
+		{
+			record.error = entry.path.u8string() + ": could not be compressed";
+			break;
+		}
+		record.data.resize(record.data.size() * 2);
+	}
+	record.data.resize(produced);
+
+	if (entry.chunkCount == 1 && record.data.size() >= raw.size())
+	{
+		record.data = std::move(raw);
+		record.stored = true;
+	}
+}
+/**
+ * @brief Marks a record ready, then writes out every ready record at the front of the queue.
+ *
+ * Only one thread writes at a time, any other that finishes a record meanwhile
+ * leaves it for the writer to pick up.
+ *
+ * @param run The archive the record is in.
+ * @param finished The record that is now ready.
+ */
+void SaveArchiver::WriteReady(ArchiveRun& run, Record* finished)
+{
+	std::unique_lock<std::mutex> lock(run.recordMutex);
+	finished->ready = true;
+	if (run.writing)
+	{
+		return;
+	}
+
+	run.writing = true;
+	while (!run.records.empty() && run.records.front()->ready)
+	{
+		std::unique_ptr<Record> record = std::move(run.records.front());
+		run.records.pop_front();
+		run.recordsChanged.notify_all();
+		lock.unlock();
+		WriteRecord(run, *record);
+		record.reset();
+		lock.lock();
+	}
+	run.writing = false;
+	run.recordsChanged.notify_all();
+}
+/**
+ * @brief Writes one record to the archive, in queue order.
+ *
+ * The first chunk of a file writes its local header, the last its data
+ * descriptor, if it has one. The end of a save folder writes out and syncs
+ * everything so far, then hands the save folder on if all of it went in. It is
+ * deleted straight after, so it has to be on disk first.
+ */
+void SaveArchiver::WriteRecord(ArchiveRun& run, Record& record)
+{
+	if (!record.error.empty() && run.itemError.empty())
+	{
+		run.itemError = record.error;
+	}
+
+	if (!record.entry)
+	{
+		if (!run.failed)
+		{
+			if (WriteBuffer(run) && SyncFile(run))
+			{
+				run.committedOffset = run.offset;
+				run.committedEntries = run.written.size();
+			}
+			else
+			{
+				Fail(run, "the archive could not be written: " + LastErrorMessage());
+			}
+		}
+		if (run.observer.trace != nullptr)
+		{
+			run.observer.trace->Record("archive save", "archive", record.startTime, std::chrono::steady_clock::now());
+		}
+		if (!run.failed && !IsCancelled(run.observer))
+		{
+			if (run.itemError.empty())
+			{
+				++run.itemsArchived;
+				if (run.observer.onItemArchived)
+				{
+					run.observer.onItemArchived(record.item);
+				}
+			}
+			else if (run.observer.onItemFailed)
+			{
+				run.observer.onItemFailed(record.item, run.itemError);
+			}
+		}
+		run.itemError.clear();
+		return;
+	}
+
+	Entry& entry = *record.entry;
+	if (entry.folder)
+	{
+		entry.offset = run.offset;
+		WriteLocalHeader(run, entry);
+		run.written.push_back(record.entry);
+		return;
+	}
+
+	if (record.chunk == 0)
+	{
+		entry.offset = run.offset;
+		if (entry.chunkCount == 1)
+		{
+			entry.method = record.stored ? METHOD_STORED : METHOD_DEFLATED;
+			entry.crc = record.crc;
+			entry.compressedSize = record.data.size();
+			entry.uncompressedSize = record.rawBytes;
+		}
+		else
+		{
+			entry.method = METHOD_DEFLATED;
+			entry.descriptor = true;
+		}
+		WriteLocalHeader(run, entry);
+	}
+	if (entry.descriptor)
+	{
+		entry.crc = record.chunk == 0 ? record.crc : static_cast<uint32_t>(crc32_combine(entry.crc, record.crc, static_cast<z_off_t>(record.rawBytes)));
+		entry.compressedSize += record.data.size();
+		entry.uncompressedSize += record.rawBytes;
+	}
+	Write(run, record.data.data(), record.data.size());
+
+	if (record.chunk + 1 == entry.chunkCount)
+	{
+		if (entry.descriptor)
+		{
+			std::string descriptor;
+			Put32(descriptor, DATA_DESCRIPTOR);
+			Put32(descriptor, entry.crc);
+			if (entry.zip64)
+			{
+				Put64(descriptor, entry.compressedSize);
+				Put64(descriptor, entry.uncompressedSize);
+			}
+			else
+			{
+				Put32(descriptor, static_cast<uint32_t>(entry.compressedSize));
+				Put32(descriptor, static_cast<uint32_t>(entry.uncompressedSize));
+			}
+			Write(run, descriptor.data(), descriptor.size());
+		}
+		entry.path.clear();
+		run.written.push_back(record.entry);
+	}
+}
+/**
+ * @brief Writes the header in front of a file's data, or a folder.
+ *
+ * With a data descriptor to follow, the CRC and sizes are left at zero.
+ */
+void SaveArchiver::WriteLocalHeader(ArchiveRun& run, const Entry& entry)
+{
+	std::string header;
+	Put32(header, LOCAL_HEADER);
+	Put16(header, entry.zip64 ? VERSION_ZIP64 : VERSION_DEFLATE);
+	Put16(header, static_cast<uint16_t>(FLAG_UTF8 | (entry.descriptor ? FLAG_DESCRIPTOR : 0)));
+	Put16(header, entry.method);
+	Put16(header, entry.dosTime);
+	Put16(header, entry.dosDate);
+	Put32(header, entry.crc);
+	Put32(header, entry.zip64 ? MAX_32 : static_cast<uint32_t>(entry.compressedSize));
+	Put32(header, entry.zip64 ? MAX_32 : static_cast<uint32_t>(entry.uncompressedSize));
+	Put16(header, static_cast<uint16_t>(entry.name.size()));
+	Put16(header, static_cast<uint16_t>(entry.zip64 ? 20 : 0));
+	header += entry.name;
+	if (entry.zip64)
+	{
+		Put16(header, ZIP64_EXTRA);
+		Put16(header, 16);
+		Put64(header, 0);
+		Put64(header, 0);
+	}
+	Write(run, header.data(), header.size());
+}
+/**
+ * @brief Makes the central directory listing every entry, and the records that end the zip.
+ *
+ * Sizes and offsets that don't fit in 32 bits go in a zip64 extra field, and
+ * a zip64 end record is added if the entry count or the directory needs one.
+ *
+ * @return What goes at run.offset to finish the zip.
+ */
+std::string SaveArchiver::MakeCentralDirectory(const ArchiveRun& run)
+{
+	uint64_t directoryOffset = run.offset;
+	std::string directory;
+	for (const std::shared_ptr<Entry>& written : run.written)
+	{
+		const Entry& entry = *written;
+		std::string extra;
+		if (entry.uncompressedSize >= MAX_32)
+		{
+			Put64(extra, entry.uncompressedSize);
+		}
+		if (entry.compressedSize >= MAX_32)
+		{
+			Put64(extra, entry.compressedSize);
+		}
+		if (entry.offset >= MAX_32)
+		{
+			Put64(extra, entry.offset);
+		}
+		bool zip64 = entry.zip64 || !extra.empty();
+
+		Put32(directory, CENTRAL_HEADER);
+		Put16(directory, VERSION_ZIP64);
+		Put16(directory, zip64 ? VERSION_ZIP64 : VERSION_DEFLATE);
+		Put16(directory, static_cast<uint16_t>(FLAG_UTF8 | (entry.descriptor ? FLAG_DESCRIPTOR : 0)));
+		Put16(directory, entry.method);
+		Put16(directory, entry.dosTime);
+		Put16(directory, entry.dosDate);
+		Put32(directory, entry.crc);
+		Put32(directory, static_cast<uint32_t>(std::min<uint64_t>(entry.compressedSize, MAX_32)));
+		Put32(directory, static_cast<uint32_t>(std::min<uint64_t>(entry.uncompressedSize, MAX_32)));
+		Put16(directory, static_cast<uint16_t>(entry.name.size()));
+		Put16(directory, static_cast<uint16_t>(extra.empty() ? 0 : extra.size() + 4));
+		// comment, disk, internal attributes
+		Put16(directory, 0);
+		Put16(directory, 0);
+		Put16(directory, 0);
+		Put32(directory, entry.folder ? ATTRIBUTE_FOLDER : ATTRIBUTE_ARCHIVE);
+		Put32(directory, static_cast<uint32_t>(std::min<uint64_t>(entry.offset, MAX_32)));
+		directory += entry.name;
+		if (!extra.empty())
+		{
+			Put16(directory, ZIP64_EXTRA);
+			Put16(directory, static_cast<uint16_t>(extra.size()));
+			directory += extra;
+		}
+	}
+
+	uint64_t directorySize = directory.size();
+	uint64_t entryCount = run.written.size();
+	if (entryCount >= MAX_16 || directoryOffset >= MAX_32 || directorySize >= MAX_32)
+	{
+		uint64_t zip64EndOffset = directoryOffset + directorySize;
+		Put32(directory, ZIP64_END);
+		Put64(directory, 44);
+		Put16(directory, VERSION_ZIP64);
+		Put16(directory, VERSION_ZIP64);
+		Put32(directory, 0);
+		Put32(directory, 0);
+		Put64(directory, entryCount);
+		Put64(directory, entryCount);
+		Put64(directory, directorySize);
+		Put64(directory, directoryOffset);
+
+		Put32(directory, ZIP64_LOCATOR);
+		Put32(directory, 0);
+		Put64(directory, zip64EndOffset);
+		Put32(directory, 1);
+	}
+	Put32(directory, END_OF_CENTRAL_DIRECTORY);
+	Put16(directory, 0);
+	Put16(directory, 0);
+	Put16(directory, static_cast<uint16_t>(std::min<uint64_t>(entryCount, MAX_16)));
+	Put16(directory, static_cast<uint16_t>(std::min<uint64_t>(entryCount, MAX_16)));
+	Put32(directory, static_cast<uint32_t>(std::min<uint64_t>(directorySize, MAX_32)));
+	Put32(directory, static_cast<uint32_t>(std::min<uint64_t>(directoryOffset, MAX_32)));
+	Put16(directory, 0);
+	return directory;
+}
+/**
+ * @brief Finishes the zip off with its central directory, and closes it.
+ *
+ * If the archive failed part way, whatever was written after the last save
+ * folder that went in completely is cut off first, and the directory lists
+ * only what is left. Those are the save folders that were handed on, they are
+ * on disk already, and this way they can be read back from the zip.
+ *
+ * @return True if the zip got its central directory and can be opened.
+ */
+bool SaveArchiver::Finish(ArchiveRun& run, const std::string& archiveFile)
+{
+	if (run.failed)
+	{
+		run.buffer.clear();
+		if (!TruncateFile(run, run.committedOffset))
+		{
+			run.error += ", and it could not be cut back to the saves in it: " + LastErrorMessage();
+			CloseFile(run);
+			return false;
+		}
+		run.offset = run.committedOffset;
+		run.written.resize(run.committedEntries);
+	}
+
+	std::string directory = MakeCentralDirectory(run);
+	run.buffer += directory;
+	bool finished = WriteBuffer(run) && SyncFile(run);
+	std::string error = finished ? std::string() : LastErrorMessage();
+	if (!CloseFile(run) && finished)
+	{
+		finished = false;
+		error = LastErrorMessage();
+	}
+	if (!finished)
+	{
+		std::string message = archiveFile + ": its central directory could not be written, " + error;
+		run.error = run.error.empty() ? message : run.error + ", and " + message;
+		return false;
+	}
+	run.offset += directory.size();
+	return true;
+}
+/**
+ * @brief Appends bytes to the archive, unless it has already failed.
+ *
+ * They are gathered in run.buffer and written out a chunk's worth at a time.
+ */
+void SaveArchiver::Write(ArchiveRun& run, const void* bytes, size_t size)
+{
+	if (run.failed)
+	{
+		return;
+	}
+	run.buffer.append(static_cast<const char*>(bytes), size);
+	run.offset += size;
+	if (run.buffer.size() >= CONSTANT::ARCHIVE_CHUNK_BYTES && !WriteBuffer(run))
+	{
+		Fail(run, "the archive could not be written: " + LastErrorMessage());
+	}
+}
+/**
+ * @brief Records why the archive can't be finished, if nothing has yet, and stops it.
+ *
+ * Only called by whoever is writing, or before anything is queued.
+ */
+void SaveArchiver::Fail(ArchiveRun& run, const std::string& error)
+{
+	if (run.failed)
+	{
+		return;
+	}
+	run.error = error;
+	run.failed = true;
+}
+/**
+ * @brief Creates the zip, replacing any file that was there.
+ *
+ * The folder is synced as well, so the zip is sure to be there once anything
+ * in it is.
+ *
+ * @return False if it couldn't be created, see LastErrorMessage.
+ */
+bool SaveArchiver::OpenFile(ArchiveRun& run, const std::string& archiveFile)
+{
+	std::filesystem::path path = std::filesystem::u8path(archiveFile);
+#ifdef _WIN32
+	if (_wsopen_s(&run.file, path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY | _O_NOINHERIT, _SH_DENYWR, _S_IREAD | _S_IWRITE) != 0)
+	{
+		run.file = -1;
+		return false;
+	}
+#else
+	run.file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (run.file < 0)
+	{
+		return false;
+	}
+	std::filesystem::path folder = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+	int folderFile = open(folder.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (folderFile >= 0)
+	{
+		// not every file system can sync a folder, the zip's own syncs still count then.
+		fsync(folderFile);
+		close(folderFile);
+	}
+#endif
+	return true;
+}
+/**
+ * @brief Writes out run.buffer and empties it.
+ *
+ * @return False if it couldn't all be written, see LastErrorMessage.
+ */
+bool SaveArchiver::WriteBuffer(ArchiveRun& run)
+{
+	size_t done = 0;
+	while (done < run.buffer.size())
+	{
+#ifdef _WIN32
+		int written = _write(run.file, run.buffer.data() + done, static_cast<unsigned int>(std::min<size_t>(run.buffer.size() - done, INT_MAX)));
+#else
+		ssize_t written = write(run.file, run.buffer.data() + done, run.buffer.size() - done);
+		if (written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+#endif
+		if (written < 0)
+		{
+			return false;
+		}
+		done += static_cast<size_t>(written);
+	}
+	run.buffer.clear();
+	return true;
+}
+/**
+ * @brief Waits until everything written to the zip so far is on disk.
+ *
+ * @return False if it couldn't be, see LastErrorMessage.
+ */
+bool SaveArchiver::SyncFile(ArchiveRun& run)
+{
+#ifdef _WIN32
+	return _commit(run.file) == 0;
+#else
+	return fsync(run.file) == 0;
+#endif
+}
+/**
+ * @brief Cuts the zip off at size, where the next write then goes.
+ *
+ * @return False if it couldn't be, see LastErrorMessage.
+ */
+bool SaveArchiver::TruncateFile(ArchiveRun& run, uint64_t size)
+{
+#ifdef _WIN32
+	errno_t error = _chsize_s(run.file, static_cast<__int64>(size));
+	if (error != 0)
+	{
+		errno = error;
+		return false;
+	}
+	return _lseeki64(run.file, static_cast<__int64>(size), SEEK_SET) >= 0;
+#else
+	return ftruncate(run.file, static_cast<off_t>(size)) == 0 && lseek(run.file, static_cast<off_t>(size), SEEK_SET) >= 0;
+#endif
+}
+/**
+ * @brief Closes the zip.
+ *
+ * @return False if the last of it couldn't be written, see LastErrorMessage.
+ */
+bool SaveArchiver::CloseFile(ArchiveRun& run)
+{
+#ifdef _WIN32
+	bool closed = _close(run.file) == 0;
+#else
+	bool closed = close(run.file) == 0;
+#endif
+	run.file = -1;
+	return closed;
+}
+/**
+ * @brief Describes why the last file call failed.
+ */
+std::string SaveArchiver::LastErrorMessage()
+{
+	return std::error_code(errno, std::generic_category()).message();
+}
+/**
+ * @brief Converts a file time to the local date and time zip headers hold.
+ *
+ * DOS times go from 1980 to 2107 in steps of two seconds, anything outside that is clamped.
+ */
+void SaveArchiver::ToDosTime(std::filesystem::file_time_type time, uint16_t& dosTime, uint16_t& dosDate)
+{
+	// what last_write_time gives back when it fails
+	if (time == std::filesystem::file_time_type::min())
+	{
+		dosTime = 0;
+		dosDate = (1 << 5) | 1;
+		return;
+	}
+	std::chrono::system_clock::time_point systemTime = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+		time - std::filesystem::file_time_type::clock::now() + std::chrono::system_clock::now());
+	std::time_t seconds = std::chrono::system_clock::to_time_t(systemTime);
+	std::tm local{};
+#ifdef _WIN32
+	bool converted = localtime_s(&local, &seconds) == 0;
+#else
+	bool converted = localtime_r(&seconds, &local) != nullptr;
+#endif
+	int year = converted ? local.tm_year + 1900 : 1980;
+	if (year < 1980)
+	{
+		dosTime = 0;
+		dosDate = (1 << 5) | 1;
+		return;
+	}
+	year = std::min(year, 2107);
+	dosTime = static_cast<uint16_t>((local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2));
+	dosDate = static_cast<uint16_t>(((year - 1980) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday);
+}
+/**
+ * @brief Checks whether the observer asked for the archive to stop.
+ */
+bool SaveArchiver::IsCancelled(const ArchiveObserver& observer)
+{
+	return observer.cancelled != nullptr && observer.cancelled->load();
+}
@@ -0,0 +1,181 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Constants.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+
+// What went into an archive.
+struct ArchiveSummary
+{
+	size_t itemsArchived = 0;
+	uint64_t filesArchived = 0;
+	uint64_t foldersArchived = 0;
+	// file contents read, and the size of the zip they made
+	uint64_t bytesRead = 0;
+	uint64_t bytesWritten = 0;
+	// wall time, from opening the archive to closing it
+	int64_t milliseconds = 0;
+	// why the archive itself couldn't be written, empty if it could
+	std::string error;
+	// the zip ends with a central directory, so it opens, even if error is set
+	bool readable = false;
+	bool cancelled = false;
+};
+
+// Optional hooks into a running archive. Called from the worker threads, one
+// at a time and in the order the save folders were given.
+struct ArchiveObserver
+{
+	// everything in a save folder is written to the archive and on disk, it can go
+	std::function<void(size_t item)> onItemArchived;
+	// a save folder couldn't be read completely, what could is still in the archive
+	std::function<void(size_t item, const std::string& error)> onItemFailed;
+	// set to true from any thread to stop early, the archive is still finished off
+	const std::atomic<bool>* cancelled = nullptr;
+	// gets a span per chunk compressed and per save folder start to finish, optional
+	TraceRecorder* trace = nullptr;
+};
+
+// Writes save folders into one zip file, compressing on a thread pool.
+//
+// Files are cut into ARCHIVE_CHUNK_BYTES chunks and every chunk is deflated on
+// its own as a pool task, so a few big files are spread over the pool as much
+// as many small ones are. A chunk that isn't the last of its file ends with a
+// sync flush, which leaves the deflate stream byte aligned, so the chunks of a
+// file are simply written one after the other. Their CRCs are joined with
+// crc32_combine. Whichever task finishes the chunk at the front of the queue
+// writes out everything that is ready behind it, so the zip is written in order
+// without a writer thread. At most ARCHIVE_CHUNKS_IN_FLIGHT chunks are read and
+// not yet written, which bounds the memory used however big the saves are.
+//
+// A save folder is handed to onItemArchived once its last file is written and
+// synced to disk, while the ones after it are still being compressed, so
+// whoever deletes it works alongside the archiving. If the archive can't be
+// written part way, it is cut back to the end of the last save folder that went
+// in completely and still given its central directory, so every save folder
+// that was handed on can be read back from it.
+//
+// Files that fit in one chunk get their sizes and CRC in the local header, and
+// are stored as they are if deflate doesn't make them smaller. Bigger files get
+// a data descriptor after their data, and zip64 fields when they need them.
+class SaveArchiver
+{
+public:
+	ArchiveSummary ArchiveAll(const std::vector<std::string>& paths, const std::string& archiveFile, ThreadPool& pool,
+		const ArchiveObserver& observer = ArchiveObserver());
+	void SetCompressionLevel(int level);
+
+private:
+	// a file or folder in the archive, kept for the central directory.
+	struct Entry
+	{
+		// inside the archive, '/' separated, folders end with one
+		std::string name;
+		// cleared once its data is written
+		std::filesystem::path path;
+		// when it was listed
+		uint64_t size = 0;
+		size_t chunkCount = 1;
+		uint16_t dosTime = 0;
+		uint16_t dosDate = 0;
+		bool folder = false;
+		// filled in as it is written
+		uint64_t offset = 0;
+		uint32_t crc = 0;
+		uint64_t compressedSize = 0;
+		uint64_t uncompressedSize = 0;
+		uint16_t method = 0;
+		// data descriptor after the data, with 64 bit sizes if zip64
+		bool descriptor = false;
+		bool zip64 = false;
+	};
+
+	// one step of the archive: a folder, a chunk of a file, or the end of a save folder.
+	struct Record
+	{
+		size_t item = 0;
+		// null for the end of a save folder
+		std::shared_ptr<Entry> entry;
+		size_t chunk = 0;
+		// what gets written, deflated or stored
+		std::vector<unsigned char> data;
+		uint64_t rawBytes = 0;
+		uint32_t crc = 0;
+		bool stored = false;
+		// couldn't be read, or changed while it was
+		std::string error;
+		// the end of a save folder: when its first record was queued
+		std::chrono::steady_clock::time_point startTime;
+		bool ready = false;
+	};
+
+	// state shared by every task of one ArchiveAll call.
+	struct ArchiveRun
+	{
+		ArchiveRun(ThreadPool& pool, const ArchiveObserver& observer, int compressionLevel)
+			: pool(pool), observer(observer), compressionLevel(compressionLevel)
+		{
+		}
+
+		ThreadPool& pool;
+		const ArchiveObserver& observer;
+		int compressionLevel;
+		// the zip's file descriptor
+		int file = -1;
+
+		std::mutex recordMutex;
+		// oldest first, written from the front as soon as it is ready
+		std::deque<std::unique_ptr<Record>> records;
+		std::condition_variable recordsChanged;
+		// a task is writing out ready records
+		bool writing = false;
+
+		// only touched by whoever is writing
+		uint64_t offset = 0;
+		// the end of offset, not yet written to the file
+		std::string buffer;
+		std::vector<std::shared_ptr<Entry>> written;
+		// the end of the last save folder synced to disk, and how many of written it leaves
+		uint64_t committedOffset = 0;
+		size_t committedEntries = 0;
+		// first read error of the save folder being written
+		std::string itemError;
+		size_t itemsArchived = 0;
+
+		// set by whoever is writing, before failed, and added to by Finish
+		std::string error;
+		std::atomic<bool> failed{ false };
+	};
+
+	void AddItem(ArchiveRun& run, size_t item, const std::filesystem::path& root, const std::string& name);
+	void Queue(ArchiveRun& run, std::unique_ptr<Record> record);
+	static void Compress(ArchiveRun& run, Record& record);
+	void WriteReady(ArchiveRun& run, Record* finished);
+	void WriteRecord(ArchiveRun& run, Record& record);
+	void WriteLocalHeader(ArchiveRun& run, const Entry& entry);
+	bool Finish(ArchiveRun& run, const std::string& archiveFile);
+	std::string MakeCentralDirectory(const ArchiveRun& run);
+	void Write(ArchiveRun& run, const void* bytes, size_t size);
+	static void Fail(ArchiveRun& run, const std::string& error);
+	static bool OpenFile(ArchiveRun& run, const std::string& archiveFile);
+	static bool WriteBuffer(ArchiveRun& run);
+	static bool SyncFile(ArchiveRun& run);
+	static bool TruncateFile(ArchiveRun& run, uint64_t size);
+	static bool CloseFile(ArchiveRun& run);
+	static std::string LastErrorMessage();
+	static void ToDosTime(std::filesystem::file_time_type time, uint16_t& dosTime, uint16_t& dosDate);
+	static bool IsCancelled(const ArchiveObserver& observer);
+
+	int compressionLevel = CONSTANT::ARCHIVE_COMPRESSION_LEVEL;
+};
@@ -0,0 +1,280 @@
+#include "SaveIndex.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+
+/**
+ * @brief Empties the index, ready for a new scan.
+ *
+ * The arena and tables keep their capacity, so filling the index again with a
+ * scan of the same size allocates nothing. Measured sizes are kept, the next
+ * scan's entries pick up those that are still current.
+ */
+void SaveIndex::Clear()
+{
+	arena.clear();
+	entries.clear();
+	companies.clear();
+	for (std::vector<size_t>& classRows : rows)
+	{
+		classRows.clear();
+	}
+	garbageBytes = 0;
+}
+
+/**
+ * @brief Stores a company folder that has at least one Unity save in it.
+ *
+ * @param companyPath Full path to the company folder in LocalLow.
+ */
+void SaveIndex::AddCompany(const std::string& companyPath)
+{
+	companies.push_back(Intern(companyPath));
+}
+
+/**
+ * @brief Stores a classified save folder.
+ *
+ * @param entry The save folder, its marker files and classification.
+ */
+void SaveIndex::AddEntry(const SaveEntry& entry)
+{
+	PushEntry(entry, InternCompany(entry.companyPath));
+	rows[static_cast<int>(entry.classification)].push_back(entries.size() - 1);
+}
+
+/**
+ * @brief Replaces every entry of one company folder.
+ *
+ * The new entries go where the old ones were, so the rest of the index keeps its
+ * order. A company that wasn't in the index yet goes at the end, one that has no
+ * entries left is dropped. The company's sizes are dropped too, something in it
+ * changed and the folder mtimes don't see changes further down.
+ *
+ * @param companyPath Full path to the company folder in LocalLow.
+ * @param companyEntries The company's save folders now, may be empty.
+ */
+void SaveIndex::ReplaceCompany(const std::string& companyPath, const std::vector<SaveEntry>& companyEntries)
+{
+	auto sameCompany = [this, &companyPath](const Entry& entry) { return View(entry.companyPath) == companyPath; };
+	auto firstEntry = std::find_if(entries.begin(), entries.end(), sameCompany);
+	size_t position = static_cast<size_t>(firstEntry - entries.begin());
+	auto removed = std::remove_if(firstEntry, entries.end(), sameCompany);
+	for (auto entry = removed; entry != entries.end(); ++entry)
+	{
+		garbageBytes += entry->gamePath.length + entry->installPath.length;
+		auto size = sizes.find(View(entry->gamePath));
+		if (size != sizes.end())
+		{
+			sizes.erase(size);
+		}
+	}
+	entries.erase(removed, entries.end());
+
+	auto company = std::find_if(companies.begin(), companies.end(), [this, &companyPath](Span span) { return View(span) == companyPath; });
+	Span companySpan;
+	if (companyEntries.empty() && company != companies.end())
+	{
+		garbageBytes += company->length;
+		companies.erase(company);
+	}
+	else if (!companyEntries.empty() && company == companies.end())
+	{
+		companySpan = Intern(companyPath);
+		companies.push_back(companySpan);
+	}
+	else if (company != companies.end())
+	{
+		companySpan = *company;
+	}
+
+	// built at the end, then rotated into place.
+	size_t oldCount = entries.size();
+	for (const SaveEntry& entry : companyEntries)
+	{
+		PushEntry(entry, companySpan);
+	}
+	std::rotate(entries.begin() + position, entries.begin() + oldCount, entries.end());
+
+	if (garbageBytes > arena.size() / 2)
+	{
+		Compact();
+	}
+	RebuildRows();
+}
+
+/**
+ * @brief Gets an entry's game name, the last part of its game folder.
+ */
+std::string_view SaveIndex::GetGameName(size_t entry) const
+{
+	return GetGamePath(entry).substr(entries[entry].nameStart);
+}
+
+/**
+ * @brief Copies an entry out of the index, for handing to code that keeps it.
+ */
+SaveEntry SaveIndex::GetEntry(size_t entry) const
+{
+	SaveEntry copy;
+	copy.companyPath = GetCompanyPath(entry);
+	copy.gamePath = GetGamePath(entry);
+	copy.installPath = GetInstallPath(entry);
+	copy.hasPlayerLog = entries[entry].hasPlayerLog;
+	copy.hasOutputLog = entries[entry].hasOutputLog;
+	copy.classification = entries[entry].classification;
+	copy.mtime = entries[entry].mtime;
+	return copy;
+}
+
+/**
+ * @brief Stores how big a save folder is.
+ *
+ * @param gamePath The save folder, it doesn't have to be in the index (yet).
+ * @param size What it measured, and its mtime at the time.
+ */
+void SaveIndex::SetSize(std::string_view gamePath, const FolderSize& size)
+{
+	auto stored = sizes.find(gamePath);
+	if (stored == sizes.end())
+	{
+		sizes.emplace(std::string(gamePath), size);
+	}
+	else
+	{
+		stored->second = size;
+	}
+}
+
+/**
+ * @brief Gets an entry's size, if it was measured since the folder last changed.
+ *
+ * @return The size, or nullptr if it has to be measured (again).
+ */
+const FolderSize* SaveIndex::GetSize(size_t entry) const
+{
+	auto size = sizes.find(GetGamePath(entry));
+	if (size == sizes.end() || size->second.mtime != entries[entry].mtime)
+	{
+		return nullptr;
+	}
+	return &size->second;
+}
+
+/**
+ * @brief Forgets the sizes of save folders that are no longer in the index.
+ */
+void SaveIndex::PruneSizes()
+{
+	std::map<std::string, FolderSize, std::less<>> kept;
+	for (size_t entry = 0; entry < entries.size(); ++entry)
+	{
+		auto size = sizes.find(GetGamePath(entry));
+		if (size != sizes.end())
+		{
+			kept.insert(sizes.extract(size));
+		}
+	}
+	sizes.swap(kept);
+}
+
+/**
+ * @brief Appends a string to the arena.
+ */
+SaveIndex::Span SaveIndex::Intern(std::string_view text)
+{
+	Span span;
+	span.offset = static_cast<uint32_t>(arena.size());
+	span.length = static_cast<uint32_t>(text.size());
+	arena.append(text.data(), text.size());
+	return span;
+}
+
+/**
+ * @brief Gets the arena copy of an entry's company path.
+ *
+ * Entries come right after their company, so it's the last company added. One
+ * that was never added gets a copy of its own.
+ */
+SaveIndex::Span SaveIndex::InternCompany(std::string_view companyPath)
+{
+	if (!companies.empty() && View(companies.back()) == companyPath)
+	{
+		return companies.back();
+	}
+	return Intern(companyPath);
+}
+
+/**
+ * @brief Appends an entry, its company path already in the arena.
+ */
+void SaveIndex::PushEntry(const SaveEntry& entry, Span company)
+{
+	Entry stored;
+	stored.companyPath = company;
+	stored.gamePath = Intern(entry.gamePath);
+	stored.installPath = Intern(entry.installPath);
+	stored.nameStart = static_cast<uint32_t>(entry.gamePath.find_last_of("\\/") + 1);
+	stored.hasPlayerLog = entry.hasPlayerLog;
+	stored.hasOutputLog = entry.hasOutputLog;
+	stored.classification = entry.classification;
+	stored.mtime = entry.mtime;
+	entries.push_back(stored);
+}
+
+/**
+ * @brief Lists the entries of each class again, after entries moved.
+ */
+void SaveIndex::RebuildRows()
+{
+	for (std::vector<size_t>& classRows : rows)
+	{
+		classRows.clear();
+	}
+	for (size_t entry = 0; entry < entries.size(); ++entry)
+	{
+		rows[static_cast<int>(entries[entry].classification)].push_back(entry);
+	}
+}
+
+/**
+ * @brief Copies the strings still in use into a new arena, dropping the rest.
+ */
+void SaveIndex::Compact()
+{
+	std::string compacted;
+	compacted.reserve(arena.size() - garbageBytes);
+	auto copy = [this, &compacted](Span span)
+		{
+			Span moved;
+			moved.offset = static_cast<uint32_t>(compacted.size());
+			moved.length = span.length;
+			compacted.append(arena.data() + span.offset, span.length);
+			return moved;
+		};
+
+	// companies are shared by their entries, they must only be copied once.
+	std::unordered_map<uint32_t, Span> movedCompanies;
+	for (Span& company : companies)
+	{
+		Span moved = copy(company);
+		movedCompanies[company.offset] = moved;
+		company = moved;
+	}
+	for (Entry& entry : entries)
+	{
+		auto company = movedCompanies.find(entry.companyPath.offset);
+		if (company == movedCompanies.end())
+		{
+			company = movedCompanies.emplace(entry.companyPath.offset, copy(entry.companyPath)).first;
+		}
+		entry.companyPath = company->second;
+		entry.gamePath = copy(entry.gamePath);
+		entry.installPath = copy(entry.installPath);
+	}
+
+	arena.swap(compacted);
+	garbageBytes = 0;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What the scanner decided about a save folder.
+enum class SaveClass
+{
+	Installed,	// Player.log (or a launcher's install, see InstallIndex) points at a game that exists
+	Unlinked,	// Player.log points at a game that is gone
+	Unknown		// output_log.txt only (or an unreadable Player.log) and no launcher has the game, no way of telling where it is
+};
+
+// One Unity save folder found in LocalLow.
+struct SaveEntry
+{
+	std::string companyPath;
+	std::string gamePath;
+	bool hasPlayerLog = false;
+	bool hasOutputLog = false;
+	// game path from the Player.log header, empty if there is none
+	std::string installPath;
+	SaveClass classification = SaveClass::Unknown;
+	// the save folder's mtime when it was scanned
+	int64_t mtime = 0;
+};
+
+// How much disk a save folder takes up.
+struct FolderSize
+{
+	uint64_t bytes = 0;
+	uint64_t files = 0;
+	// the save folder's mtime when it was measured
+	int64_t mtime = 0;
+};
+
+// Every save found, in scan order.
+//
+// Paths are stored once, back to back in one UTF-8 arena, and entries are
+// offsets into it, so adding a save allocates nothing until the arena or the
+// entry table has to grow. Each entry shares its company's path. Every
+// accessor hands out views or references, nothing is copied on the way out.
+// Views stay valid until the index next changes.
+//
+// Replacing a company leaves its old paths behind in the arena, which is
+// compacted once they take up more than half of it.
+//
+// Folder sizes are kept apart from the entries by save folder path, so they
+// outlive Clear and a rescan only has to measure what changed. A size only
+// counts while the entry's mtime is the one it was measured at. Replacing a
+// company drops its sizes, the watcher only replaces companies that changed.
+class SaveIndex
+{
+public:
+	void Clear();
+	void AddCompany(const std::string& companyPath);
+	void AddEntry(const SaveEntry& entry);
+	void ReplaceCompany(const std::string& companyPath, const std::vector<SaveEntry>& companyEntries);
+
+	size_t GetCount() const { return entries.size(); }
+	std::string_view GetGamePath(size_t entry) const { return View(entries[entry].gamePath); }
+	std::string_view GetCompanyPath(size_t entry) const { return View(entries[entry].companyPath); }
+	std::string_view GetGameName(size_t entry) const;
+	std::string_view GetInstallPath(size_t entry) const { return View(entries[entry].installPath); }
+	SaveClass GetClass(size_t entry) const { return entries[entry].classification; }
+	SaveEntry GetEntry(size_t entry) const;
+
+	// entries of one class, in index order
+	const std::vector<size_t>& GetRows(SaveClass classification) const { return rows[static_cast<int>(classification)]; }
+
+	size_t GetCompanyCount() const { return companies.size(); }
+	std::string_view GetCompany(size_t company) const { return View(companies[company]); }
+
+	size_t GetArenaBytes() const { return arena.size(); }
+
+	void SetSize(std::string_view gamePath, const FolderSize& size);
+	const FolderSize* GetSize(size_t entry) const;
+	void PruneSizes();
+
+private:
+	// a string in the arena
+	struct Span
+	{
+		uint32_t offset = 0;
+		uint32_t length = 0;
+	};
+
+	struct Entry
+	{
+		Span companyPath;
+		Span gamePath;
+		Span installPath;
+		// where the game name starts in gamePath
+		uint32_t nameStart = 0;
+		bool hasPlayerLog = false;
+		bool hasOutputLog = false;
+		SaveClass classification = SaveClass::Unknown;
+		int64_t mtime = 0;
+	};
+
+	std::string_view View(Span span) const { return std::string_view(arena.data() + span.offset, span.length); }
+	Span Intern(std::string_view text);
+	Span InternCompany(std::string_view companyPath);
+	void PushEntry(const SaveEntry& entry, Span company);
+	void RebuildRows();
+	void Compact();
+
+	std::string arena;
+	std::vector<Entry> entries;
+	std::vector<Span> companies;
+	std::vector<size_t> rows[3];
+	// bytes of the arena nothing points at any more
+	size_t garbageBytes = 0;
+	// measured save folders by path, std::less<> finds them by view
+	std::map<std::string, FolderSize, std::less<>> sizes;
+};
@@ -0,0 +1,364 @@
+#include "SaveListCtrl.h"
+#include <wx/filename.h>
+#include "Constants.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <string_view>
+
+
+/**
+ * @brief Creates an empty list, rows come in through AddRowsFrom and Sync.
+ *
+ * @param index The index the rows are read from, must outlive the list.
+ * @param classification Which saves in the index are listed.
+ */
+SaveListCtrl::SaveListCtrl(wxWindow* parent, const wxPoint& pos, const wxSize& size, const SaveIndex& index, SaveClass classification)
+	: wxListCtrl(parent, wxID_ANY, pos, size, wxLC_REPORT | wxLC_VIRTUAL),
+	index(index),
+	classification(classification)
+{
+	EnableCheckBoxes();
+	AppendColumn("Game", wxLIST_FORMAT_LEFT, GetClientSize().GetWidth() - CONSTANT::LIST_SIZE_COLUMN_WIDTH);
+	AppendColumn("Size", wxLIST_FORMAT_RIGHT, CONSTANT::LIST_SIZE_COLUMN_WIDTH);
+
+	Bind(wxEVT_LIST_ITEM_CHECKED, &SaveListCtrl::OnItemChecked, this);
+	Bind(wxEVT_LIST_ITEM_UNCHECKED, &SaveListCtrl::OnItemUnchecked, this);
+	Bind(wxEVT_LIST_COL_CLICK, &SaveListCtrl::OnColumnClicked, this);
+}
+
+/**
+ * @brief Adds rows for entries appended to the index, unchecked.
+ *
+ * In scan order this costs a row count update, nothing is redrawn that was
+ * already there. Sorted by size the new rows may have sizes from an earlier
+ * scan, so they are sorted in and the list is redrawn.
+ *
+ * @param firstEntry Where the new entries start in the index.
+ * @return How many rows were added.
+ */
+size_t SaveListCtrl::AddRowsFrom(size_t firstEntry)
+{
+	size_t oldCount = rows.size();
+	ReadRows(firstEntry, rows, rowHashes);
+	checked.resize(rows.size(), false);
+
+	if (rows.size() != oldCount)
+	{
+		SetItemCount(static_cast<long>(rows.size()));
+		if (order != SortOrder::Index)
+		{
+			SortRows(rows, rowHashes, checked);
+			Refresh();
+		}
+	}
+	return rows.size() - oldCount;
+}
+
+/**
+ * @brief Catches up with an index that has changed in any way.
+ *
+ * Rows stay checked as long as their save folder is still listed. Only the
+ * rows from the first change to the last are redrawn, or to the end if the
+ * row count changed.
+ */
+void SaveListCtrl::Sync()
+{
+	std::vector<size_t> newRows;
+	std::vector<uint64_t> newHashes;
+	ReadRows(0, newRows, newHashes);
+
+	std::vector<bool> newChecked(newRows.size(), false);
+	std::vector<bool> stillListed(checkedPaths.size(), false);
+	for (size_t row = 0; row < newRows.size() && !checkedPaths.empty(); ++row)
+	{
+		size_t found = FindCheckedPath(index.GetGamePath(newRows[row]));
+		if (found != checkedPaths.size())
+		{
+			newChecked[row] = true;
+			stillListed[found] = true;
+		}
+	}
+	SortRows(newRows, newHashes, newChecked);
+
+	// forget the checked saves that are gone, moving the rest down keeps them sorted.
+	size_t kept = 0;
+	for (size_t path = 0; path < checkedPaths.size(); ++path)
+	{
+		if (!stillListed[path])
+		{
+			continue;
+		}
+		if (kept != path)
+		{
+			checkedPaths[kept] = std::move(checkedPaths[path]);
+		}
+		++kept;
+	}
+	checkedPaths.resize(kept);
+
+	// rows before first and after last are the same saves as before.
+	auto sameRow = [this, &newRows, &newHashes](size_t row)
+		{
+			return rows[row] == newRows[row] && rowHashes[row] == newHashes[row];
+		};
+	size_t sameCount = std::min(rows.size(), newRows.size());
+	size_t first = 0;
+	while (first < sameCount && sameRow(first))
+	{
+		++first;
+	}
+	size_t last = newRows.size();
+	if (rows.size() == newRows.size())
+	{
+		while (last > first && sameRow(last - 1))
+		{
+			--last;
+		}
+	}
+
+	bool countChanged = rows.size() != newRows.size();
+	rows = std::move(newRows);
+	rowHashes = std::move(newHashes);
+	checked = std::move(newChecked);
+
+	if (countChanged)
+	{
+		SetItemCount(static_cast<long>(rows.size()));
+	}
+	if (first < last)
+	{
+		RefreshItems(static_cast<long>(first), static_cast<long>(last - 1));
+	}
+	UpdateTotal();
+}
+
+/**
+ * @brief Shows sizes that were measured since the rows were added.
+ *
+ * Sorted by size, the rows are sorted again. Checks move with their rows.
+ */
+void SaveListCtrl::OnSizesChanged()
+{
+	if (order == SortOrder::Size)
+	{
+		SortRows(rows, rowHashes, checked);
+	}
+	// only the rows on screen are actually redrawn.
+	Refresh();
+	UpdateTotal();
+}
+
+/**
+ * @brief Sets the label that shows what the checked rows add up to.
+ */
+void SaveListCtrl::SetTotalLabel(wxStaticText* label)
+{
+	totalLabel = label;
+	UpdateTotal();
+}
+
+/**
+ * @brief Gets the save folders of the checked rows, top to bottom.
+ */
+std::vector<std::string> SaveListCtrl::GetCheckedPaths() const
+{
+	std::vector<std::string> paths;
+	for (size_t row = 0; row < rows.size(); ++row)
+	{
+		if (checked[row] && rows[row] < index.GetCount())
+		{
+			paths.emplace_back(index.GetGamePath(rows[row]));
+		}
+	}
+	return paths;
+}
+
+/**
+ * @brief Gets a row's game name, the last part of its save folder, or its size.
+ */
+wxString SaveListCtrl::OnGetItemText(long item, long column) const
+{
+	if (item < 0 || static_cast<size_t>(item) >= rows.size() || rows[item] >= index.GetCount())
+	{
+		return wxString();
+	}
+
+	if (column == 1)
+	{
+		const FolderSize* size = index.GetSize(rows[item]);
+		return size != nullptr ? wxFileName::GetHumanReadableSize(wxULongLong(size->bytes)) : wxString("...");
+	}
+
+	// ensure it is encoded properly to UT8 if there are symbols.
+	std::string_view name = index.GetGameName(rows[item]);
+	return wxString::FromUTF8(name.data(), name.size());
+}
+
+bool SaveListCtrl::OnGetItemIsChecked(long item) const
+{
+	return item >= 0 && static_cast<size_t>(item) < checked.size() && checked[item];
+}
+
+void SaveListCtrl::OnItemChecked(wxListEvent& event)
+{
+	SetChecked(event.GetIndex(), true);
+}
+
+void SaveListCtrl::OnItemUnchecked(wxListEvent& event)
+{
+	SetChecked(event.GetIndex(), false);
+}
+
+/**
+ * @brief Sorts by the clicked column: Game is scan order, Size is biggest first.
+ */
+void SaveListCtrl::OnColumnClicked(wxListEvent& event)
+{
+	SortOrder clicked = event.GetColumn() == 1 ? SortOrder::Size : SortOrder::Index;
+	if (clicked == order)
+	{
+		return;
+	}
+
+	order = clicked;
+	SortRows(rows, rowHashes, checked);
+	Refresh();
+}
+
+/**
+ * @brief Stores a row's check state, a virtual list only shows what it is told.
+ *
+ * A checked row's save folder is copied too, the row's index position may not
+ * point at it once the index changes.
+ */
+void SaveListCtrl::SetChecked(long item, bool isChecked)
+{
+	if (item < 0 || static_cast<size_t>(item) >= checked.size() || checked[item] == isChecked || rows[item] >= index.GetCount())
+	{
+		return;
+	}
+
+	std::string_view path = index.GetGamePath(rows[item]);
+	auto position = std::lower_bound(checkedPaths.begin(), checkedPaths.end(), path);
+	if (isChecked)
+	{
+		checkedPaths.emplace(position, path);
+	}
+	else if (position != checkedPaths.end() && *position == path)
+	{
+		checkedPaths.erase(position);
+	}
+	checked[item] = isChecked;
+	RefreshItem(item);
+	UpdateTotal();
+}
+
+/**
+ * @brief Appends the rows for index entries of this list's kind, from firstEntry on.
+ */
+void SaveListCtrl::ReadRows(size_t firstEntry, std::vector<size_t>& newRows, std::vector<uint64_t>& newHashes) const
+{
+	const std::vector<size_t>& classRows = index.GetRows(classification);
+	std::hash<std::string_view> hashPath;
+	for (auto entry = std::lower_bound(classRows.begin(), classRows.end(), firstEntry); entry != classRows.end(); ++entry)
+	{
+		newRows.push_back(*entry);
+		newHashes.push_back(hashPath(index.GetGamePath(*entry)));
+	}
+}
+
+/**
+ * @brief Puts rows in the list's sort order, their hashes and checks move with them.
+ */
+void SaveListCtrl::SortRows(std::vector<size_t>& sortRows, std::vector<uint64_t>& sortHashes, std::vector<bool>& sortChecked) const
+{
+	std::vector<size_t> permutation(sortRows.size());
+	std::iota(permutation.begin(), permutation.end(), 0);
+	if (order == SortOrder::Size)
+	{
+		std::stable_sort(permutation.begin(), permutation.end(), [this, &sortRows](size_t a, size_t b)
+			{
+				const FolderSize* sizeA = index.GetSize(sortRows[a]);
+				const FolderSize* sizeB = index.GetSize(sortRows[b]);
+				if (sizeA == nullptr || sizeB == nullptr)
+				{
+					return sizeA != nullptr && sizeB == nullptr;
+				}
+				return sizeA->bytes > sizeB->bytes;
+			});
+	}
+	else
+	{
+		std::sort(permutation.begin(), permutation.end(), [&sortRows](size_t a, size_t b) { return sortRows[a] < sortRows[b]; });
+	}
+
+	std::vector<size_t> sortedRows(sortRows.size());
+	std::vector<uint64_t> sortedHashes(sortHashes.size());
+	std::vector<bool> sortedChecked(sortChecked.size());
+	for (size_t row = 0; row < permutation.size(); ++row)
+	{
+		sortedRows[row] = sortRows[permutation[row]];
+		sortedHashes[row] = sortHashes[permutation[row]];
+		sortedChecked[row] = sortChecked[permutation[row]];
+	}
+	sortRows.swap(sortedRows);
+	sortHashes.swap(sortedHashes);
+	sortChecked.swap(sortedChecked);
+}
+
+/**
+ * @brief Finds a save folder among the checked ones.
+ *
+ * @return Its position in checkedPaths, or the size of checkedPaths if it isn't checked.
+ */
+size_t SaveListCtrl::FindCheckedPath(std::string_view path) const
+{
+	auto position = std::lower_bound(checkedPaths.begin(), checkedPaths.end(), path);
+	if (position == checkedPaths.end() || *position != path)
+	{
+		return checkedPaths.size();
+	}
+	return static_cast<size_t>(position - checkedPaths.begin());
+}
+
+/**
+ * @brief Shows how many rows are checked and how much deleting them frees up.
+ */
+void SaveListCtrl::UpdateTotal()
+{
+	if (totalLabel == nullptr)
+	{
+		return;
+	}
+
+	size_t checkedCount = 0;
+	size_t unmeasured = 0;
+	uint64_t bytes = 0;
+	for (size_t row = 0; row < rows.size(); ++row)
+	{
+		if (!checked[row] || rows[row] >= index.GetCount())
+		{
+			continue;
+		}
+		++checkedCount;
+		const FolderSize* size = index.GetSize(rows[row]);
+		if (size != nullptr)
+		{
+			bytes += size->bytes;
+		}
+		else
+		{
+			++unmeasured;
+		}
+	}
+
+	wxString text = wxString::Format("%llu checked, ", static_cast<unsigned long long>(checkedCount))
+		+ wxFileName::GetHumanReadableSize(wxULongLong(bytes));
+	if (unmeasured > 0)
+	{
+		text += wxString::Format(" (%llu not measured yet)", static_cast<unsigned long long>(unmeasured));
+	}
+	totalLabel->SetLabel(text);
+}
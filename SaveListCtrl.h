@@ -0,0 +1,65 @@
+#pragma once
+#include <wx/wx.h>
+#include <wx/listctrl.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SaveIndex.h"
+
+// A checkable list of one kind of save, drawn straight from the save index.
+//
+// The control is virtual: it holds the index position of each row and a hash
+// of its save folder, and names are made when a row is painted. Check state is
+// a bitset by row, and only the checked rows' save folders are copied, so Sync
+// can keep them checked once the index has changed under them. Sync works out
+// which rows differ from before by position and hash, and only those are
+// redrawn. Rows added at the end of the index are just a new row count.
+//
+// Clicking the Size header sorts the biggest saves to the top, clicking Game
+// goes back to scan order. Sizes come in after the rows, through
+// OnSizesChanged, and the total under the list follows the checked rows.
+class SaveListCtrl : public wxListCtrl
+{
+public:
+	SaveListCtrl(wxWindow* parent, const wxPoint& pos, const wxSize& size, const SaveIndex& index, SaveClass classification);
+
+	size_t AddRowsFrom(size_t firstEntry);
+	void Sync();
+	void OnSizesChanged();
+	void SetTotalLabel(wxStaticText* label);
+	std::vector<std::string> GetCheckedPaths() const;
+
+protected:
+	wxString OnGetItemText(long item, long column) const override;
+	bool OnGetItemIsChecked(long item) const override;
+
+private:
+	enum class SortOrder
+	{
+		Index,	// scan order
+		Size	// biggest first, not yet measured last
+	};
+
+	void OnItemChecked(wxListEvent& event);
+	void OnItemUnchecked(wxListEvent& event);
+	void OnColumnClicked(wxListEvent& event);
+	void SetChecked(long item, bool isChecked);
+	void ReadRows(size_t firstEntry, std::vector<size_t>& newRows, std::vector<uint64_t>& newHashes) const;
+	void SortRows(std::vector<size_t>& sortRows, std::vector<uint64_t>& sortHashes, std::vector<bool>& sortChecked) const;
+	size_t FindCheckedPath(std::string_view path) const;
+	void UpdateTotal();
+
+	const SaveIndex& index;
+	SaveClass classification;
+	SortOrder order = SortOrder::Index;
+	// index position of each row's entry
+	std::vector<size_t> rows;
+	// hash of each row's save folder, tells Sync which rows changed
+	std::vector<uint64_t> rowHashes;
+	std::vector<bool> checked;
+	// save folders of the checked rows, sorted, tells Sync which rows to keep checked
+	std::vector<std::string> checkedPaths;
+	// shows what the checked rows add up to, optional
+	wxStaticText* totalLabel = nullptr;
+};
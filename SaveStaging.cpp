@@ -0,0 +1,362 @@
+#include "SaveStaging.h"
+#include "Constants.h"
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+
+
+/**
+ * @brief Sets up staging in the given folder, nothing happens until Start.
+ *
+ * @param stagingFolder UTF-8 path, best on the same drive as LocalLow so moves are renames.
+ */
+SaveStaging::SaveStaging(const std::string& stagingFolder) : stagingFolder(std::filesystem::u8path(stagingFolder))
+{
+}
+
+/**
+ * @brief Stops the purger. Batches it hadn't got to are purged on the next start.
+ */
+SaveStaging::~SaveStaging()
+{
+	Stop();
+}
+
+/**
+ * @brief Picks up batches left by an earlier run and starts the purger thread.
+ *
+ * @param onPurged Called once per purged batch, e.g. to clear the saves' PlayerPrefs together.
+ */
+void SaveStaging::Start(PurgedCallback onPurged)
+{
+	this->onPurged = std::move(onPurged);
+	stopping = false;
+	FindLeftovers();
+	purgeThread = std::thread(&SaveStaging::PurgeLoop, this);
+}
+
+/**
+ * @brief Stops the purger, cancelling the batch it is in the middle of.
+ */
+void SaveStaging::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		stopping = true;
+	}
+	batchesChanged.notify_all();
+
+	if (purgeThread.joinable())
+	{
+		purgeThread.join();
+	}
+}
+
+/**
+ * @brief Moves save folders into a new batch in the staging folder.
+ *
+ * The ".origin" file is written before the move, so a crash in between never
+ * leaves a staged folder nobody knows the origin of.
+ *
+ * @param paths Save folders in UTF-8.
+ * @return Which were moved and which weren't.
+ */
+StageResult SaveStaging::StageAll(const std::vector<std::string>& paths)
+{
+	StageResult result;
+	std::filesystem::path batchFolder = MakeBatchFolder();
+	if (batchFolder.empty())
+	{
+		result.unstaged = paths;
+		return result;
+	}
+
+	for (size_t i = 0; i < paths.size(); ++i)
+	{
+		std::filesystem::path stagedPath = batchFolder / std::to_string(i);
+		std::filesystem::path originFile = GetOriginFile(stagedPath);
+		std::error_code error;
+		{
+			std::ofstream origin(originFile, std::ios::binary | std::ios::trunc);
+			origin << paths[i];
+		}
+
+		std::filesystem::rename(std::filesystem::u8path(paths[i]), stagedPath, error);
+		if (error)
+		{
+			std::filesystem::remove(originFile, error);
+			result.unstaged.push_back(paths[i]);
+			continue;
+		}
+		result.staged.push_back({ paths[i], stagedPath.u8string() });
+	}
+
+	if (result.staged.empty())
+	{
+		std::error_code error;
+		std::filesystem::remove(batchFolder, error);
+		return result;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		Batch batch;
+		batch.folder = batchFolder;
+		batch.saves = result.staged;
+		batch.stagedTime = std::chrono::steady_clock::now();
+		batches.push_back(std::move(batch));
+	}
+	batchesChanged.notify_all();
+	return result;
+}
+
+/**
+ * @brief Checks whether there is a batch the purger hasn't started on yet.
+ */
+bool SaveStaging::CanUndo()
+{
+	std::lock_guard<std::mutex> lock(batchMutex);
+	return !batches.empty() && !batches.back().leftover;
+}
+
+/**
+ * @brief Moves the newest batch back where it came from.
+ *
+ * A save whose original place has been taken in the meantime stays staged, in
+ * a batch of its own that can be undone again once the way is clear.
+ *
+ * @param errors Gets the saves that couldn't be put back.
+ * @return Save folders put back, in UTF-8.
+ */
+std::vector<std::string> SaveStaging::UndoLastBatch(std::vector<DeletionError>& errors)
+{
+	Batch batch;
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		if (batches.empty() || batches.back().leftover)
+		{
+			return std::vector<std::string>();
+		}
+		batch = std::move(batches.back());
+		batches.pop_back();
+	}
+
+	std::vector<std::string> restored;
+	std::vector<StagedSave> failed;
+	for (const StagedSave& save : batch.saves)
+	{
+		std::filesystem::path originalPath = std::filesystem::u8path(save.originalPath);
+		std::filesystem::path stagedPath = std::filesystem::u8path(save.stagedPath);
+		std::error_code error;
+
+		// the company folder goes once it's empty, it may have to come back.
+		std::filesystem::create_directories(originalPath.parent_path(), error);
+		if (std::filesystem::exists(originalPath, error))
+		{
+			errors.push_back({ save.originalPath, "a folder with the same name is already there" });
+			failed.push_back(save);
+			continue;
+		}
+
+		std::filesystem::rename(stagedPath, originalPath, error);
+		if (error)
+		{
+			errors.push_back({ save.originalPath, error.message() });
+			failed.push_back(save);
+			continue;
+		}
+		std::filesystem::remove(GetOriginFile(stagedPath), error);
+		restored.push_back(save.originalPath);
+	}
+
+	if (failed.empty())
+	{
+		std::error_code error;
+		std::filesystem::remove(batch.folder, error);
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		batch.saves = std::move(failed);
+		batch.stagedTime = std::chrono::steady_clock::now();
+		batches.push_back(std::move(batch));
+	}
+	batchesChanged.notify_all();
+	return restored;
+}
+
+/**
+ * @brief Queues every batch folder already in the staging folder for purging.
+ *
+ * Staged folders without a ".origin" file are purged too, just without the
+ * callback. Batch folders with nothing left in them are removed.
+ */
+void SaveStaging::FindLeftovers()
+{
+	std::error_code error;
+	std::deque<Batch> leftovers;
+	for (std::filesystem::directory_iterator it(stagingFolder, error), end; !error && it != end; it.increment(error))
+	{
+		std::error_code entryError;
+		if (!it->is_directory(entryError))
+		{
+			continue;
+		}
+
+		Batch batch;
+		batch.folder = it->path();
+		batch.leftover = true;
+		for (std::filesystem::directory_iterator save(batch.folder, entryError), saveEnd; !entryError && save != saveEnd; save.increment(entryError))
+		{
+			std::error_code saveError;
+			if (save->path().extension() == ".origin")
+			{
+				// origin of a save that was already purged or put back.
+				std::filesystem::path stagedPath = save->path();
+				stagedPath.replace_extension();
+				if (!std::filesystem::exists(stagedPath, saveError))
+				{
+					std::filesystem::remove(save->path(), saveError);
+				}
+				continue;
+			}
+
+			StagedSave staged;
+			staged.stagedPath = save->path().u8string();
+			std::ifstream origin(GetOriginFile(save->path()), std::ios::binary);
+			staged.originalPath.assign(std::istreambuf_iterator<char>(origin), std::istreambuf_iterator<char>());
+			batch.saves.push_back(std::move(staged));
+		}
+
+		if (batch.saves.empty())
+		{
+			std::filesystem::remove(batch.folder, entryError);
+			continue;
+		}
+		leftovers.push_back(std::move(batch));
+	}
+
+	std::lock_guard<std::mutex> lock(batchMutex);
+	batches.insert(batches.begin(), std::make_move_iterator(leftovers.begin()), std::make_move_iterator(leftovers.end()));
+}
+
+/**
+ * @brief Purges batches once their undo window is over, until Stop.
+ *
+ * Runs on its own thread. A batch stops being undoable as soon as it is taken
+ * off the queue here.
+ */
+void SaveStaging::PurgeLoop()
+{
+	std::unique_lock<std::mutex> lock(batchMutex);
+	while (!stopping)
+	{
+		if (batches.empty())
+		{
+			batchesChanged.wait(lock);
+			continue;
+		}
+
+		std::chrono::steady_clock::time_point due = batches.front().stagedTime + std::chrono::milliseconds(CONSTANT::UNDO_WINDOW_MS);
+		if (!batches.front().leftover && std::chrono::steady_clock::now() < due)
+		{
+			batchesChanged.wait_until(lock, due);
+			continue;
+		}
+
+		Batch batch = std::move(batches.front());
+		batches.pop_front();
+		lock.unlock();
+		PurgeBatch(batch);
+		lock.lock();
+	}
+}
+
+/**
+ * @brief Deletes one batch for good, at low priority.
+ *
+ * The callback runs once at the end, with the saves that are completely gone.
+ * Anything that couldn't be deleted keeps its ".origin" file and is tried again
+ * next start.
+ *
+ * @param batch The batch, already off the queue.
+ */
+void SaveStaging::PurgeBatch(const Batch& batch)
+{
+	std::unordered_map<std::string, std::string> originalPaths;
+	std::vector<std::string> stagedPaths;
+	for (const StagedSave& save : batch.saves)
+	{
+		originalPaths[save.stagedPath] = save.originalPath;
+		stagedPaths.push_back(save.stagedPath);
+	}
+
+	std::vector<std::string> purged;
+	std::mutex purgedMutex;
+
+	DeletionObserver observer;
+	observer.cancelled = &stopping;
+	observer.onItemDeleted = [&originalPaths, &purged, &purgedMutex](const std::string& stagedPath)
+		{
+			std::error_code error;
+			std::filesystem::remove(GetOriginFile(std::filesystem::u8path(stagedPath)), error);
+
+			const std::string& originalPath = originalPaths.at(stagedPath);
+			if (!originalPath.empty())
+			{
+				std::lock_guard<std::mutex> lock(purgedMutex);
+				purged.push_back(originalPath);
+			}
+		};
+
+	DeletionEngine engine;
+	engine.SetThreadCount(CONSTANT::PURGE_THREAD_COUNT);
+	engine.SetBackground(true);
+	engine.DeleteAll(stagedPaths, observer);
+
+	if (onPurged && !purged.empty())
+	{
+		onPurged(purged);
+	}
+
+	// only goes if everything in it did.
+	std::error_code error;
+	std::filesystem::remove(batch.folder, error);
+}
+
+/**
+ * @brief Creates a new, uniquely named batch folder.
+ *
+ * @return The folder, empty if it couldn't be created.
+ */
+std::filesystem::path SaveStaging::MakeBatchFolder()
+{
+	uint64_t counter = 0;
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		counter = batchCounter++;
+	}
+
+	// the time keeps names unique across runs, the counter within one.
+	long long now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	std::filesystem::path batchFolder = stagingFolder / (std::to_string(now) + "-" + std::to_string(counter));
+
+	std::error_code error;
+	std::filesystem::create_directories(batchFolder, error);
+	if (error)
+	{
+		return std::filesystem::path();
+	}
+	return batchFolder;
+}
+
+/**
+ * @brief Gets the ".origin" file that goes with a staged folder.
+ */
+std::filesystem::path SaveStaging::GetOriginFile(const std::filesystem::path& stagedPath)
+{
+	std::filesystem::path originFile = stagedPath;
+	originFile += ".origin";
+	return originFile;
+}
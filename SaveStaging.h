@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DeletionEngine.h"
+
+// A save folder moved into the staging folder, waiting to be purged.
+struct StagedSave
+{
+	std::string originalPath;
+	std::string stagedPath;
+};
+
+// What StageAll did with the save folders it was given.
+struct StageResult
+{
+	std::vector<StagedSave> staged;
+	// couldn't be moved (usually because they're on another drive), these need deleting where they are
+	std::vector<std::string> unstaged;
+};
+
+// Deletes save folders instantly by moving them out of the way first.
+//
+// Each StageAll renames the save folders into a new batch folder inside the
+// staging folder, which takes the same time however big they are as long as
+// both are on one drive. Batches can be put back, newest first, until the
+// purger deletes them for good UNDO_WINDOW_MS later. Every staged folder has a
+// ".origin" file next to it saying where it came from, so batches left behind
+// by an earlier run (closed or crashed before the purge) are purged on start.
+class SaveStaging
+{
+public:
+	// called from the purger thread with the saves of a batch that are gone for good
+	using PurgedCallback = std::function<void(const std::vector<std::string>& originalPaths)>;
+
+	explicit SaveStaging(const std::string& stagingFolder);
+	~SaveStaging();
+
+	SaveStaging(const SaveStaging&) = delete;
+	SaveStaging& operator=(const SaveStaging&) = delete;
+
+	void Start(PurgedCallback onPurged);
+	void Stop();
+
+	StageResult StageAll(const std::vector<std::string>& paths);
+	bool CanUndo();
+	std::vector<std::string> UndoLastBatch(std::vector<DeletionError>& errors);
+
+private:
+	// the save folders moved by one StageAll.
+	struct Batch
+	{
+		std::filesystem::path folder;
+		std::vector<StagedSave> saves;
+		std::chrono::steady_clock::time_point stagedTime;
+		// found on start, purged straight away and never undone
+		bool leftover = false;
+	};
+
+	void FindLeftovers();
+	void PurgeLoop();
+	void PurgeBatch(const Batch& batch);
+	std::filesystem::path MakeBatchFolder();
+	static std::filesystem::path GetOriginFile(const std::filesystem::path& stagedPath);
+
+	std::filesystem::path stagingFolder;
+	PurgedCallback onPurged;
+	std::thread purgeThread;
+	std::atomic<bool> stopping{ false };
+
+	// oldest first, the purger takes from the front and undo from the back
+	std::deque<Batch> batches;
+	std::mutex batchMutex;
+	std::condition_variable batchesChanged;
+	uint64_t batchCounter = 0;
+};
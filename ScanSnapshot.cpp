@@ -0,0 +1,364 @@
+#include "ScanSnapshot.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char SNAPSHOT_MAGIC[8] = { 'U', 'S', 'D', 'S', 'N', 'A', 'P', '\0' };
+	const uint32_t SNAPSHOT_VERSION = 3;
+
+	static_assert(sizeof(ScanSnapshot::Header) == 40, "snapshot header layout changed");
+	static_assert(sizeof(ScanSnapshot::Record) == 48, "snapshot record layout changed");
+}
+
+
+/**
+ * @brief Unmaps the snapshot file.
+ */
+ScanSnapshot::~ScanSnapshot()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != nullptr)
+	{
+		CloseHandle(fileHandle);
+	}
+#else
+	if (data != nullptr)
+	{
+		munmap(const_cast<char*>(data), size);
+	}
+#endif
+}
+
+/**
+ * @brief Maps a snapshot file written by Write.
+ *
+ * @param file Path to the snapshot, in UTF-8.
+ * @return The snapshot, or nullptr if there is none or it doesn't look right.
+ */
+std::unique_ptr<ScanSnapshot> ScanSnapshot::Load(const std::string& file)
+{
+	std::unique_ptr<ScanSnapshot> snapshot(new ScanSnapshot());
+	if (!snapshot->Map(file) || !snapshot->Validate())
+	{
+		return nullptr;
+	}
+
+	snapshot->BuildLookup();
+	return snapshot;
+}
+
+/**
+ * @brief Writes a snapshot, replacing the old one only once the new one is complete.
+ *
+ * @param file Path to the snapshot, in UTF-8.
+ * @param root The LocalLow folder that was scanned.
+ * @param walkKey The WalkPolicy the scan walked the folders with.
+ * @param directories Every folder the scan saw, parents before their children.
+ * @return False if the file couldn't be written.
+ */
+bool ScanSnapshot::Write(const std::string& file, const std::string& root, uint64_t walkKey, const std::vector<SnapshotDirectory>& directories)
+{
+	std::string stringBlob;
+	auto addString = [&stringBlob](const std::string& value, uint32_t& offset, uint32_t& length)
+		{
+			offset = static_cast<uint32_t>(stringBlob.size());
+			length = static_cast<uint32_t>(value.size());
+			stringBlob += value;
+		};
+
+	Header header{};
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.recordCount = static_cast<uint32_t>(directories.size());
+	header.walkKey = walkKey;
+	addString(root, header.rootOffset, header.rootLength);
+
+	std::vector<Record> recordList(directories.size());
+	for (size_t i = 0; i < directories.size(); ++i)
+	{
+		const SnapshotDirectory& directory = directories[i];
+		Record& record = recordList[i];
+		addString(directory.path, record.pathOffset, record.pathLength);
+		addString(directory.installPath, record.installOffset, record.installLength);
+		record.parent = directory.parent;
+		record.flags = static_cast<uint8_t>((directory.hasPlayerLog ? FLAG_PLAYER_LOG : 0) | (directory.hasOutputLog ? FLAG_OUTPUT_LOG : 0));
+		record.saveClass = directory.saveClass;
+		record.mtime = directory.mtime;
+		record.logSize = directory.logSize;
+		record.logMtime = directory.logMtime;
+	}
+	header.stringsSize = stringBlob.size();
+
+	std::filesystem::path target = std::filesystem::u8path(file);
+	std::filesystem::path temporary = target;
+	temporary += ".tmp";
+
+	std::error_code error;
+	std::filesystem::create_directories(target.parent_path(), error);
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(recordList.data()), static_cast<std::streamsize>(recordList.size() * sizeof(Record)));
+		out.write(stringBlob.data(), static_cast<std::streamsize>(stringBlob.size()));
+		if (!out)
+		{
+			out.close();
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporary, target, error);
+	return !error;
+}
+
+/**
+ * @brief Gets the LocalLow folder the snapshot was taken of.
+ */
+std::string_view ScanSnapshot::GetRoot() const
+{
+	return std::string_view(strings + header->rootOffset, header->rootLength);
+}
+
+/**
+ * @brief Gets a folder's path, pointing into the mapping.
+ */
+std::string_view ScanSnapshot::GetPath(const Record& record) const
+{
+	return std::string_view(strings + record.pathOffset, record.pathLength);
+}
+
+/**
+ * @brief Gets the game path the folder's Player.log had, empty if none.
+ */
+std::string_view ScanSnapshot::GetInstallPath(const Record& record) const
+{
+	return std::string_view(strings + record.installOffset, record.installLength);
+}
+
+/**
+ * @brief Looks a folder up by its path.
+ *
+ * @return The folder's record, or nullptr if the last scan didn't see it.
+ */
+const ScanSnapshot::Record* ScanSnapshot::Find(std::string_view path) const
+{
+	auto found = lookup.find(path);
+	return found == lookup.end() ? nullptr : &records[found->second];
+}
+
+/**
+ * @brief Gets the indices of a folder's subfolders.
+ *
+ * @return Begin and end of the index range.
+ */
+std::pair<const uint32_t*, const uint32_t*> ScanSnapshot::GetChildren(const Record& record) const
+{
+	size_t index = static_cast<size_t>(&record - records);
+	const uint32_t* begin = childList.data() + childStart[index];
+	const uint32_t* end = childList.data() + childStart[index + 1];
+	return std::make_pair(begin, end);
+}
+
+/**
+ * @brief Rebuilds the save folders the last scan found, grouped by company.
+ *
+ * Used to fill the GUI straight away on startup, before the new scan is done.
+ *
+ * @return Company paths with their saves, in the order they were scanned.
+ */
+std::vector<std::pair<std::string, std::vector<SaveEntry>>> ScanSnapshot::GetCompanySaves() const
+{
+	std::vector<std::pair<std::string, std::vector<SaveEntry>>> companies;
+	// company of each record, records come after their parents so one pass does it.
+	std::vector<uint32_t> companyOf(header->recordCount);
+
+	for (uint32_t i = 0; i < header->recordCount; ++i)
+	{
+		const Record& record = records[i];
+		if (record.parent == SnapshotDirectory::NO_PARENT)
+		{
+			companyOf[i] = static_cast<uint32_t>(companies.size());
+			companies.emplace_back(std::string(GetPath(record)), std::vector<SaveEntry>());
+		}
+		else
+		{
+			companyOf[i] = companyOf[record.parent];
+		}
+
+		if (record.saveClass == SnapshotDirectory::NOT_A_SAVE)
+		{
+			continue;
+		}
+
+		std::pair<std::string, std::vector<SaveEntry>>& company = companies[companyOf[i]];
+		SaveEntry save;
+		save.companyPath = company.first;
+		save.gamePath = std::string(GetPath(record));
+		save.hasPlayerLog = (record.flags & FLAG_PLAYER_LOG) != 0;
+		save.hasOutputLog = (record.flags & FLAG_OUTPUT_LOG) != 0;
+		save.installPath = std::string(GetInstallPath(record));
+		save.classification = static_cast<SaveClass>(record.saveClass);
+		save.mtime = record.mtime;
+		company.second.push_back(save);
+	}
+
+	return companies;
+}
+
+/**
+ * @brief Maps the whole file read only.
+ */
+bool ScanSnapshot::Map(const std::string& file)
+{
+#ifdef _WIN32
+	std::wstring widePath = std::filesystem::u8path(file).wstring();
+	HANDLE handle = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	fileHandle = handle;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		return false;
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	mappingHandle = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr)
+	{
+		return false;
+	}
+
+	data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	return data != nullptr;
+#else
+	int handle = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	if (handle < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(handle, &info) != 0 || info.st_size == 0)
+	{
+		close(handle);
+		return false;
+	}
+	size = static_cast<size_t>(info.st_size);
+
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, handle, 0);
+	// the mapping keeps the file alive.
+	close(handle);
+	if (mapping == MAP_FAILED)
+	{
+		return false;
+	}
+
+	data = static_cast<const char*>(mapping);
+	return true;
+#endif
+}
+
+/**
+ * @brief Checks the header, and that every offset stays inside the file.
+ */
+bool ScanSnapshot::Validate()
+{
+	if (size < sizeof(Header))
+	{
+		return false;
+	}
+
+	header = reinterpret_cast<const Header*>(data);
+	if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 || header->version != SNAPSHOT_VERSION)
+	{
+		return false;
+	}
+
+	uint64_t recordsSize = static_cast<uint64_t>(header->recordCount) * sizeof(Record);
+	if (sizeof(Header) + recordsSize + header->stringsSize != size)
+	{
+		return false;
+	}
+
+	records = reinterpret_cast<const Record*>(data + sizeof(Header));
+	strings = data + sizeof(Header) + recordsSize;
+
+	auto inStrings = [this](uint64_t offset, uint64_t length) { return offset + length <= header->stringsSize; };
+	if (!inStrings(header->rootOffset, header->rootLength))
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header->recordCount; ++i)
+	{
+		const Record& record = records[i];
+		bool parentValid = record.parent == SnapshotDirectory::NO_PARENT || record.parent < i;
+		bool saveClassValid = record.saveClass == SnapshotDirectory::NOT_A_SAVE || record.saveClass <= static_cast<uint8_t>(SaveClass::Unknown);
+		if (!parentValid || !saveClassValid || !inStrings(record.pathOffset, record.pathLength) || !inStrings(record.installOffset, record.installLength))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Indexes the records by path and by parent.
+ */
+void ScanSnapshot::BuildLookup()
+{
+	const uint32_t recordCount = header->recordCount;
+	lookup.reserve(recordCount);
+	childStart.assign(static_cast<size_t>(recordCount) + 1, 0);
+
+	for (uint32_t i = 0; i < recordCount; ++i)
+	{
+		lookup.emplace(GetPath(records[i]), i);
+		if (records[i].parent != SnapshotDirectory::NO_PARENT)
+		{
+			++childStart[records[i].parent + 1];
+		}
+	}
+
+	for (uint32_t i = 0; i < recordCount; ++i)
+	{
+		childStart[i + 1] += childStart[i];
+	}
+
+	childList.resize(childStart[recordCount]);
+	std::vector<uint32_t> filled(childStart.begin(), childStart.end() - 1);
+	for (uint32_t i = 0; i < recordCount; ++i)
+	{
+		if (records[i].parent != SnapshotDirectory::NO_PARENT)
+		{
+			childList[filled[records[i].parent]++] = i;
+		}
+	}
+}
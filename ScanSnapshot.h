@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "SaveIndex.h"
+
+// One folder as the scanner saw it, written out to the snapshot.
+struct SnapshotDirectory
+{
+	std::string path;
+	// index of the parent folder in the same list, NO_PARENT for company folders
+	uint32_t parent = 0;
+	int64_t mtime = 0;
+	bool hasPlayerLog = false;
+	bool hasOutputLog = false;
+	// Player.log metadata and what its header said, only set if hasPlayerLog
+	int64_t logSize = 0;
+	int64_t logMtime = 0;
+	std::string installPath;
+	// how the folder ended up in the index, NOT_A_SAVE if it isn't a save folder
+	uint8_t saveClass = 0;
+
+	static constexpr uint32_t NO_PARENT = UINT32_MAX;
+	static constexpr uint8_t NOT_A_SAVE = 0xFF;
+};
+
+// A scan of LocalLow saved to disk, read back through a memory mapping.
+//
+// Lets the GUI show the last scan before a new one even starts, and lets the next
+// scan skip reading folders whose mtime hasn't changed and Player.logs whose
+// size/mtime haven't changed.
+class ScanSnapshot
+{
+public:
+	// On disk layout, every field is read straight out of the mapping.
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t recordCount;
+		uint64_t stringsSize;
+		uint32_t rootOffset;
+		uint32_t rootLength;
+		// WalkPolicy::GetKey of the scan, folders it didn't walk aren't in the snapshot
+		uint64_t walkKey;
+	};
+
+	struct Record
+	{
+		uint32_t pathOffset;
+		uint32_t pathLength;
+		uint32_t parent;
+		uint32_t installOffset;
+		uint32_t installLength;
+		uint8_t flags;
+		uint8_t saveClass;
+		uint16_t reserved;
+		int64_t mtime;
+		int64_t logSize;
+		int64_t logMtime;
+	};
+
+	static constexpr uint8_t FLAG_PLAYER_LOG = 1;
+	static constexpr uint8_t FLAG_OUTPUT_LOG = 2;
+
+	~ScanSnapshot();
+
+	static std::unique_ptr<ScanSnapshot> Load(const std::string& file);
+	static bool Write(const std::string& file, const std::string& root, uint64_t walkKey, const std::vector<SnapshotDirectory>& directories);
+
+	std::string_view GetRoot() const;
+	uint64_t GetWalkKey() const { return header->walkKey; }
+	size_t GetRecordCount() const { return header->recordCount; }
+	const Record& GetRecord(size_t index) const { return records[index]; }
+	std::string_view GetPath(const Record& record) const;
+	std::string_view GetInstallPath(const Record& record) const;
+
+	const Record* Find(std::string_view path) const;
+	std::pair<const uint32_t*, const uint32_t*> GetChildren(const Record& record) const;
+
+	std::vector<std::pair<std::string, std::vector<SaveEntry>>> GetCompanySaves() const;
+
+private:
+	ScanSnapshot() = default;
+	bool Map(const std::string& file);
+	bool Validate();
+	void BuildLookup();
+
+	const char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+
+	const Header* header = nullptr;
+	const Record* records = nullptr;
+	const char* strings = nullptr;
+
+	std::unordered_map<std::string_view, uint32_t> lookup;
+	// children of record i are childList[childStart[i]] up to childList[childStart[i + 1]]
+	std::vector<uint32_t> childStart;
+	std::vector<uint32_t> childList;
+};
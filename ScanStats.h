@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// What a scan cost, counted as it runs. Set ScanObserver::stats to get them.
+// The counters are only ever added to, from any of the scan's threads.
+// With no stats set the scan doesn't count or time anything.
+struct ScanStats
+{
+	// folders the walk went through
+	std::atomic<uint64_t> directoriesVisited{ 0 };
+	// folders actually listed, the rest came from the snapshot
+	std::atomic<uint64_t> directoriesRead{ 0 };
+	// entries of listed folders whose type had to be checked
+	std::atomic<uint64_t> entriesChecked{ 0 };
+	// Player.logs opened to read their header
+	std::atomic<uint64_t> filesOpened{ 0 };
+	std::atomic<uint64_t> bytesRead{ 0 };
+	// of those, the ones read through io_uring, see LogBatchReader
+	std::atomic<uint64_t> logsReadOnRing{ 0 };
+	// install paths stat'ed by InstallProbe
+	std::atomic<uint64_t> pathsProbed{ 0 };
+	// Steam manifests read for the install index, 0 when its cache was current
+	std::atomic<uint64_t> manifestsRead{ 0 };
+	// saves with no game path of their own that the install index found a game for
+	std::atomic<uint64_t> unknownResolved{ 0 };
+	// folders and Player.logs taken from the snapshot without touching them
+	std::atomic<uint64_t> folderCacheHits{ 0 };
+	std::atomic<uint64_t> logCacheHits{ 0 };
+	// subfolders not walked: too deep, on the skip list, or below a Player.log
+	std::atomic<uint64_t> foldersSkipped{ 0 };
+
+	// wall time of each phase of the scan
+	std::atomic<uint64_t> installIndexMicroseconds{ 0 };
+	std::atomic<uint64_t> listMicroseconds{ 0 };
+	std::atomic<uint64_t> walkMicroseconds{ 0 };
+	std::atomic<uint64_t> logsMicroseconds{ 0 };
+	std::atomic<uint64_t> snapshotMicroseconds{ 0 };
+	// time spent listing folders, reading logs and probing install paths, added up over every thread
+	std::atomic<uint64_t> listingMicroseconds{ 0 };
+	std::atomic<uint64_t> logReadMicroseconds{ 0 };
+	std::atomic<uint64_t> probeMicroseconds{ 0 };
+
+	void Reset()
+	{
+		directoriesVisited = 0;
+		directoriesRead = 0;
+		entriesChecked = 0;
+		filesOpened = 0;
+		bytesRead = 0;
+		logsReadOnRing = 0;
+		pathsProbed = 0;
+		manifestsRead = 0;
+		unknownResolved = 0;
+		folderCacheHits = 0;
+		logCacheHits = 0;
+		foldersSkipped = 0;
+		installIndexMicroseconds = 0;
+		listMicroseconds = 0;
+		walkMicroseconds = 0;
+		logsMicroseconds = 0;
+		probeMicroseconds = 0;
+		snapshotMicroseconds = 0;
+		listingMicroseconds = 0;
+		logReadMicroseconds = 0;
+	}
+};
@@ -0,0 +1,138 @@
+#include "SizeAggregator.h"
+#include "DirectoryReader.h"
+#include <deque>
+#include <system_error>
+
+
+/**
+ * @brief Measures save folders, blocking until done.
+ *
+ * Each folder's mtime is read before anything in it is counted, so a folder
+ * that changes while it is measured has a size that is already stale.
+ *
+ * @param paths Save folders in UTF-8.
+ * @param observer Gets each save folder's size as soon as it is added up.
+ */
+void SizeAggregator::MeasureAll(const std::vector<std::string>& paths, const SizeObserver& observer)
+{
+	std::deque<Item> items;
+	for (const std::string& path : paths)
+	{
+		items.emplace_back();
+		items.back().path = path;
+	}
+
+	ThreadPool pool(threadCount, background);
+	SizeRun run{ pool, observer };
+	for (Item& item : items)
+	{
+		pool.Submit([this, &run, &item]()
+			{
+				std::shared_ptr<Folder> root = std::make_shared<Folder>();
+				root->path = std::filesystem::u8path(item.path);
+				root->item = &item;
+
+				// read the way the scanner reads it, so the two can be compared.
+				if (!DirectoryReader().ReadMtime(DirectoryReader::Folder(root->path), item.mtime))
+				{
+					item.mtime = -1;
+				}
+				MeasureFolder(run, root);
+			});
+	}
+	pool.Wait();
+}
+/**
+ * @brief Sets how many threads MeasureAll uses.
+ *
+ * @param threadCount Number of worker threads, 0 uses one per hardware thread.
+ */
+void SizeAggregator::SetThreadCount(unsigned int threadCount)
+{
+	this->threadCount = threadCount;
+}
+/**
+ * @brief Makes MeasureAll run at low priority, so it doesn't slow a scan down.
+ */
+void SizeAggregator::SetBackground(bool background)
+{
+	this->background = background;
+}
+/**
+ * @brief Counts one folder's files, handing its subfolders to the pool.
+ *
+ * A folder that can't be listed counts as empty.
+ *
+ * @param run The measurement this folder belongs to.
+ * @param folder The folder to count.
+ */
+void SizeAggregator::MeasureFolder(SizeRun& run, const std::shared_ptr<Folder>& folder)
+{
+	Item& item = *folder->item;
+	std::error_code error;
+	uint64_t bytes = 0;
+	uint64_t files = 0;
+	for (std::filesystem::directory_iterator it(folder->path, error), end; !error && it != end && !IsCancelled(run.observer); it.increment(error))
+	{
+		const std::filesystem::directory_entry& entry = *it;
+		std::error_code entryError;
+		std::filesystem::file_type type = entry.symlink_status(entryError).type();
+		if (type == std::filesystem::file_type::directory)
+		{
+			std::shared_ptr<Folder> child = std::make_shared<Folder>();
+			child->path = entry.path();
+			child->parent = folder;
+			child->item = &item;
+			++folder->pendingTasks;
+			run.pool.Submit([this, &run, child]() { MeasureFolder(run, child); });
+			continue;
+		}
+
+		++files;
+		if (type == std::filesystem::file_type::regular)
+		{
+			uint64_t size = entry.file_size(entryError);
+			bytes += entryError ? 0 : size;
+		}
+	}
+
+	item.bytes += bytes;
+	item.files += files;
+	FinishFolder(run, folder);
+}
+/**
+ * @brief Marks one of a folder's tasks as done, reporting the save once all are.
+ *
+ * @param run The measurement this folder belongs to.
+ * @param folder The folder the task worked on.
+ */
+void SizeAggregator::FinishFolder(SizeRun& run, const std::shared_ptr<Folder>& folder)
+{
+	if (--folder->pendingTasks != 0)
+	{
+		return;
+	}
+
+	if (folder->parent)
+	{
+		FinishFolder(run, folder->parent);
+		return;
+	}
+
+	Item& item = *folder->item;
+	if (!IsCancelled(run.observer) && run.observer.onMeasured)
+	{
+		FolderSize size;
+		size.bytes = item.bytes;
+		size.files = item.files;
+		size.mtime = item.mtime;
+		run.observer.onMeasured(item.path, size);
+	}
+}
+/**
+ * @brief Checks whether the observer asked for the measurement to stop.
+ */
+bool SizeAggregator::IsCancelled(const SizeObserver& observer)
+{
+	return observer.cancelled != nullptr && observer.cancelled->load();
+}
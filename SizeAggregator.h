@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Constants.h"
+#include "SaveIndex.h"
+#include "ThreadPool.h"
+
+// Optional hooks into a running measurement. Called from the worker threads,
+// so whatever they do has to be thread safe.
+struct SizeObserver
+{
+	// a save folder has been added up
+	std::function<void(const std::string& path, const FolderSize& size)> onMeasured;
+	// set to true from any thread to stop early, folders not finished aren't reported
+	const std::atomic<bool>* cancelled = nullptr;
+};
+
+// Adds up how much disk each of a batch of save folders takes, on a thread pool.
+//
+// Works like DeletionEngine: every folder is its own task, so one huge save is
+// spread over the pool, and a save folder is reported by whichever of its
+// folder tasks finishes last. Links are counted as themselves, never followed.
+class SizeAggregator
+{
+public:
+	void MeasureAll(const std::vector<std::string>& paths, const SizeObserver& observer = SizeObserver());
+	void SetThreadCount(unsigned int threadCount);
+	void SetBackground(bool background);
+
+private:
+	// one save folder of the batch.
+	struct Item
+	{
+		std::string path;
+		int64_t mtime = 0;
+		std::atomic<uint64_t> bytes{ 0 };
+		std::atomic<uint64_t> files{ 0 };
+	};
+
+	// one folder inside a save, alive until it and all its subfolders are counted.
+	struct Folder
+	{
+		std::filesystem::path path;
+		std::shared_ptr<Folder> parent;
+		Item* item = nullptr;
+		// this folder's own task plus one per subfolder
+		std::atomic<size_t> pendingTasks{ 1 };
+	};
+
+	// state shared by every task of one MeasureAll call.
+	struct SizeRun
+	{
+		ThreadPool& pool;
+		const SizeObserver& observer;
+	};
+
+	void MeasureFolder(SizeRun& run, const std::shared_ptr<Folder>& folder);
+	void FinishFolder(SizeRun& run, const std::shared_ptr<Folder>& folder);
+	static bool IsCancelled(const SizeObserver& observer);
+
+	unsigned int threadCount = CONSTANT::SIZE_THREAD_COUNT;
+	bool background = false;
+};
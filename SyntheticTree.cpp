@@ -0,0 +1,365 @@
+#include "SyntheticTree.h"
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Builds a tree, wiping whatever was in the base folder before.
+ *
+ * The same options and seed always give the same tree.
+ *
+ * @param base Folder to build in, created if needed. Never point this at anything you want to keep.
+ * @param options The shape of the tree.
+ * @return Where the fake LocalLow is, and what the scanner should find in it.
+ */
+SyntheticTreeSummary SyntheticTree::Generate(const std::filesystem::path& base, const SyntheticTreeOptions& options)
+{
+	const LogFormat formats[] =
+	{
+		LogFormat::MonoPath,
+		LogFormat::MonoConfigPath,
+		LogFormat::Loading,
+		LogFormat::SubsystemsPath,
+		LogFormat::DataArchive,
+		LogFormat::PathLine
+	};
+	const size_t formatCount = sizeof(formats) / sizeof(formats[0]);
+
+	std::error_code error;
+	std::filesystem::remove_all(base, error);
+
+	SyntheticTreeSummary summary;
+	summary.localLow = base / "Saves";
+	std::filesystem::create_directories(summary.localLow);
+
+	std::mt19937 random(options.seed);
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+	size_t gameNumber = 0;
+
+	// drawn from separately, so the saves come out the same with or without Steam.
+	std::mt19937 steamRandom(options.seed + 1);
+	std::vector<std::filesystem::path> libraries;
+	size_t steamApps = 0;
+	if (options.steamShare > 0.0 || options.steamOtherApps > 0)
+	{
+		summary.steam = base / "Steam";
+		libraries = { summary.steam, base / "SteamLibrary" };
+		std::string vdf = "\"libraryfolders\"\n{\n";
+		for (size_t i = 0; i < libraries.size(); ++i)
+		{
+			std::filesystem::create_directories(libraries[i] / "steamapps" / "common");
+			std::string path;
+			for (char c : libraries[i].u8string())
+			{
+				path += c == '\\' ? std::string("\\\\") : std::string(1, c);
+			}
+			vdf += "\t\"" + std::to_string(i) + "\"\n\t{\n\t\t\"path\"\t\t\"" + path + "\"\n\t\t\"label\"\t\t\"\"\n\t}\n";
+		}
+		vdf += "}\n";
+		WriteFile(summary.steam / "steamapps" / "libraryfolders.vdf", vdf, 0);
+	}
+	auto addSteamGame = [&](const std::string& companyName, const std::string& gameName)
+		{
+			if (!libraries.empty() && chance(steamRandom) < options.steamShare)
+			{
+				WriteSteamApp(libraries[steamApps % libraries.size()], 1000 + steamApps, companyName + " " + gameName, companyName, gameName);
+				++steamApps;
+				++summary.steamInstalled;
+			}
+		};
+
+	for (size_t company = 0; company < options.companyCount; ++company)
+	{
+		std::string companyName = "Company " + std::to_string(company);
+		std::filesystem::path companyFolder = summary.localLow / companyName;
+		std::filesystem::create_directory(companyFolder);
+		++summary.directories;
+
+		for (size_t game = 0; game < options.gamesPerCompany; ++game, ++gameNumber)
+		{
+			std::string gameName = "Game " + std::to_string(game);
+			std::filesystem::path gameFolder = companyFolder / gameName;
+			std::filesystem::create_directory(gameFolder);
+			++summary.directories;
+
+			// screenshot/cache/mod folders, breadth first so every level is full.
+			std::vector<std::filesystem::path> level{ gameFolder };
+			for (size_t depth = 0; depth < options.nestingDepth; ++depth)
+			{
+				std::vector<std::filesystem::path> nextLevel;
+				for (const std::filesystem::path& parent : level)
+				{
+					for (size_t i = 0; i < options.foldersPerLevel; ++i)
+					{
+						nextLevel.push_back(parent / ("Cache " + std::to_string(i)));
+						std::filesystem::create_directory(nextLevel.back());
+						++summary.directories;
+					}
+				}
+				level = std::move(nextLevel);
+			}
+
+			// a game that keeps everything, for the walk to stay out of.
+			if (gameNumber == 0 && options.clutterFiles > 0)
+			{
+				summary.directories += WriteClutter(gameFolder / "Replays", options.clutterFiles / 2);
+				summary.directories += WriteClutter(gameFolder / "Recordings" / "Session" / "Take", options.clutterFiles - options.clutterFiles / 2);
+			}
+
+			if (chance(random) < options.outputLogShare)
+			{
+				WriteFile(gameFolder / "output_log.txt", "Initialize engine version: 5.6.7f1\n", options.logBytes);
+				++summary.outputLogs;
+				++summary.unknown;
+				addSteamGame(companyName, gameName);
+				summary.logBytes += options.logBytes;
+				continue;
+			}
+
+			std::string header;
+			if (chance(random) < options.noHeaderShare)
+			{
+				header = MakeHeader(LogFormat::None, std::string());
+				++summary.unknown;
+				addSteamGame(companyName, gameName);
+			}
+			else
+			{
+				bool installed = chance(random) < options.installedShare;
+				std::filesystem::path installFolder = base / (installed ? "Installs" : "Missing") / companyName / gameName / (gameName + "_Data");
+				LogFormat format = formats[gameNumber % formatCount];
+				std::string installPath;
+				switch (format)
+				{
+				case LogFormat::MonoPath:
+				case LogFormat::PathLine:
+					installPath = (installFolder / "Managed").generic_u8string();
+					break;
+				case LogFormat::MonoConfigPath:
+					installPath = (installFolder / "MonoBleedingEdge" / "etc").generic_u8string();
+					break;
+				case LogFormat::Loading:
+				case LogFormat::DataArchive:
+					installPath = (installFolder / "data.unity3d").generic_u8string();
+					break;
+				default:
+					installPath = installFolder.generic_u8string();
+					break;
+				}
+
+				if (installed)
+				{
+					std::filesystem::create_directories(std::filesystem::u8path(installPath));
+					++summary.installed;
+				}
+				else
+				{
+					++summary.unlinked;
+				}
+				header = MakeHeader(format, installPath);
+			}
+
+			WriteFile(gameFolder / "Player.log", header, options.logBytes);
+			++summary.playerLogs;
+			summary.logBytes += options.logBytes;
+		}
+	}
+
+	for (size_t app = 0; app < options.steamOtherApps && !libraries.empty(); ++app, ++steamApps)
+	{
+		WriteSteamApp(libraries[steamApps % libraries.size()], 1000 + steamApps, "Tool " + std::to_string(app), std::string(), std::string());
+	}
+
+	return summary;
+}
+
+/**
+ * @brief Installs an app in a fake Steam library: its manifest, and its folder under common.
+ *
+ * @param name The app's Steam name, also its install folder's name.
+ * @param company The Unity company name for its app.info, none is written if empty.
+ * @param product The Unity product name for its app.info.
+ */
+void SyntheticTree::WriteSteamApp(const std::filesystem::path& library, size_t appId, const std::string& name, const std::string& company, const std::string& product)
+{
+	std::string id = std::to_string(appId);
+	std::string manifest = "\"AppState\"\n{\n"
+		"\t\"appid\"\t\t\"" + id + "\"\n"
+		"\t\"Universe\"\t\t\"1\"\n"
+		"\t\"name\"\t\t\"" + name + "\"\n"
+		"\t\"StateFlags\"\t\t\"4\"\n"
+		"\t\"installdir\"\t\t\"" + name + "\"\n"
+		"\t\"InstalledDepots\"\n\t{\n\t\t\"" + std::to_string(appId + 1) + "\"\n\t\t{\n"
+		"\t\t\t\"manifest\"\t\t\"5806452154012837290\"\n\t\t\t\"size\"\t\t\"1048576\"\n\t\t}\n\t}\n"
+		"}\n";
+	WriteFile(library / "steamapps" / ("appmanifest_" + id + ".acf"), manifest, 0);
+
+	std::filesystem::path installFolder = library / "steamapps" / "common" / name;
+	std::filesystem::create_directories(installFolder);
+	if (!company.empty())
+	{
+		std::filesystem::create_directory(installFolder / (name + "_Data"));
+		WriteFile(installFolder / (name + "_Data") / "app.info", company + "\n" + product, 0);
+	}
+}
+
+/**
+ * @brief Writes a Player.log header in the given layout.
+ *
+ * @param format The layout, None gives a header with no game path in it.
+ * @param installPath The path LogFormatMatcher should pull back out.
+ */
+std::string SyntheticTree::MakeHeader(LogFormat format, const std::string& installPath)
+{
+	std::string header = "Initialize engine version: 2021.3.16f1 (4016570cf34f)\n";
+	switch (format)
+	{
+	case LogFormat::MonoPath:
+		header += "Mono path[0] = '" + installPath + "'\n";
+		break;
+	case LogFormat::MonoConfigPath:
+		header += "Mono config path = '" + installPath + "'\n";
+		break;
+	case LogFormat::Loading:
+		header += "Loading player data from " + installPath + "\n";
+		break;
+	case LogFormat::SubsystemsPath:
+		header += "[Subsystems] Discovering subsystems at path " + installPath + "/UnitySubsystems\n";
+		break;
+	case LogFormat::DataArchive:
+		header += "Player data archive not found at `" + installPath + "`, using local filesystem\n";
+		break;
+	case LogFormat::PathLine:
+		header += "Fallback handler could not load library at path " + installPath + "/mono.dll\n";
+		break;
+	default:
+		break;
+	}
+	header += "GfxDevice: creating device client; threaded=1; jobified=1\n";
+	return header;
+}
+
+/**
+ * @brief Writes a Wine user.reg with PlayerPrefs for the given games among other software's keys.
+ *
+ * Every key gets a handful of values, one of them a hex value continued over
+ * several lines, the way Wine writes them.
+ *
+ * @param games Company and game names, in UTF-8.
+ * @param otherKeys Keys that aren't PlayerPrefs, to bulk the hive out.
+ * @return The size of the file.
+ */
+uint64_t SyntheticTree::WriteUserReg(const std::filesystem::path& path, const std::vector<std::pair<std::string, std::string>>& games, size_t otherKeys)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out << "WINE REGISTRY Version 2\n;; All keys relative to \\\\User\\\\S-1-5-21-0-0-0-1000\n\n#arch=win64\n";
+
+	uint64_t stamp = 1700000000;
+	auto writeKey = [&out, &stamp](const std::string& keyPath)
+		{
+			out << "\n[" << keyPath << "] " << stamp++ << "\n#time=1d9f0c2a3b4c5d6\n";
+			out << "\"UnityGraphicsQuality_h1669003810\"=dword:00000003\n";
+			out << "\"Screenmanager Resolution Width_h182942802\"=dword:00000780\n";
+			out << "\"unity.player_session_count_h922449978\"=hex(4):0a,00,00,00,00,00,00,00\n";
+			out << "\"SaveData_h2983734417\"=hex:7b,22,6c,65,76,65,6c,22,3a,31,32,2c,22,67,6f,6c,64,22,3a,\\\n";
+			out << "  34,32,30,2c,22,69,74,65,6d,73,22,3a,5b,22,73,77,6f,72,64,22,2c,22,73,68,\\\n";
+			out << "  69,65,6c,64,22,5d,7d,00\n";
+		};
+
+	for (size_t i = 0; i < otherKeys; ++i)
+	{
+		writeKey("Software\\\\Vendor " + std::to_string(i / 8) + "\\\\Product " + std::to_string(i % 8) + "\\\\Settings");
+	}
+	for (const auto& game : games)
+	{
+		writeKey("Software\\\\" + game.first + "\\\\" + game.second);
+	}
+	out.flush();
+	return static_cast<uint64_t>(out.tellp());
+}
+
+/**
+ * @brief Writes save files for archiving, JSON-ish records with random numbers in them.
+ *
+ * They compress about as well as real saves do, neither all repeats nor all noise.
+ *
+ * @param folder Created if it isn't there.
+ * @param fileCount Files written, "slot0.sav" up.
+ * @param fileBytes Size of each.
+ * @return The bytes written.
+ */
+uint64_t SyntheticTree::WriteSaveFiles(const std::filesystem::path& folder, size_t fileCount, size_t fileBytes, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	std::error_code error;
+	std::filesystem::create_directories(folder, error);
+
+	uint64_t written = 0;
+	for (size_t i = 0; i < fileCount; ++i)
+	{
+		std::string text;
+		text.reserve(fileBytes + 128);
+		for (size_t record = 0; text.size() < fileBytes; ++record)
+		{
+			text += "{\"id\":" + std::to_string(record)
+				+ ",\"hp\":" + std::to_string(random() % 1000)
+				+ ",\"pos\":[" + std::to_string(random() % 100000) + "," + std::to_string(random() % 100000) + "," + std::to_string(random() % 100000) + "]"
+				+ ",\"seed\":\"" + std::to_string(random()) + "\"}\n";
+		}
+		text.resize(fileBytes);
+
+		std::ofstream out(folder / ("slot" + std::to_string(i) + ".sav"), std::ios::binary | std::ios::trunc);
+		out.write(text.data(), static_cast<std::streamsize>(text.size()));
+		written += text.size();
+	}
+	return written;
+}
+
+/**
+ * @brief Writes a file of exactly size bytes, contents first then filler log lines.
+ */
+void SyntheticTree::WriteFile(const std::filesystem::path& path, const std::string& contents, size_t size)
+{
+	std::string text = contents;
+	const std::string filler = "UnloadTime: 0.512300 ms\n";
+	while (text.size() < size)
+	{
+		text += filler;
+	}
+	text.resize(size > contents.size() ? size : contents.size());
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+/**
+ * @brief Fills a folder with empty files, a thousand to a subfolder.
+ *
+ * @param folder Created along with any missing parents.
+ * @return How many folders were created.
+ */
+size_t SyntheticTree::WriteClutter(const std::filesystem::path& folder, size_t fileCount)
+{
+	const size_t filesPerFolder = 1000;
+
+	size_t created = 0;
+	for (std::filesystem::path missing = folder; !std::filesystem::exists(missing); missing = missing.parent_path())
+	{
+		++created;
+	}
+	std::filesystem::create_directories(folder);
+
+	for (size_t file = 0; file < fileCount; ++file)
+	{
+		std::filesystem::path chunk = folder / ("Chunk " + std::to_string(file / filesPerFolder));
+		if (file % filesPerFolder == 0)
+		{
+			std::filesystem::create_directory(chunk);
+			++created;
+		}
+		std::ofstream(chunk / ("frame_" + std::to_string(file) + ".dat"), std::ios::binary);
+	}
+	return created;
+}
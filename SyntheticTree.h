@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+#include "LogHeaderReader.h"
+
+// Shape of a generated LocalLow tree.
+struct SyntheticTreeOptions
+{
+	size_t companyCount = 100;
+	size_t gamesPerCompany = 4;
+	// levels of extra folders under each game (screenshots, caches, mods), 0 for none
+	size_t nestingDepth = 2;
+	// folders per level of nesting
+	size_t foldersPerLevel = 2;
+	// share of games with only an output_log.txt, the rest have a Player.log
+	double outputLogShare = 0.2;
+	// share of Player.log games whose install path exists
+	double installedShare = 0.5;
+	// share of Player.log games whose header has no game path at all
+	double noHeaderShare = 0.05;
+	// Player.log size, the header is padded out with ordinary log lines
+	size_t logBytes = 16 * 1024;
+	// empty files in a replay cache and a deeply nested recordings folder under
+	// the first game, half each, 0 for none
+	size_t clutterFiles = 0;
+	// share of games with no game path that a fake Steam has installed, app.info and all
+	double steamShare = 0.0;
+	// non-Unity apps in the fake Steam's libraries, for the install index to read past
+	size_t steamOtherApps = 0;
+	uint32_t seed = 1;
+};
+
+// What Generate made, for checking scan results against.
+struct SyntheticTreeSummary
+{
+	std::filesystem::path localLow;
+	size_t directories = 0;
+	size_t playerLogs = 0;
+	size_t outputLogs = 0;
+	size_t installed = 0;
+	size_t unlinked = 0;
+	// output_log.txt only, or a Player.log with no game path
+	size_t unknown = 0;
+	// of the unknown saves, the ones the fake Steam has installed
+	size_t steamInstalled = 0;
+	// the fake Steam folder, empty if there is none
+	std::filesystem::path steam;
+	uint64_t logBytes = 0;
+};
+
+// Builds fake LocalLow trees to benchmark the scanner on.
+//
+// Everything goes under one base folder: "Saves" stands in for LocalLow and
+// "Installs" holds the games that count as installed. Player.log headers cycle
+// through every layout LogFormatMatcher knows, pointing either into "Installs"
+// or at a "Missing" folder that is never created. If asked for, "Steam" and
+// "SteamLibrary" are a Steam install and a second library, with manifests and
+// installs for some of the games that have no game path.
+class SyntheticTree
+{
+public:
+	static SyntheticTreeSummary Generate(const std::filesystem::path& base, const SyntheticTreeOptions& options);
+	static std::string MakeHeader(LogFormat format, const std::string& installPath);
+	static uint64_t WriteUserReg(const std::filesystem::path& path, const std::vector<std::pair<std::string, std::string>>& games, size_t otherKeys);
+	static uint64_t WriteSaveFiles(const std::filesystem::path& folder, size_t fileCount, size_t fileBytes, uint32_t seed);
+
+private:
+	static void WriteFile(const std::filesystem::path& path, const std::string& contents, size_t size);
+	static size_t WriteClutter(const std::filesystem::path& folder, size_t fileCount);
+	static void WriteSteamApp(const std::filesystem::path& library, size_t appId, const std::string& name, const std::string& company, const std::string& product);
+};
@@ -0,0 +1,220 @@
+#include "ThreadPool.h"
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	// which pool/queue the current thread works for, so nested submits stay local.
+	thread_local const ThreadPool* currentPool = nullptr;
+	thread_local unsigned int currentQueue = 0;
+}
+
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param threadCount Number of workers, 0 picks one per hardware thread.
+ * @param background Runs the workers at low priority, for work nobody is waiting on.
+ */
+ThreadPool::ThreadPool(unsigned int threadCount, bool background) : background(background)
+{
+	threadCount = ResolveThreadCount(threadCount);
+
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		queues.push_back(std::make_unique<WorkQueue>());
+	}
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back([this, i]() { WorkerLoop(i); });
+	}
+}
+
+/**
+ * @brief Finishes the queued work and joins the workers.
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		stopping = true;
+	}
+	taskQueued.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+/**
+ * @brief Turns a requested thread count into a usable one.
+ *
+ * @param threadCount Requested count, 0 means one per hardware thread.
+ * @return At least 1.
+ */
+unsigned int ThreadPool::ResolveThreadCount(unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+	return threadCount == 0 ? 1 : threadCount;
+}
+
+/**
+ * @brief Drops the calling thread to the lowest priority.
+ *
+ * On Windows background mode lowers disk and memory priority as well as CPU.
+ * On Linux nice is per thread, so this only affects the calling worker.
+ */
+void ThreadPool::EnterBackgroundMode()
+{
+#ifdef _WIN32
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#else
+	setpriority(PRIO_PROCESS, 0, 19);
+#endif
+}
+
+/**
+ * @brief Queues a task.
+ *
+ * Tasks submitted from inside a worker go on that worker's own queue, so work
+ * split off a big task stays on the same thread unless someone idle steals it.
+ * Tasks from outside are spread round robin.
+ *
+ * @param task The work to run.
+ */
+void ThreadPool::Submit(std::function<void()> task)
+{
+	unsigned int index;
+	{
+		// counted before it is pushed, a worker can steal it the moment it is
+		// and would take queuedTasks below zero. Taken under stateMutex so a
+		// worker can't miss the wake up between checking and sleeping.
+		std::lock_guard<std::mutex> lock(stateMutex);
+		++pendingTasks;
+		++queuedTasks;
+		index = currentPool == this ? currentQueue : nextQueue++ % queues.size();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queues[index]->mutex);
+		queues[index]->tasks.push_back(std::move(task));
+	}
+	taskQueued.notify_one();
+}
+
+/**
+ * @brief Blocks until every submitted task, including ones they submit, is done.
+ *
+ * Must not be called from inside a task. Rethrows the first exception a task threw.
+ */
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(stateMutex);
+	allDone.wait(lock, [this]() { return pendingTasks == 0; });
+
+	if (firstError)
+	{
+		std::exception_ptr error = firstError;
+		firstError = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+/**
+ * @brief Runs tasks from the worker's own queue, then steals, then sleeps.
+ *
+ * @param index The worker's queue.
+ */
+void ThreadPool::WorkerLoop(unsigned int index)
+{
+	currentPool = this;
+	currentQueue = index;
+	if (background)
+	{
+		EnterBackgroundMode();
+	}
+
+	while (true)
+	{
+		std::function<void()> task;
+		if (TryPop(index, task) || TrySteal(index, task))
+		{
+			--queuedTasks;
+			try
+			{
+				task();
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(stateMutex);
+				if (!firstError)
+				{
+					firstError = std::current_exception();
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(stateMutex);
+			if (--pendingTasks == 0)
+			{
+				allDone.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(stateMutex);
+		taskQueued.wait(lock, [this]() { return queuedTasks > 0 || stopping; });
+		if (stopping && queuedTasks == 0)
+		{
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Takes the newest task from the worker's own queue.
+ */
+bool ThreadPool::TryPop(unsigned int index, std::function<void()>& task)
+{
+	WorkQueue& queue = *queues[index];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty())
+	{
+		return false;
+	}
+
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+/**
+ * @brief Takes the oldest task from another worker's queue.
+ *
+ * The oldest tasks are usually the biggest (whole company folders), so stealing
+ * from the front moves the most work per steal.
+ */
+bool ThreadPool::TrySteal(unsigned int index, std::function<void()>& task)
+{
+	for (size_t offset = 1; offset < queues.size(); ++offset)
+	{
+		WorkQueue& queue = *queues[(index + offset) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool where every worker owns a queue and idle workers steal from the others.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned int threadCount, bool background = false);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(std::function<void()> task);
+	void Wait();
+
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+	static unsigned int ResolveThreadCount(unsigned int threadCount);
+
+private:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void WorkerLoop(unsigned int index);
+	static void EnterBackgroundMode();
+	bool TryPop(unsigned int index, std::function<void()>& task);
+	bool TrySteal(unsigned int index, std::function<void()>& task);
+
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex stateMutex;
+	std::condition_variable taskQueued;
+	std::condition_variable allDone;
+	std::atomic<size_t> queuedTasks{ 0 };
+	size_t pendingTasks = 0;
+	unsigned int nextQueue = 0;
+	bool stopping = false;
+	// workers run at the lowest CPU (and where possible I/O) priority
+	bool background = false;
+	std::exception_ptr firstError;
+};
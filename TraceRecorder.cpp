@@ -0,0 +1,155 @@
+#include "TraceRecorder.h"
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+
+/**
+ * @brief Starts an empty trace, times are counted from now.
+ */
+TraceRecorder::TraceRecorder() : origin(Clock::now())
+{
+}
+
+/**
+ * @brief Starts timing a span, if there is a recorder.
+ *
+ * @param trace Where the span goes, null to skip it.
+ * @param name What the span is, a string literal.
+ * @param category Groups spans in the viewer, a string literal.
+ * @param detail Extra text, usually a path, only copied if the span is recorded.
+ */
+TraceRecorder::Span::Span(TraceRecorder* trace, const char* name, const char* category, std::string_view detail)
+	: trace(trace),
+	name(name),
+	category(category)
+{
+	if (trace != nullptr)
+	{
+		this->detail = std::string(detail);
+		start = Clock::now();
+	}
+}
+
+TraceRecorder::Span::~Span()
+{
+	if (trace != nullptr)
+	{
+		trace->Record(name, category, start, Clock::now(), detail);
+	}
+}
+
+/**
+ * @brief Adds a span that has already happened.
+ *
+ * @param name What the span is, a string literal.
+ * @param category Groups spans in the viewer, a string literal.
+ * @param start When it began.
+ * @param end When it ended.
+ * @param detail Extra text, usually a path.
+ */
+void TraceRecorder::Record(const char* name, const char* category, Clock::time_point start, Clock::time_point end, std::string_view detail)
+{
+	Event event;
+	event.name = name;
+	event.category = category;
+	event.thread = ThreadNumber();
+	event.startMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(start - origin).count();
+	event.durationMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	event.detail = std::string(detail);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	events.push_back(std::move(event));
+}
+
+/**
+ * @brief Drops every span recorded so far.
+ */
+void TraceRecorder::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	events.clear();
+}
+
+size_t TraceRecorder::GetEventCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return events.size();
+}
+
+/**
+ * @brief Writes every span as a complete ("X") event in Chrome's trace format.
+ *
+ * @param file Where to write, in UTF-8.
+ * @return False if the file couldn't be written.
+ */
+bool TraceRecorder::WriteChromeTrace(const std::string& file) const
+{
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < events.size(); ++i)
+		{
+			const Event& event = events[i];
+			json += i == 0 ? "\n" : ",\n";
+			json += "{\"name\":";
+			AppendJsonString(json, event.name);
+			json += ",\"cat\":";
+			AppendJsonString(json, event.category);
+			json += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(event.thread);
+			json += ",\"ts\":" + std::to_string(event.startMicroseconds);
+			json += ",\"dur\":" + std::to_string(event.durationMicroseconds);
+			if (!event.detail.empty())
+			{
+				json += ",\"args\":{\"detail\":";
+				AppendJsonString(json, event.detail);
+				json += "}";
+			}
+			json += "}";
+		}
+	}
+	json += "\n]}\n";
+
+	std::ofstream output(std::filesystem::u8path(file), std::ios::binary | std::ios::trunc);
+	output.write(json.data(), static_cast<std::streamsize>(json.size()));
+	return static_cast<bool>(output);
+}
+
+/**
+ * @brief Numbers threads in the order they first record something, the viewer's rows.
+ */
+uint32_t TraceRecorder::ThreadNumber()
+{
+	static std::atomic<uint32_t> nextThread{ 1 };
+	thread_local uint32_t thread = nextThread++;
+	return thread;
+}
+
+/**
+ * @brief Appends text as a quoted JSON string.
+ */
+void TraceRecorder::AppendJsonString(std::string& json, std::string_view text)
+{
+	json += '"';
+	for (char c : text)
+	{
+		unsigned char byte = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\')
+		{
+			json += '\\';
+			json += c;
+		}
+		else if (byte < 0x20)
+		{
+			char escape[8];
+			std::snprintf(escape, sizeof(escape), "\\u%04x", byte);
+			json += escape;
+		}
+		else
+		{
+			json += c;
+		}
+	}
+	json += '"';
+}
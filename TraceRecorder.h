@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Collects timed spans from any thread and writes them out as a Chrome
+// trace-event file, for chrome://tracing or ui.perfetto.dev.
+//
+// Nothing is recorded unless a recorder is handed to the code being traced:
+// a Span made with a null recorder doesn't even read the clock.
+class TraceRecorder
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	TraceRecorder();
+
+	TraceRecorder(const TraceRecorder&) = delete;
+	TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+	// times its own scope, records nothing if the recorder is null.
+	class Span
+	{
+	public:
+		Span(TraceRecorder* trace, const char* name, const char* category, std::string_view detail = std::string_view());
+		~Span();
+
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+	private:
+		TraceRecorder* trace;
+		const char* name;
+		const char* category;
+		std::string detail;
+		Clock::time_point start;
+	};
+
+	void Record(const char* name, const char* category, Clock::time_point start, Clock::time_point end, std::string_view detail = std::string_view());
+	void Clear();
+	size_t GetEventCount() const;
+	bool WriteChromeTrace(const std::string& file) const;
+
+private:
+	struct Event
+	{
+		// string literals, never copied
+		const char* name;
+		const char* category;
+		uint32_t thread;
+		int64_t startMicroseconds;
+		int64_t durationMicroseconds;
+		// shown as args.detail, usually a path
+		std::string detail;
+	};
+
+	static uint32_t ThreadNumber();
+	static void AppendJsonString(std::string& json, std::string_view text);
+
+	Clock::time_point origin;
+	mutable std::mutex mutex;
+	std::vector<Event> events;
+};
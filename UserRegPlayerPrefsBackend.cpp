@@ -0,0 +1,503 @@
+#include "UserRegPlayerPrefsBackend.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include "Constants.h"
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * @brief Sets up the backend on a prefix's user.reg, nothing is read until it's needed.
+ */
+UserRegPlayerPrefsBackend::UserRegPlayerPrefsBackend(const std::filesystem::path& userReg) : userReg(userReg)
+{
+}
+
+std::vector<std::wstring> UserRegPlayerPrefsBackend::ListCompanies()
+{
+	LoadIndex();
+	std::vector<std::wstring> names;
+	for (const auto& company : companies)
+	{
+		names.push_back(company.second.name);
+	}
+	return names;
+}
+
+std::vector<std::wstring> UserRegPlayerPrefsBackend::ListGames(const std::wstring& company)
+{
+	LoadIndex();
+	std::vector<std::wstring> names;
+	auto found = companies.find(FoldName(company));
+	if (found != companies.end())
+	{
+		for (const auto& game : found->second.games)
+		{
+			names.push_back(game.second);
+		}
+	}
+	return names;
+}
+
+/**
+ * @brief Queues a game's sections for the next Commit.
+ *
+ * @return False if the game has no sections.
+ */
+bool UserRegPlayerPrefsBackend::DeleteGame(const std::wstring& company, const std::wstring& game)
+{
+	LoadIndex();
+	auto found = companies.find(FoldName(company));
+	if (found == companies.end() || found->second.games.count(FoldName(game)) == 0)
+	{
+		return false;
+	}
+	gameDeletes.emplace(FoldName(company), FoldName(game));
+	return true;
+}
+
+/**
+ * @brief Queues a company's own section for the next Commit.
+ *
+ * @return False if the company has games that aren't queued too.
+ */
+bool UserRegPlayerPrefsBackend::DeleteCompany(const std::wstring& company)
+{
+	LoadIndex();
+	std::wstring folded = FoldName(company);
+	auto found = companies.find(folded);
+	if (found == companies.end())
+	{
+		return false;
+	}
+	for (const auto& game : found->second.games)
+	{
+		if (gameDeletes.count(std::make_pair(folded, game.first)) == 0)
+		{
+			return false;
+		}
+	}
+	companyDeletes.insert(folded);
+	return true;
+}
+
+/**
+ * @brief Rewrites user.reg without the queued sections, in one pass.
+ *
+ * A line starting with '[' always starts a section, continued values are
+ * indented, so dropping a section is skipping lines until the next one. The
+ * new hive goes to a temp file in the same folder and is renamed over the old
+ * one, which is never left half written.
+ *
+ * @return False if user.reg couldn't be read or replaced, or the prefix is
+ * running, it's unchanged then.
+ */
+bool UserRegPlayerPrefsBackend::Commit()
+{
+	if (gameDeletes.empty() && companyDeletes.empty())
+	{
+		return true;
+	}
+	if (IsPrefixRunning())
+	{
+		gameDeletes.clear();
+		companyDeletes.clear();
+		return false;
+	}
+
+	std::filesystem::path tempFile = userReg;
+	tempFile += ".tmp";
+	int output = OpenFile(tempFile);
+	bool written = output >= 0;
+	if (written)
+	{
+		std::ifstream input(userReg, std::ios::binary);
+		if (input)
+		{
+			std::string buffer;
+			std::string line;
+			std::vector<std::wstring> keyPath;
+			bool skipping = false;
+			while (written && std::getline(input, line))
+			{
+				if (!line.empty() && line[0] == '[' && ParseSection(line, keyPath))
+				{
+					skipping = false;
+					if (keyPath.size() >= 2 && FoldName(keyPath[0]) == L"software")
+					{
+						std::wstring company = FoldName(keyPath[1]);
+						skipping = keyPath.size() == 2
+							? companyDeletes.count(company) != 0
+							: gameDeletes.count(std::make_pair(company, FoldName(keyPath[2]))) != 0;
+					}
+				}
+
+				if (!skipping)
+				{
+					buffer.append(line).push_back('\n');
+					if (buffer.size() >= CONSTANT::USER_REG_WRITE_BYTES)
+					{
+						written = WriteBytes(output, buffer);
+						buffer.clear();
+					}
+				}
+			}
+			// the new hive has to be on disk before it is renamed over the old one.
+			written = written && input.eof() && WriteBytes(output, buffer) && SyncFile(output);
+		}
+		else
+		{
+			written = false;
+		}
+		written = CloseFile(output) && written;
+	}
+
+	std::error_code error;
+	if (written)
+	{
+		// keep the hive's permissions, the temp file was made for its owner only.
+		std::filesystem::permissions(tempFile, std::filesystem::status(userReg, error).permissions(), error);
+		std::filesystem::rename(tempFile, userReg, error);
+		written = !error;
+	}
+	if (written)
+	{
+		// and the rename has to be on disk too, before anything else counts on it.
+		SyncFolder(userReg.has_parent_path() ? userReg.parent_path() : std::filesystem::path("."));
+	}
+	else
+	{
+		std::filesystem::remove(tempFile, error);
+	}
+
+	// the file has changed under the index either way.
+	indexed = false;
+	companies.clear();
+	gameDeletes.clear();
+	companyDeletes.clear();
+	return written;
+}
+
+/**
+ * @brief Checks whether a wineserver is running on the prefix.
+ *
+ * A wineserver listens on /tmp/.wine-(uid)/server-(dev)-(inode)/socket, named
+ * after the prefix folder, and flushes the hive over user.reg when it exits.
+ * A crashed one can leave its socket behind, so only a socket that accepts a
+ * connection counts.
+ *
+ * @return True if it is, or if the socket is there but couldn't be tried.
+ * Always false on Windows, where a prefix's wineserver can't be seen.
+ */
+bool UserRegPlayerPrefsBackend::IsPrefixRunning() const
+{
+#ifdef _WIN32
+	return false;
+#else
+	struct stat prefix;
+	if (stat(userReg.parent_path().c_str(), &prefix) != 0)
+	{
+		return false;
+	}
+
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	int length = std::snprintf(address.sun_path, sizeof(address.sun_path), "/tmp/.wine-%u/server-%llx-%llx/socket",
+		static_cast<unsigned int>(getuid()), static_cast<unsigned long long>(prefix.st_dev), static_cast<unsigned long long>(prefix.st_ino));
+	if (length < 0 || static_cast<size_t>(length) >= sizeof(address.sun_path) || access(address.sun_path, F_OK) != 0)
+	{
+		return false;
+	}
+
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server < 0)
+	{
+		return true;
+	}
+	bool running = connect(server, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0
+		|| (errno != ECONNREFUSED && errno != ENOENT);
+	close(server);
+	return running;
+#endif
+}
+
+/**
+ * @brief Creates a file to write the new hive into, replacing any that was there.
+ *
+ * @return Its descriptor, -1 if it couldn't be created.
+ */
+int UserRegPlayerPrefsBackend::OpenFile(const std::filesystem::path& path)
+{
+#ifdef _WIN32
+	int file = -1;
+	if (_wsopen_s(&file, path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY | _O_NOINHERIT, _SH_DENYRW, _S_IREAD | _S_IWRITE) != 0)
+	{
+		return -1;
+	}
+	return file;
+#else
+	return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+#endif
+}
+
+/**
+ * @brief Writes all of bytes to a file.
+ *
+ * @return False if it couldn't all be written.
+ */
+bool UserRegPlayerPrefsBackend::WriteBytes(int file, const std::string& bytes)
+{
+	size_t done = 0;
+	while (done < bytes.size())
+	{
+#ifdef _WIN32
+		int written = _write(file, bytes.data() + done, static_cast<unsigned int>(std::min<size_t>(bytes.size() - done, INT_MAX)));
+#else
+		ssize_t written = write(file, bytes.data() + done, bytes.size() - done);
+		if (written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+#endif
+		if (written < 0)
+		{
+			return false;
+		}
+		done += static_cast<size_t>(written);
+	}
+	return true;
+}
+
+/**
+ * @brief Waits until everything written to a file is on disk.
+ */
+bool UserRegPlayerPrefsBackend::SyncFile(int file)
+{
+#ifdef _WIN32
+	return _commit(file) == 0;
+#else
+	return fsync(file) == 0;
+#endif
+}
+
+/**
+ * @brief Closes a file.
+ *
+ * @return False if the last of it couldn't be written.
+ */
+bool UserRegPlayerPrefsBackend::CloseFile(int file)
+{
+#ifdef _WIN32
+	return _close(file) == 0;
+#else
+	return close(file) == 0;
+#endif
+}
+
+/**
+ * @brief Makes a rename in a folder stick, on file systems that can sync a folder.
+ *
+ * Nothing to do on Windows, where NTFS journals the rename itself.
+ */
+void UserRegPlayerPrefsBackend::SyncFolder([[maybe_unused]] const std::filesystem::path& folder)
+{
+#ifndef _WIN32
+	int folderFile = open(folder.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (folderFile >= 0)
+	{
+		fsync(folderFile);
+		close(folderFile);
+	}
+#endif
+}
+
+/**
+ * @brief Finds the user.reg of the prefix a LocalLow folder is in.
+ *
+ * @param localLow The LocalLow folder, e.g. pfx/drive_c/users/steamuser/AppData/LocalLow.
+ * @return The prefix's user.reg, empty if the folder isn't in a prefix.
+ */
+std::filesystem::path UserRegPlayerPrefsBackend::FindUserReg(const std::filesystem::path& localLow)
+{
+	std::error_code error;
+	for (std::filesystem::path folder = localLow.lexically_normal(); folder.has_relative_path(); folder = folder.parent_path())
+	{
+		if (folder.filename() == "drive_c")
+		{
+			std::filesystem::path userReg = folder.parent_path() / "user.reg";
+			if (std::filesystem::is_regular_file(userReg, error))
+			{
+				return userReg;
+			}
+			break;
+		}
+	}
+	return std::filesystem::path();
+}
+
+/**
+ * @brief Streams user.reg once for the names of every company and game under Software.
+ */
+void UserRegPlayerPrefsBackend::LoadIndex()
+{
+	if (indexed)
+	{
+		return;
+	}
+	indexed = true;
+
+	std::ifstream input(userReg, std::ios::binary);
+	std::string line;
+	std::vector<std::wstring> keyPath;
+	while (std::getline(input, line))
+	{
+		if (line.empty() || line[0] != '[' || !ParseSection(line, keyPath))
+		{
+			continue;
+		}
+		if (keyPath.size() < 2 || FoldName(keyPath[0]) != L"software")
+		{
+			continue;
+		}
+
+		// Wine leaves out sections of keys with subkeys and no values, so a company may only show up through its games.
+		Company& company = companies[FoldName(keyPath[1])];
+		if (company.name.empty())
+		{
+			company.name = keyPath[1];
+		}
+		if (keyPath.size() >= 3)
+		{
+			company.games.emplace(FoldName(keyPath[2]), keyPath[2]);
+		}
+	}
+}
+
+/**
+ * @brief Splits a section line, [Software\\Company\\Game] 1700000000, into its first three key names.
+ *
+ * Undoes Wine's escaping: "\\" between names, "\x" with up to four hex digits
+ * for UTF-16 code units, octal and C style escapes for control characters.
+ *
+ * @return False if the line has no closing bracket.
+ */
+bool UserRegPlayerPrefsBackend::ParseSection(const std::string& line, std::vector<std::wstring>& keyPath)
+{
+	keyPath.clear();
+	std::string name;
+	unsigned int highSurrogate = 0;
+	for (size_t i = 1; i < line.size(); ++i)
+	{
+		char c = line[i];
+		if (c == ']')
+		{
+			keyPath.push_back(ToWide(name));
+			return true;
+		}
+		if (c != '\\' || i + 1 >= line.size())
+		{
+			name += c;
+			continue;
+		}
+
+		char escaped = line[++i];
+		unsigned int codePoint = 0;
+		switch (escaped)
+		{
+		case '\\':
+			keyPath.push_back(ToWide(name));
+			name.clear();
+			// software, company and game are all anything here needs.
+			if (keyPath.size() == 3)
+			{
+				return true;
+			}
+			continue;
+		case 'x':
+			for (int digits = 0; digits < 4 && i + 1 < line.size() && std::isxdigit(static_cast<unsigned char>(line[i + 1])); ++digits)
+			{
+				char digit = line[++i];
+				codePoint = codePoint * 16 + (std::isdigit(static_cast<unsigned char>(digit)) ? digit - '0' : std::tolower(static_cast<unsigned char>(digit)) - 'a' + 10);
+			}
+			break;
+		case 'a': codePoint = '\a'; break;
+		case 'b': codePoint = '\b'; break;
+		case 'e': codePoint = 0x1b; break;
+		case 'f': codePoint = '\f'; break;
+		case 'n': codePoint = '\n'; break;
+		case 'r': codePoint = '\r'; break;
+		case 't': codePoint = '\t'; break;
+		case 'v': codePoint = '\v'; break;
+		default:
+			if (escaped >= '0' && escaped <= '7')
+			{
+				codePoint = escaped - '0';
+				for (int digits = 1; digits < 3 && i + 1 < line.size() && line[i + 1] >= '0' && line[i + 1] <= '7'; ++digits)
+				{
+					codePoint = codePoint * 8 + (line[++i] - '0');
+				}
+				break;
+			}
+			// [, ] and " are escaped as themselves.
+			name += escaped;
+			continue;
+		}
+
+		// names outside the BMP come as a surrogate pair of \x escapes.
+		if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+		{
+			highSurrogate = codePoint;
+			continue;
+		}
+		if (codePoint >= 0xDC00 && codePoint <= 0xDFFF && highSurrogate != 0)
+		{
+			codePoint = 0x10000 + ((highSurrogate - 0xD800) << 10) + (codePoint - 0xDC00);
+		}
+		highSurrogate = 0;
+		AppendCodePoint(name, codePoint);
+	}
+	return false;
+}
+
+/**
+ * @brief Appends a code point to a UTF-8 string.
+ */
+void UserRegPlayerPrefsBackend::AppendCodePoint(std::string& utf8, unsigned int codePoint)
+{
+	if (codePoint < 0x80)
+	{
+		utf8 += static_cast<char>(codePoint);
+	}
+	else if (codePoint < 0x800)
+	{
+		utf8 += static_cast<char>(0xC0 | (codePoint >> 6));
+		utf8 += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000)
+	{
+		utf8 += static_cast<char>(0xE0 | (codePoint >> 12));
+		utf8 += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		utf8 += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		utf8 += static_cast<char>(0xF0 | (codePoint >> 18));
+		utf8 += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+		utf8 += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		utf8 += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+}
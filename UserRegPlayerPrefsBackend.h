@@ -0,0 +1,61 @@
+#pragma once
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "PlayerPrefsBackend.h"
+
+// PlayerPrefs in the user.reg of a Wine or Proton prefix, where Wine keeps
+// HKEY_CURRENT_USER as text.
+//
+// The file is only ever streamed a line at a time, never loaded. Listing reads
+// it once and keeps just the company and game names under Software. Deletes
+// are queued, and Commit removes every queued [Software\\company\\game]
+// section in one more pass, writing a temp file next to user.reg and renaming
+// it over. Memory stays the same however big the hive is. The temp file is
+// synced before the rename and the folder after it, since a user.reg lost to
+// a crash takes all of HKEY_CURRENT_USER with it, not just the games' keys.
+//
+// Wine writes the hive back from memory while the prefix is running, which
+// would undo the deletes, so Commit leaves a running prefix alone and fails.
+class UserRegPlayerPrefsBackend : public PlayerPrefsBackend
+{
+public:
+	explicit UserRegPlayerPrefsBackend(const std::filesystem::path& userReg);
+
+	std::vector<std::wstring> ListCompanies() override;
+	std::vector<std::wstring> ListGames(const std::wstring& company) override;
+	bool DeleteGame(const std::wstring& company, const std::wstring& game) override;
+	bool DeleteCompany(const std::wstring& company) override;
+	bool Commit() override;
+
+	static std::filesystem::path FindUserReg(const std::filesystem::path& localLow);
+
+private:
+	struct Company
+	{
+		std::wstring name;
+		// folded name to name as written
+		std::map<std::wstring, std::wstring> games;
+	};
+
+	void LoadIndex();
+	bool IsPrefixRunning() const;
+	static bool ParseSection(const std::string& line, std::vector<std::wstring>& keyPath);
+	static void AppendCodePoint(std::string& utf8, unsigned int codePoint);
+	static int OpenFile(const std::filesystem::path& path);
+	static bool WriteBytes(int file, const std::string& bytes);
+	static bool SyncFile(int file);
+	static bool CloseFile(int file);
+	static void SyncFolder(const std::filesystem::path& folder);
+
+	std::filesystem::path userReg;
+	bool indexed = false;
+	// folded name to company, Software's first two levels
+	std::map<std::wstring, Company> companies;
+	// folded names queued by DeleteGame and DeleteCompany
+	std::set<std::pair<std::wstring, std::wstring>> gameDeletes;
+	std::set<std::wstring> companyDeletes;
+};
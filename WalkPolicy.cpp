@@ -0,0 +1,163 @@
+#include "WalkPolicy.h"
+#include "Constants.h"
+
+
+/**
+ * @brief Makes the policy every scan uses unless told otherwise, see CONSTANT::SCAN_MAX_DEPTH.
+ */
+WalkPolicy::WalkPolicy() : maxDepth(CONSTANT::SCAN_MAX_DEPTH)
+{
+	for (const char* pattern : CONSTANT::SCAN_SKIP_FOLDERS)
+	{
+		skipFolders.emplace_back(pattern);
+	}
+}
+
+/**
+ * @brief Makes a policy that walks every folder, as deep as it goes.
+ */
+WalkPolicy WalkPolicy::Unbounded()
+{
+	WalkPolicy policy;
+	policy.maxDepth = 0;
+	policy.skipFolders.clear();
+	policy.stopAtPlayerLog = false;
+	return policy;
+}
+
+/**
+ * @brief Sets how many folder levels below a company are walked.
+ *
+ * @param depth 1 is only the game folders, 0 walks everything.
+ */
+void WalkPolicy::SetMaxDepth(size_t depth)
+{
+	maxDepth = depth;
+}
+
+/**
+ * @brief Sets the folder names never walked into.
+ *
+ * @param patterns Names, or globs where * matches any run of characters and ? any one.
+ */
+void WalkPolicy::SetSkipFolders(const std::vector<std::string>& patterns)
+{
+	skipFolders = patterns;
+}
+
+/**
+ * @brief Sets whether folders with a Player.log are walked into.
+ */
+void WalkPolicy::SetStopAtPlayerLog(bool stop)
+{
+	stopAtPlayerLog = stop;
+}
+
+/**
+ * @brief Tells whether the subfolders of a folder are walked.
+ *
+ * @param depth The folder's level below the company, the company itself is 0.
+ */
+bool WalkPolicy::CanDescend(size_t depth) const
+{
+	return maxDepth == 0 || depth < maxDepth;
+}
+
+/**
+ * @brief Tells whether a folder is on the skip list.
+ *
+ * @param folderName The folder's own name, in UTF-8.
+ */
+bool WalkPolicy::IsSkipped(std::string_view folderName) const
+{
+	for (const std::string& pattern : skipFolders)
+	{
+		if (MatchGlob(pattern, folderName))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Gets a hash of the policy.
+ *
+ * The snapshot only remembers the folders a scan walked, so it can only stand
+ * in for a folder listing when it was taken with the same policy.
+ */
+uint64_t WalkPolicy::GetKey() const
+{
+	// FNV-1a
+	uint64_t key = 14695981039346656037ull;
+	auto add = [&key](std::string_view bytes)
+		{
+			for (char c : bytes)
+			{
+				key = (key ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+			}
+		};
+
+	add(std::to_string(maxDepth));
+	add(stopAtPlayerLog ? "+" : "-");
+	for (const std::string& pattern : skipFolders)
+	{
+		// case doesn't change what a pattern matches.
+		std::string folded(pattern);
+		for (char& c : folded)
+		{
+			c = Fold(c);
+		}
+		add(folded);
+		add(std::string_view("\0", 1));
+	}
+	return key;
+}
+
+/**
+ * @brief Matches a name against a glob, ignoring ASCII case.
+ *
+ * Backtracks to the last * only, so it is linear in practice.
+ */
+bool WalkPolicy::MatchGlob(std::string_view pattern, std::string_view name)
+{
+	size_t p = 0;
+	size_t n = 0;
+	size_t starPattern = std::string_view::npos;
+	size_t starName = 0;
+
+	while (n < name.size())
+	{
+		if (p < pattern.size() && pattern[p] == '*')
+		{
+			starPattern = p++;
+			starName = n;
+		}
+		else if (p < pattern.size() && (pattern[p] == '?' || Fold(pattern[p]) == Fold(name[n])))
+		{
+			++p;
+			++n;
+		}
+		else if (starPattern != std::string_view::npos)
+		{
+			// let the last * take one more character.
+			p = starPattern + 1;
+			n = ++starName;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	while (p < pattern.size() && pattern[p] == '*')
+	{
+		++p;
+	}
+	return p == pattern.size();
+}
+
+char WalkPolicy::Fold(char c)
+{
+	return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Which folders below a company folder the scanner walks into.
+//
+// Unity keeps a game's files in LocalLow/<Company>/<Game>/, with Player.log or
+// output_log.txt at the top of the game folder. Anything below that is the
+// game's own screenshots, caches, mods and replays, which can run to hundreds
+// of thousands of files and never hold a save of their own. So the walk stops
+// at MaxDepth levels below the company, never enters folders on the skip list,
+// and doesn't go below a folder once its Player.log has classified it.
+//
+// Folders with only an output_log.txt are still walked into, within the other
+// limits: a Player.log further down means the game is known after all.
+class WalkPolicy
+{
+public:
+	WalkPolicy();
+
+	static WalkPolicy Unbounded();
+
+	void SetMaxDepth(size_t depth);
+	void SetSkipFolders(const std::vector<std::string>& patterns);
+	void SetStopAtPlayerLog(bool stop);
+
+	size_t GetMaxDepth() const { return maxDepth; }
+	const std::vector<std::string>& GetSkipFolders() const { return skipFolders; }
+	bool GetStopAtPlayerLog() const { return stopAtPlayerLog; }
+
+	bool CanDescend(size_t depth) const;
+	bool IsSkipped(std::string_view folderName) const;
+	uint64_t GetKey() const;
+
+private:
+	static bool MatchGlob(std::string_view pattern, std::string_view name);
+	static char Fold(char c);
+
+	// levels below the company folder, 0 for no limit
+	size_t maxDepth;
+	// names and globs (* and ?), matched ignoring ASCII case
+	std::vector<std::string> skipFolders;
+	bool stopAtPlayerLog = true;
+};
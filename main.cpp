@@ -0,0 +1,638 @@
+#include "DeletionEngine.h"
+#include "FindSave.h"
+#include "NdjsonWriter.h"
+#include "RootDiscovery.h"
+#include "WalkPolicy.h"
+#include "Constants.h"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <windows.h>
+#include <shellapi.h>
+#endif
+
+// HEADLESS FRONT END, STREAMS SCAN RESULTS AS NDJSON
+
+namespace
+{
+	struct CliOptions
+	{
+		std::vector<std::string> roots;
+		bool allRoots = false;
+		unsigned int threadCount = CONSTANT::SCAN_THREAD_COUNT;
+		unsigned int ioLimit = CONSTANT::SCAN_IO_LIMIT;
+		WalkPolicy walkPolicy;
+		std::string snapshotPath;
+		// Steam installs for resolving saves with no game path, found if none are given
+		std::vector<std::string> steamFolders;
+		bool findSteam = true;
+		std::string installCachePath;
+		bool deleteUnlinked = false;
+		bool deleteUnknown = false;
+		bool apply = false;
+		// zip the saves go into before they are deleted, empty for none
+		std::string archivePath;
+		bool stats = false;
+		std::string tracePath;
+	};
+
+	// exit codes
+	const int EXIT_BAD_ARGUMENTS = 1;
+	const int EXIT_NO_ROOT = 2;
+	const int EXIT_DELETE_FAILED = 3;
+	const int EXIT_TRACE_FAILED = 4;
+
+	/**
+	 * @brief Prints how to call the program.
+	 */
+	void PrintUsage()
+	{
+		std::cerr
+			<< "Usage: UnitySaveDeleterCli [root...] [--all-roots] [--threads N] [--io-limit N] [--max-depth N] [--skip PATTERN] [--walk-all] [--snapshot FILE] [--steam DIR] [--no-steam] [--install-cache FILE] [--delete CLASSES [--apply [--archive FILE]]] [--stats] [--trace FILE]\n"
+			<< "\n"
+			<< "  root             LocalLow folder to scan, the current user's by default\n"
+			<< "  --all-roots      also scan every other profile and Wine/Proton prefix found\n"
+			<< "  --threads N      scan threads, shared by all roots, 0 uses one per hardware thread\n"
+			<< "  --io-limit N     folder listings and log reads in flight at once, 0 for no limit\n"
+			<< "  --max-depth N    folder levels walked below a company, 1 is the games, 0 for no limit\n"
+			<< "  --skip PATTERN   never walk into folders with this name or glob, adds to the defaults\n"
+			<< "  --walk-all       walk every folder: no depth limit, no skip list, not even below a Player.log\n"
+			<< "  --snapshot FILE  reuse and update a scan snapshot, one root only, none by default\n"
+			<< "  --steam DIR      Steam folder whose installed games resolve output_log.txt saves, found by default\n"
+			<< "  --no-steam       leave saves with no game path unknown\n"
+			<< "  --install-cache FILE  keep the Steam install index between runs, rebuilt every run by default\n"
+			<< "  --delete CLASSES comma separated: unlinked, unknown. Prints a delete plan\n"
+			<< "  --apply          carries the plan out instead of only printing it\n"
+			<< "  --archive FILE   zips every save before deleting it, after the scan instead of during it\n"
+			<< "  --stats          adds what the scan cost to the summary: counters and phase times\n"
+			<< "  --trace FILE     writes a Chrome trace of the scan, for chrome://tracing or Perfetto\n"
+			<< "\n"
+			<< "Writes one JSON object per line to stdout: a \"root\" record per folder scanned,\n"
+			<< "a \"save\" record per save folder as soon as it is classified, a \"delete\"\n"
+			<< "record per planned/done deletion, and a \"summary\" record at the end.\n";
+	}
+
+	/**
+	 * @brief Reads the command line.
+	 *
+	 * @return False if it doesn't make sense, the reason has been printed.
+	 */
+	bool ParseArguments(int argc, char* argv[], CliOptions& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string argument = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (argument == "--help" || argument == "-h")
+			{
+				return false;
+			}
+			else if (argument == "--threads" && hasValue)
+			{
+				options.threadCount = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+			}
+			else if (argument == "--io-limit" && hasValue)
+			{
+				options.ioLimit = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+			}
+			else if (argument == "--max-depth" && hasValue)
+			{
+				options.walkPolicy.SetMaxDepth(static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10)));
+			}
+			else if (argument == "--skip" && hasValue)
+			{
+				std::vector<std::string> skipFolders = options.walkPolicy.GetSkipFolders();
+				skipFolders.push_back(argv[++i]);
+				options.walkPolicy.SetSkipFolders(skipFolders);
+			}
+			else if (argument == "--walk-all")
+			{
+				options.walkPolicy = WalkPolicy::Unbounded();
+			}
+			else if (argument == "--all-roots")
+			{
+				options.allRoots = true;
+			}
+			else if (argument == "--snapshot" && hasValue)
+			{
+				options.snapshotPath = argv[++i];
+			}
+			else if (argument == "--steam" && hasValue)
+			{
+				options.steamFolders.push_back(argv[++i]);
+				options.findSteam = false;
+			}
+			else if (argument == "--no-steam")
+			{
+				options.steamFolders.clear();
+				options.findSteam = false;
+			}
+			else if (argument == "--install-cache" && hasValue)
+			{
+				options.installCachePath = argv[++i];
+			}
+			else if (argument == "--delete" && hasValue)
+			{
+				std::string classes = argv[++i];
+				size_t start = 0;
+				while (start <= classes.size())
+				{
+					size_t end = classes.find(',', start);
+					std::string name = classes.substr(start, end == std::string::npos ? std::string::npos : end - start);
+					if (name == "unlinked")
+					{
+						options.deleteUnlinked = true;
+					}
+					else if (name == "unknown")
+					{
+						options.deleteUnknown = true;
+					}
+					else
+					{
+						// saves of installed games are never deleted from here.
+						std::cerr << "Unknown save class for --delete: " << name << "\n";
+						return false;
+					}
+
+					if (end == std::string::npos)
+					{
+						break;
+					}
+					start = end + 1;
+				}
+			}
+			else if (argument == "--apply")
+			{
+				options.apply = true;
+			}
+			else if (argument == "--archive" && hasValue)
+			{
+				options.archivePath = argv[++i];
+			}
+			else if (argument == "--stats")
+			{
+				options.stats = true;
+			}
+			else if (argument == "--trace" && hasValue)
+			{
+				options.tracePath = argv[++i];
+			}
+			else if (!argument.empty() && argument[0] != '-')
+			{
+				options.roots.push_back(argument);
+			}
+			else
+			{
+				std::cerr << "Unknown argument: " << argument << "\n";
+				return false;
+			}
+		}
+
+		if (options.apply && !options.deleteUnlinked && !options.deleteUnknown)
+		{
+			std::cerr << "--apply needs --delete\n";
+			return false;
+		}
+		if (!options.archivePath.empty() && !options.apply)
+		{
+			std::cerr << "--archive needs --apply\n";
+			return false;
+		}
+		if (!options.snapshotPath.empty() && (options.allRoots || options.roots.size() > 1))
+		{
+			std::cerr << "--snapshot only works with a single root\n";
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Gets the name a root kind is written as.
+	 */
+	const char* RootKindName(RootKind kind)
+	{
+		switch (kind)
+		{
+		case RootKind::CurrentUser:
+			return "user";
+		case RootKind::Profile:
+			return "profile";
+		default:
+			return "prefix";
+		}
+	}
+
+	/**
+	 * @brief Writes a root the way the scan reports company folders under it.
+	 *
+	 * Normalised, without a trailing separator, so it equals the parent path of
+	 * every company folder found in it.
+	 */
+	std::string NormalizeRoot(const std::string& root)
+	{
+		std::filesystem::path path = std::filesystem::u8path(root).lexically_normal();
+		if (!path.has_filename() && path.has_relative_path())
+		{
+			path = path.parent_path();
+		}
+		return path.u8string();
+	}
+
+	/**
+	 * @brief Gets the name a classification is written as.
+	 */
+	const char* SaveClassName(SaveClass classification)
+	{
+		switch (classification)
+		{
+		case SaveClass::Installed:
+			return "installed";
+		case SaveClass::Unlinked:
+			return "unlinked";
+		default:
+			return "unknown";
+		}
+	}
+
+	/**
+	 * @brief Deletes a save folder, its PlayerPrefs are left for one batch at the end.
+	 *
+	 * @return Empty on success, otherwise what went wrong.
+	 */
+	std::string DeleteSave(const SaveEntry& save)
+	{
+		std::filesystem::path pathToUTF8 = std::filesystem::u8path(save.gamePath);
+		std::error_code error;
+		std::filesystem::remove_all(pathToUTF8, error);
+		if (error)
+		{
+			return error.message();
+		}
+		return std::string();
+	}
+
+#ifdef _WIN32
+	/**
+	 * @brief Gets the command line again as UTF-8.
+	 *
+	 * main's argv is in the ANSI code page, which can't hold every path, and
+	 * every path from here on is taken as UTF-8.
+	 *
+	 * @return The arguments, argv[0] first. Empty if the command line couldn't be read.
+	 */
+	std::vector<std::string> GetUtf8Arguments()
+	{
+		std::vector<std::string> arguments;
+		int count = 0;
+		wchar_t** wideArguments = CommandLineToArgvW(GetCommandLineW(), &count);
+		if (wideArguments == nullptr)
+		{
+			return arguments;
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			arguments.push_back(std::filesystem::path(wideArguments[i]).u8string());
+		}
+		LocalFree(wideArguments);
+		return arguments;
+	}
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef _WIN32
+	std::vector<std::string> utf8Arguments = GetUtf8Arguments();
+	std::vector<char*> utf8Argv;
+	for (std::string& argument : utf8Arguments)
+	{
+		utf8Argv.push_back(argument.data());
+	}
+	if (!utf8Argv.empty())
+	{
+		utf8Argv.push_back(nullptr);
+		argc = static_cast<int>(utf8Arguments.size());
+		argv = utf8Argv.data();
+	}
+#endif
+
+	CliOptions options;
+	if (!ParseArguments(argc, argv, options))
+	{
+		PrintUsage();
+		return EXIT_BAD_ARGUMENTS;
+	}
+
+#ifdef _WIN32
+	// keep the lines \n terminated.
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	std::ios::sync_with_stdio(false);
+
+	FindSave finder;
+	std::vector<ScanRoot> roots;
+	for (const std::string& root : options.roots)
+	{
+		std::error_code rootError;
+		if (!std::filesystem::is_directory(std::filesystem::u8path(root), rootError))
+		{
+			std::cerr << "Not a folder: " << root << "\n";
+			return EXIT_NO_ROOT;
+		}
+		ScanRoot given;
+		given.path = root;
+		given.label = "Given";
+		roots.push_back(given);
+	}
+	if (options.allRoots)
+	{
+		std::vector<ScanRoot> found = RootDiscovery::FindAll(finder.GetAppDataPath());
+		roots.insert(roots.end(), found.begin(), found.end());
+	}
+	else if (roots.empty())
+	{
+		ScanRoot current;
+		current.path = finder.GetAppDataPath();
+		current.label = "This user";
+		std::error_code rootError;
+		if (!std::filesystem::is_directory(std::filesystem::u8path(current.path), rootError))
+		{
+			std::cerr << "Not a folder: " << current.path << "\n";
+			return EXIT_NO_ROOT;
+		}
+		roots.push_back(current);
+	}
+
+	finder.SetScanThreadCount(options.threadCount);
+	finder.SetIoLimit(options.ioLimit);
+	finder.SetWalkPolicy(options.walkPolicy);
+	finder.SetSnapshotPath(options.snapshotPath);
+	if (options.findSteam)
+	{
+		for (const std::filesystem::path& steam : RootDiscovery::FindSteamFolders())
+		{
+			options.steamFolders.push_back(steam.u8string());
+		}
+	}
+	finder.SetInstallSources(options.steamFolders, options.installCachePath);
+
+	NdjsonWriter writer(std::cout);
+
+	// results are tagged with the root their company folder is in.
+	std::vector<std::string> rootPaths;
+	std::map<std::string, RootKind> rootKinds;
+	for (const ScanRoot& root : roots)
+	{
+		std::string path = NormalizeRoot(root.path);
+		if (!rootKinds.emplace(path, root.kind).second)
+		{
+			continue;
+		}
+		rootPaths.push_back(path);
+
+		JsonObject record;
+		record.Add("type", "root")
+			.Add("path", path)
+			.Add("label", root.label)
+			.Add("kind", RootKindName(root.kind));
+		writer.Write(record);
+	}
+
+	std::atomic<uint64_t> saveCounts[3] = {};
+	std::atomic<uint64_t> companyCount{ 0 };
+	std::atomic<uint64_t> planned{ 0 };
+	std::atomic<uint64_t> deleted{ 0 };
+	std::atomic<uint64_t> failed{ 0 };
+	// deleted saves by root, each root's PlayerPrefs are cleaned in one batch
+	std::map<std::string, std::vector<std::string>> deletedPaths;
+	std::mutex deletedMutex;
+	// with --archive, the saves to zip and delete once the scan is done, and the root and company of each
+	std::vector<std::string> archivePaths;
+	std::map<std::string, std::pair<std::string, std::string>> archiveFolders;
+
+	// only counted and timed when asked for.
+	ScanStats stats;
+	TraceRecorder trace;
+
+	ScanObserver observer;
+	// every company is written out as it comes, nothing needs keeping.
+	observer.keepResults = !options.snapshotPath.empty();
+	observer.stats = options.stats ? &stats : nullptr;
+	observer.trace = options.tracePath.empty() ? nullptr : &trace;
+	observer.onCompanyScanned = [&](const std::string& companyPath, const std::vector<SaveEntry>& saves, size_t, size_t)
+		{
+			if (saves.empty())
+			{
+				return;
+			}
+			++companyCount;
+			std::string root = std::filesystem::u8path(companyPath).parent_path().u8string();
+
+			bool deletedAny = false;
+			for (const SaveEntry& save : saves)
+			{
+				++saveCounts[static_cast<int>(save.classification)];
+
+				JsonObject record;
+				record.Add("type", "save")
+					.Add("root", root)
+					.Add("company", companyPath)
+					.Add("path", save.gamePath)
+					.Add("name", finder.ExtractGameName(save.gamePath))
+					.Add("class", SaveClassName(save.classification))
+					.Add("playerLog", save.hasPlayerLog)
+					.Add("outputLog", save.hasOutputLog)
+					.Add("installPath", save.installPath);
+				writer.Write(record);
+
+				bool selected = (save.classification == SaveClass::Unlinked && options.deleteUnlinked)
+					|| (save.classification == SaveClass::Unknown && options.deleteUnknown);
+				if (!selected)
+				{
+					continue;
+				}
+
+				++planned;
+				if (!options.archivePath.empty())
+				{
+					std::lock_guard<std::mutex> lock(deletedMutex);
+					archivePaths.push_back(save.gamePath);
+					archiveFolders[save.gamePath] = { root, companyPath };
+					continue;
+				}
+
+				JsonObject deletion;
+				deletion.Add("type", "delete").Add("path", save.gamePath);
+				if (!options.apply)
+				{
+					deletion.Add("status", "planned");
+				}
+				else
+				{
+					std::string error = DeleteSave(save);
+					deletion.Add("status", error.empty() ? "deleted" : "failed");
+					if (!error.empty())
+					{
+						deletion.Add("error", error);
+						++failed;
+					}
+					else
+					{
+						++deleted;
+						deletedAny = true;
+						std::lock_guard<std::mutex> lock(deletedMutex);
+						deletedPaths[root].push_back(save.gamePath);
+					}
+				}
+				writer.Write(deletion);
+			}
+
+			if (deletedAny)
+			{
+				finder.RemoveEmptyFolder(companyPath);
+			}
+		};
+
+	if (rootPaths.size() == 1)
+	{
+		finder.ScanSaves(rootPaths.front(), observer);
+	}
+	else
+	{
+		finder.ScanRoots(rootPaths, observer);
+	}
+
+	// every save goes into the zip first, each one deleted as soon as it is in there.
+	ArchiveSummary archive;
+	if (!archivePaths.empty())
+	{
+		DeletionObserver deletionObserver;
+		deletionObserver.trace = observer.trace;
+		deletionObserver.onItemDeleted = [&](const std::string& path)
+			{
+				JsonObject deletion;
+				deletion.Add("type", "delete").Add("path", path).Add("status", "deleted");
+				writer.Write(deletion);
+				++deleted;
+				std::lock_guard<std::mutex> lock(deletedMutex);
+				deletedPaths[archiveFolders[path].first].push_back(path);
+			};
+
+		DeletionEngine engine;
+		engine.SetThreadCount(options.threadCount);
+		engine.SetArchive(options.archivePath);
+		DeletionSummary deletion = engine.DeleteAll(archivePaths, deletionObserver);
+		archive = deletion.archive;
+		for (const DeletionError& error : deletion.errors)
+		{
+			JsonObject record;
+			record.Add("type", "delete").Add("path", error.path).Add("status", "failed").Add("error", error.message);
+			writer.Write(record);
+			++failed;
+		}
+		if (!archive.error.empty())
+		{
+			std::cerr << "Could not finish the archive: " << archive.error << "\n";
+			if (archive.itemsArchived == 0)
+			{
+				std::cerr << "No saves were deleted.\n";
+			}
+			else if (archive.readable)
+			{
+				std::cerr << "It holds the saves that were deleted, the rest were left as they were.\n";
+			}
+			else
+			{
+				std::cerr << "The saves that were deleted are in it, but it has no central directory, a zip repair tool (zip -FF) can get them back.\n";
+			}
+		}
+
+		std::set<std::string> companyPaths;
+		for (const auto& root : deletedPaths)
+		{
+			for (const std::string& path : root.second)
+			{
+				companyPaths.insert(archiveFolders[path].second);
+			}
+		}
+		for (const std::string& companyPath : companyPaths)
+		{
+			finder.RemoveEmptyFolder(companyPath);
+		}
+	}
+
+	for (const auto& root : deletedPaths)
+	{
+		// another profile's PlayerPrefs are in its own hive, which isn't loaded.
+		if (rootKinds[root.first] != RootKind::Profile)
+		{
+			finder.DeletePlayerPrefPaths(root.second, root.first);
+		}
+	}
+
+	JsonObject summary;
+	summary.Add("type", "summary");
+	if (rootPaths.size() == 1)
+	{
+		summary.Add("root", rootPaths.front());
+	}
+	summary.Add("roots", static_cast<uint64_t>(rootPaths.size()))
+		.Add("companies", companyCount.load())
+		.Add("installed", saveCounts[static_cast<int>(SaveClass::Installed)].load())
+		.Add("unlinked", saveCounts[static_cast<int>(SaveClass::Unlinked)].load())
+		.Add("unknown", saveCounts[static_cast<int>(SaveClass::Unknown)].load())
+		.Add("deletePlanned", planned.load())
+		.Add("deleted", deleted.load())
+		.Add("deleteFailed", failed.load());
+	if (!options.archivePath.empty())
+	{
+		summary.Add("archived", static_cast<uint64_t>(archive.itemsArchived))
+			.Add("archiveFiles", archive.filesArchived)
+			.Add("archiveBytesRead", archive.bytesRead)
+			.Add("archiveBytes", archive.bytesWritten)
+			.Add("archiveReadable", archive.readable)
+			.Add("archiveMs", static_cast<uint64_t>(archive.milliseconds));
+	}
+	if (options.stats)
+	{
+		summary.Add("directoriesVisited", stats.directoriesVisited.load())
+			.Add("directoriesRead", stats.directoriesRead.load())
+			.Add("entriesChecked", stats.entriesChecked.load())
+			.Add("logsOpened", stats.filesOpened.load())
+			.Add("bytesRead", stats.bytesRead.load())
+			.Add("logsReadOnRing", stats.logsReadOnRing.load())
+			.Add("pathsProbed", stats.pathsProbed.load())
+			.Add("manifestsRead", stats.manifestsRead.load())
+			.Add("unknownResolved", stats.unknownResolved.load())
+			.Add("folderCacheHits", stats.folderCacheHits.load())
+			.Add("logCacheHits", stats.logCacheHits.load())
+			.Add("foldersSkipped", stats.foldersSkipped.load())
+			.Add("installIndexUs", stats.installIndexMicroseconds.load())
+			.Add("listUs", stats.listMicroseconds.load())
+			.Add("walkUs", stats.walkMicroseconds.load())
+			.Add("logsUs", stats.logsMicroseconds.load())
+			.Add("snapshotUs", stats.snapshotMicroseconds.load())
+			.Add("listingThreadUs", stats.listingMicroseconds.load())
+			.Add("logReadThreadUs", stats.logReadMicroseconds.load())
+			.Add("probeThreadUs", stats.probeMicroseconds.load());
+	}
+	writer.Write(summary);
+
+	if (!options.tracePath.empty() && !trace.WriteChromeTrace(options.tracePath))
+	{
+		std::cerr << "Could not write the trace to " << options.tracePath << "\n";
+		return EXIT_TRACE_FAILED;
+	}
+	return failed > 0 ? EXIT_DELETE_FAILED : 0;
+}